@@ -52,6 +52,7 @@
 #include "aloptional.h"
 #include "atomic.h"
 #include "core/except.h"
+#include "core/fmt_traits.h"
 #include "core/logging.h"
 #include "core/voice.h"
 #include "opthelpers.h"
@@ -447,11 +448,115 @@ ALbuffer *AllocBuffer(ALCdevice *device)
     return buffer;
 }
 
+/* Frees the buffer's float sample cache, if it has one. */
+void ReleaseBufferCache(ALCdevice *device, ALbuffer *buffer)
+{
+    if(buffer->mFloatData.empty())
+        return;
+    device->mBufferCacheSize -= buffer->mFloatData.size() * sizeof(float);
+    al::vector<float,16>{}.swap(buffer->mFloatData);
+    buffer->mFloatStride = 0;
+}
+
+template<FmtType Type>
+void LoadCacheSamples(float *dst, const size_t dstStride, const al::byte *src,
+    const size_t numChans, const size_t frames)
+{
+    constexpr size_t sampleSize{sizeof(typename al::FmtTypeTraits<Type>::Type)};
+    for(size_t c{0};c < numChans;++c)
+        al::LoadSampleArray<Type>(dst + c*dstStride, src + c*sampleSize, numChans, frames);
+}
+
+/* Converts the given range of sample frames from the buffer's storage into
+ * its float sample cache.
+ */
+void UpdateBufferCache(ALbuffer *buffer, const size_t offset, const size_t frames)
+{
+    const size_t numchans{buffer->channelsFromFmt()};
+    const al::byte *src{buffer->mData.data() + offset*buffer->frameSizeFromFmt()};
+    float *dst{buffer->mFloatData.data() + offset};
+
+#define HANDLE_FMT(T) case T:                                                 \
+    LoadCacheSamples<T>(dst, buffer->mFloatStride, src, numchans, frames);    \
+    break
+
+    switch(buffer->mType)
+    {
+    HANDLE_FMT(FmtUByte);
+    HANDLE_FMT(FmtShort);
+    HANDLE_FMT(FmtFloat);
+    HANDLE_FMT(FmtDouble);
+    HANDLE_FMT(FmtMulaw);
+    HANDLE_FMT(FmtAlaw);
+    }
+#undef HANDLE_FMT
+}
+
+/* Builds the buffer's float sample cache, if it's allowed and fits in the
+ * device's cache budget. Caches of buffers not attached to any source are
+ * evicted as needed, least recently used first.
+ */
+void BuildBufferCache(ALCdevice *device, ALbuffer *buffer)
+{
+    if(!buffer->mFloatData.empty() || device->mBufferCacheBudget == 0)
+        return;
+
+    /* Callback buffers are refilled as they play, and the app may write to
+     * mappable buffers at any time. Mono float samples are already in the
+     * cached layout.
+     */
+    if(buffer->mCallback || buffer->mSampleLen == 0 || (buffer->Access&AL_MAP_WRITE_BIT_SOFT)
+        || (buffer->mType == FmtFloat && buffer->channelsFromFmt() == 1))
+        return;
+
+    /* Each channel starts 16-byte aligned. */
+    const size_t stride{RoundUp(buffer->mSampleLen, 4)};
+    const size_t newsize{stride * buffer->channelsFromFmt() * sizeof(float)};
+    if(newsize > device->mBufferCacheBudget)
+        return;
+
+    while(device->mBufferCacheSize + newsize > device->mBufferCacheBudget)
+    {
+        ALbuffer *oldest{nullptr};
+        for(BufferSubList &sublist : device->BufferList)
+        {
+            uint64_t usemask{~sublist.FreeMask};
+            while(usemask)
+            {
+                const int idx{al::countr_zero(usemask)};
+                usemask &= ~(1_u64 << idx);
+
+                ALbuffer *other{sublist.Buffers + idx};
+                if(other->mFloatData.empty() || ReadRef(other->ref) != 0)
+                    continue;
+                if(!oldest || other->mFloatStamp < oldest->mFloatStamp)
+                    oldest = other;
+            }
+        }
+        /* Everything cached is in use. */
+        if(!oldest) return;
+        ReleaseBufferCache(device, oldest);
+    }
+
+    try {
+        buffer->mFloatData.resize(newsize / sizeof(float));
+    }
+    catch(std::exception &e) {
+        ERR("Failed to allocate float cache for buffer %u: %s\n", buffer->id, e.what());
+        return;
+    }
+    buffer->mFloatStride = static_cast<ALuint>(stride);
+    device->mBufferCacheSize += newsize;
+
+    UpdateBufferCache(buffer, 0, buffer->mSampleLen);
+}
+
 void FreeBuffer(ALCdevice *device, ALbuffer *buffer)
 {
 #ifdef ALSOFT_EAX
     eax_x_ram_clear(*device, *buffer);
 #endif // ALSOFT_EAX
+    ReleaseBufferCache(device, buffer);
 
     const ALuint id{buffer->id - 1};
     const size_t lidx{id >> 6};
@@ -675,6 +780,14 @@ void LoadData(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
     ALBuf->mLoopStart = 0;
     ALBuf->mLoopEnd = ALBuf->mSampleLen;
 
+    ALCdevice *device{context->mALDevice.get()};
+    ReleaseBufferCache(device, ALBuf);
+    if(SrcData != nullptr)
+    {
+        ALBuf->mFloatStamp = ++device->mBufferCacheClock;
+        BuildBufferCache(device, ALBuf);
+    }
+
 #ifdef ALSOFT_EAX
     if(eax_g_is_enabled && ALBuf->eax_x_ram_mode != AL_STORAGE_ACCESSIBLE)
         eax_x_ram_apply(*context->mALDevice, *ALBuf);
@@ -706,6 +819,7 @@ void PrepareCallback(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
     static constexpr uint line_size{BufferLineSize + MaxPostVoiceLoad};
     al::vector<al::byte,16>(FrameSizeFromFmt(*DstChannels, *DstType, ambiorder) *
         size_t{line_size}).swap(ALBuf->mData);
+    ReleaseBufferCache(context->mALDevice.get(), ALBuf);
 
 #ifdef ALSOFT_EAX
     eax_x_ram_clear(*context->mALDevice, *ALBuf);
@@ -819,6 +933,13 @@ al::optional<DecompResult> DecomposeUserFormat(ALenum format)
 } // namespace
 
 
+void UseBufferCache(ALCdevice *device, ALbuffer *buffer)
+{
+    buffer->mFloatStamp = ++device->mBufferCacheClock;
+    BuildBufferCache(device, buffer);
+}
+
+
 AL_API void AL_APIENTRY alGenBuffers(ALsizei n, ALuint *buffers)
 START_API_FUNC
 {
@@ -1146,6 +1267,8 @@ START_API_FUNC
                 assert(long{usrfmt->type} == long{albuf->mType});
                 memcpy(dst, data, size_t{samplen} * frame_size);
             }
+            if(!albuf->mFloatData.empty())
+                UpdateBufferCache(albuf, byteoff/frame_size, samplen);
         }
     }
 }
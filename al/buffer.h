@@ -2,6 +2,7 @@
 #define AL_BUFFER_H
 
 #include <atomic>
+#include <stdint.h>
 
 #include "AL/al.h"
 
@@ -16,6 +17,8 @@
 #include "eax/x_ram.h"
 #endif // ALSOFT_EAX
 
+struct ALCdevice;
+
 /* User formats */
 enum UserFmtType : unsigned char {
     UserFmtUByte = FmtUByte,
@@ -49,6 +52,14 @@ struct ALbuffer : public BufferStorage {
 
     al::vector<al::byte,16> mData;
 
+    /* Optional planar float copy of mData, with each channel's samples
+     * starting mFloatStride samples apart, so voices can skip the format
+     * conversion. The stamp marks the last use for cache eviction.
+     */
+    al::vector<float,16> mFloatData;
+    ALuint mFloatStride{0u};
+    uint64_t mFloatStamp{0u};
+
     UserFmtType OriginalType{UserFmtShort};
     ALuint OriginalSize{0};
     ALuint OriginalAlign{0};
@@ -70,6 +81,16 @@ struct ALbuffer : public BufferStorage {
     /* Self ID */
     ALuint id{0};
 
+    /* Returns the planar float samples voices can read from, if any. */
+    float *planarSamples() noexcept
+    {
+        if(!mFloatData.empty())
+            return mFloatData.data();
+        if(!mCallback && mType == FmtFloat && channelsFromFmt() == 1)
+            return reinterpret_cast<float*>(mData.data());
+        return nullptr;
+    }
+
     DISABLE_ALLOC()
 
 #ifdef ALSOFT_EAX
@@ -78,4 +99,9 @@ struct ALbuffer : public BufferStorage {
 #endif // ALSOFT_EAX
 };
 
+/* Makes sure the buffer's float sample cache is built, if it can have one, and
+ * marks it as recently used. The device's BufferLock must be held.
+ */
+void UseBufferCache(ALCdevice *device, ALbuffer *buffer);
+
 #endif
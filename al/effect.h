@@ -30,6 +30,8 @@ enum {
 extern bool DisabledEffects[MAX_EFFECTS];
 
 extern float ReverbBoost;
+extern unsigned int ReverbLateDecimation;
+extern bool ConvolutionTailThread;
 
 struct EffectList {
     const char name[16];
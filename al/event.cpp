@@ -12,6 +12,7 @@
 #include <new>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 
 #include "AL/al.h"
@@ -29,11 +30,121 @@
 #include "opthelpers.h"
 #include "ringbuffer.h"
 #include "threads.h"
+#include "vector.h"
 
 
-static int EventThread(ALCcontext *context)
+namespace {
+
+std::string StateChangeMessage(const ALuint id, const ALuint state)
+{
+    std::string msg{"Source ID " + std::to_string(id)};
+    msg += " state has changed to ";
+    switch(state)
+    {
+    case AL_INITIAL: msg += "AL_INITIAL"; break;
+    case AL_STOPPED: msg += "AL_STOPPED"; break;
+    case AL_PLAYING: msg += "AL_PLAYING"; break;
+    case AL_PAUSED: msg += "AL_PAUSED"; break;
+    }
+    return msg;
+}
+
+std::string BufferCompletedMessage(const ALuint count)
+{
+    std::string msg{std::to_string(count)};
+    if(count == 1) msg += " buffer completed";
+    else msg += " buffers completed";
+    return msg;
+}
+
+/* Events collected for a batch callback. A source's state changes within a
+ * batch are coalesced to its latest one, and its buffer completions are summed
+ * until its state changes again.
+ */
+class EventBatch {
+    struct Entry {
+        ALenum mType;
+        ALuint mObject;
+        ALuint mParam;
+        std::string mMessage;
+    };
+    al::vector<Entry> mEntries;
+    al::vector<ALeventSOFT> mEvents;
+
+    /* The entries of each source's last state change and buffer completion. */
+    std::unordered_map<ALuint,size_t> mStateIndex;
+    std::unordered_map<ALuint,size_t> mBufferIndex;
+
+public:
+    bool empty() const noexcept { return mEntries.empty(); }
+
+    void addStateChange(const ALuint id, const ALuint state)
+    {
+        auto iter = mStateIndex.find(id);
+        if(iter != mStateIndex.end())
+            mEntries[iter->second].mType = AL_NONE;
+        mStateIndex[id] = mEntries.size();
+        mBufferIndex.erase(id);
+        mEntries.emplace_back(Entry{AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT, id, state, {}});
+    }
+
+    void addBufferCompleted(const ALuint id, const ALuint count)
+    {
+        auto iter = mBufferIndex.find(id);
+        if(iter != mBufferIndex.end())
+        {
+            mEntries[iter->second].mParam += count;
+            return;
+        }
+        mBufferIndex.emplace(id, mEntries.size());
+        mEntries.emplace_back(Entry{AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT, id, count, {}});
+    }
+
+    void addDisconnected(const char *msg)
+    { mEntries.emplace_back(Entry{AL_EVENT_TYPE_DISCONNECTED_SOFT, 0, 0, msg}); }
+
+    void deliver(ALCcontext *context)
+    {
+        mEvents.clear();
+        for(Entry &entry : mEntries)
+        {
+            if(entry.mType == AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT)
+                entry.mMessage = StateChangeMessage(entry.mObject, entry.mParam);
+            else if(entry.mType == AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT)
+                entry.mMessage = BufferCompletedMessage(entry.mParam);
+            else if(entry.mType != AL_EVENT_TYPE_DISCONNECTED_SOFT)
+                continue;
+
+            mEvents.emplace_back(ALeventSOFT{entry.mType, entry.mObject, entry.mParam,
+                static_cast<ALsizei>(entry.mMessage.length()), entry.mMessage.c_str()});
+        }
+        if(!mEvents.empty() && context->mEventBatchCb)
+            context->mEventBatchCb(static_cast<ALsizei>(mEvents.size()), mEvents.data(),
+                context->mEventBatchParam);
+
+        mEntries.clear();
+        mStateIndex.clear();
+        mBufferIndex.clear();
+    }
+};
+
+ALuint StateFromSrcState(const AsyncEvent::SrcState state) noexcept
+{
+    switch(state)
+    {
+    case AsyncEvent::SrcState::Reset: return AL_INITIAL;
+    case AsyncEvent::SrcState::Stop: return AL_STOPPED;
+    case AsyncEvent::SrcState::Play: return AL_PLAYING;
+    case AsyncEvent::SrcState::Pause: return AL_PAUSED;
+    }
+    return AL_NONE;
+}
+
+int EventThread(ALCcontext *context)
 {
     RingBuffer *ring{context->mAsyncEvents.get()};
+    EventBatch batch;
+    bool extrapass{false};
     bool quitnow{false};
     while(likely(!quitnow))
     {
@@ -45,6 +156,7 @@ static int EventThread(ALCcontext *context)
         }
 
         std::lock_guard<std::mutex> _{context->mEventCbLock};
+        const bool batched{context->mEventBatchCb != nullptr};
         do {
             auto *evt_ptr = reinterpret_cast<AsyncEvent*>(evt_data.buf);
             evt_data.buf += sizeof(AsyncEvent);
@@ -62,36 +174,30 @@ static int EventThread(ALCcontext *context)
                 evt.u.mEffectState->release();
                 continue;
             }
+            if(evt.EnumType == AsyncEvent::SwitchEventRing)
+            {
+                /* Everything before the switch has been read, so the old ring
+                 * can go.
+                 */
+                RingBufferPtr oldring{ring};
+                ring = evt.u.mRing;
+                break;
+            }
 
             uint enabledevts{context->mEnabledEvts.load(std::memory_order_acquire)};
-            if(!context->mEventCb) continue;
+            if(!context->mEventCb && !batched) continue;
 
             if(evt.EnumType == AsyncEvent::SourceStateChange)
             {
                 if(!(enabledevts&AsyncEvent::SourceStateChange))
                     continue;
-                ALuint state{};
-                std::string msg{"Source ID " + std::to_string(evt.u.srcstate.id)};
-                msg += " state has changed to ";
-                switch(evt.u.srcstate.state)
+                const ALuint state{StateFromSrcState(evt.u.srcstate.state)};
+                if(batched)
                 {
-                case AsyncEvent::SrcState::Reset:
-                    msg += "AL_INITIAL";
-                    state = AL_INITIAL;
-                    break;
-                case AsyncEvent::SrcState::Stop:
-                    msg += "AL_STOPPED";
-                    state = AL_STOPPED;
-                    break;
-                case AsyncEvent::SrcState::Play:
-                    msg += "AL_PLAYING";
-                    state = AL_PLAYING;
-                    break;
-                case AsyncEvent::SrcState::Pause:
-                    msg += "AL_PAUSED";
-                    state = AL_PAUSED;
-                    break;
+                    batch.addStateChange(evt.u.srcstate.id, state);
+                    continue;
                 }
+                const std::string msg{StateChangeMessage(evt.u.srcstate.id, state)};
                 context->mEventCb(AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT, evt.u.srcstate.id,
                     state, static_cast<ALsizei>(msg.length()), msg.c_str(), context->mEventParam);
             }
@@ -99,9 +205,12 @@ static int EventThread(ALCcontext *context)
             {
                 if(!(enabledevts&AsyncEvent::BufferCompleted))
                     continue;
-                std::string msg{std::to_string(evt.u.bufcomp.count)};
-                if(evt.u.bufcomp.count == 1) msg += " buffer completed";
-                else msg += " buffers completed";
+                if(batched)
+                {
+                    batch.addBufferCompleted(evt.u.bufcomp.id, evt.u.bufcomp.count);
+                    continue;
+                }
+                const std::string msg{BufferCompletedMessage(evt.u.bufcomp.count)};
                 context->mEventCb(AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT, evt.u.bufcomp.id,
                     evt.u.bufcomp.count, static_cast<ALsizei>(msg.length()), msg.c_str(),
                     context->mEventParam);
@@ -110,15 +219,38 @@ static int EventThread(ALCcontext *context)
             {
                 if(!(enabledevts&AsyncEvent::Disconnected))
                     continue;
+                if(batched)
+                {
+                    batch.addDisconnected(evt.u.disconnect.msg);
+                    continue;
+                }
                 context->mEventCb(AL_EVENT_TYPE_DISCONNECTED_SOFT, 0, 0,
                     static_cast<ALsizei>(strlen(evt.u.disconnect.msg)), evt.u.disconnect.msg,
                     context->mEventParam);
             }
         } while(evt_data.len != 0);
+
+        /* For a batch, also collect any events after the ring wraps around
+         * before delivering. Only one extra pass is made, so a steady stream
+         * of events can't hold back the batch.
+         */
+        if(batched && !quitnow && !extrapass && ring->readSpace() > 0)
+        {
+            extrapass = true;
+            continue;
+        }
+        extrapass = false;
+        if(!batch.empty())
+            batch.deliver(context);
+
+        if(const uint dropped{context->mEventsDropped.exchange(0u, std::memory_order_relaxed)})
+            WARN("%u async event%s dropped, event ring full\n", dropped, (dropped==1)?"":"s");
     }
     return 0;
 }
 
+} // namespace
+
 void StartEventThrd(ALCcontext *ctx)
 {
     try {
@@ -151,6 +283,32 @@ void StopEventThrd(ALCcontext *ctx)
         ctx->mEventThread.join();
 }
 
+bool GrowEventRing(ALCcontext *ctx, const size_t numevents)
+{
+    /* The event thread may be waiting on the app in a callback, which may in
+     * turn be waiting on the caller, so don't wait for the thread to finish
+     * with the old ring. Instead, queue a switch to the new ring after any
+     * remaining events, and the thread frees the old one when it gets there.
+     */
+    RingBuffer *ring{ctx->mAsyncEvents.get()};
+    auto evt_data = ring->getWriteVector().first;
+    if(evt_data.len == 0 || !ctx->mEventThread.joinable())
+        return false;
+
+    RingBufferPtr newring{RingBuffer::Create(numevents, sizeof(AsyncEvent), false)};
+    auto *evt = al::construct_at(reinterpret_cast<AsyncEvent*>(evt_data.buf),
+        AsyncEvent::SwitchEventRing);
+    evt->u.mRing = newring.get();
+
+    /* Writers must use the new ring before the thread can free the old one. */
+    ctx->mAsyncEvents.release();
+    ctx->mAsyncEvents = std::move(newring);
+    ring->writeAdvance(1);
+    ctx->mEventSem.post();
+
+    return true;
+}
+
 AL_API void AL_APIENTRY alEventControlSOFT(ALsizei count, const ALenum *types, ALboolean enable)
 START_API_FUNC
 {
@@ -218,3 +376,16 @@ START_API_FUNC
     context->mEventParam = userParam;
 }
 END_API_FUNC
+
+AL_API void AL_APIENTRY alEventBatchCallbackSOFT(ALEVENTBATCHPROCSOFT callback, void *userParam)
+START_API_FUNC
+{
+    ContextRef context{GetContextRef()};
+    if(unlikely(!context)) return;
+
+    std::lock_guard<std::mutex> _{context->mPropLock};
+    std::lock_guard<std::mutex> __{context->mEventCbLock};
+    context->mEventBatchCb = callback;
+    context->mEventBatchParam = userParam;
+}
+END_API_FUNC
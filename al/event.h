@@ -1,9 +1,16 @@
 #ifndef AL_EVENT_H
 #define AL_EVENT_H
 
+#include <stddef.h>
+
 struct ALCcontext;
 
 void StartEventThrd(ALCcontext *ctx);
 void StopEventThrd(ALCcontext *ctx);
 
+/* Replaces the context's event ring with a larger one, if there's room to
+ * queue the switch. Nothing else may be writing events.
+ */
+bool GrowEventRing(ALCcontext *ctx, const size_t numevents);
+
 #endif
@@ -151,6 +151,8 @@ void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context
     props->Radius = source->Radius;
     props->EnhWidth = source->EnhWidth;
 
+    props->Priority = source->mPriority;
+
     props->Direct.Gain = source->Direct.Gain;
     props->Direct.GainHF = source->Direct.GainHF;
     props->Direct.HFReference = source->Direct.HFReference;
@@ -536,6 +538,18 @@ VoiceChange *GetVoiceChanger(ALCcontext *ctx)
     return vchg;
 }
 
+/* Waits for the mixer to be done with voices that were changed asynchronously,
+ * so source queues and buffers they reference can be released.
+ */
+void SyncVoiceChanges(ALCcontext *ctx)
+{
+    if(ctx->mVoiceChangesUnsynced)
+    {
+        ctx->mALDevice->waitForMix();
+        ctx->mVoiceChangesUnsynced = false;
+    }
+}
+
 void SendVoiceChanges(ALCcontext *ctx, VoiceChange *tail)
 {
     ALCdevice *device{ctx->mALDevice.get()};
@@ -546,7 +560,16 @@ void SendVoiceChanges(ALCcontext *ctx, VoiceChange *tail)
     oldhead->mNext.store(tail, std::memory_order_release);
 
     const bool connected{device->Connected.load(std::memory_order_acquire)};
+    if(ctx->mAsyncVoiceChanges && likely(connected))
+    {
+        /* Let the mixer pick up the changes on its own time. A wait is still
+         * needed before releasing anything the current mix may be using.
+         */
+        ctx->mVoiceChangesUnsynced = true;
+        return;
+    }
     device->waitForMix();
+    ctx->mVoiceChangesUnsynced = false;
     if UNLIKELY(!connected)
     {
         if(ctx->mStopVoicesOnDisconnect.load(std::memory_order_acquire))
@@ -747,6 +770,7 @@ void FreeSource(ALCcontext *context, ALsource *source)
 
         SendVoiceChanges(context, vchg);
     }
+    SyncVoiceChanges(context);
 
     al::destroy_at(source);
 
@@ -976,6 +1000,9 @@ enum SourceProp : ALenum {
     /* AL_SOFT_UHJ */
     srcStereoMode = AL_STEREO_MODE_SOFT,
     srcSuperStereoWidth = AL_SUPER_STEREO_WIDTH_SOFT,
+
+    /* AL_SOFT_source_priority */
+    srcPriority = AL_SOURCE_PRIORITY_SOFT,
 };
 
 
@@ -1021,6 +1048,7 @@ ALuint FloatValsByProp(ALenum prop)
     case AL_SEC_LENGTH_SOFT:
     case AL_STEREO_MODE_SOFT:
     case AL_SUPER_STEREO_WIDTH_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         return 1;
 
     case AL_STEREO_ANGLES:
@@ -1088,6 +1116,7 @@ ALuint DoubleValsByProp(ALenum prop)
     case AL_SEC_LENGTH_SOFT:
     case AL_STEREO_MODE_SOFT:
     case AL_SUPER_STEREO_WIDTH_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         return 1;
 
     case AL_SEC_OFFSET_LATENCY_SOFT:
@@ -1114,6 +1143,79 @@ ALuint DoubleValsByProp(ALenum prop)
     return 0;
 }
 
+/* Checks a record for alSourcePropsfvSOFT without applying it, setting an
+ * error and returning false if it's not a batchable property or has a value
+ * out of range. Only the float properties set directly by SetSourcefv are
+ * batchable, since anything else could fail depending on the source's state.
+ */
+bool CheckSourcePropRecord(ALCcontext *context, const ALsourcepropSOFT &record)
+{
+    const float *values{record.values};
+    auto all_finite = [values](size_t count) -> bool
+    {
+        return std::all_of(values, values+count,
+            [](const float val) -> bool { return std::isfinite(val); });
+    };
+
+    bool valid{};
+    switch(static_cast<SourceProp>(record.param))
+    {
+    case AL_PITCH:
+    case AL_GAIN:
+    case AL_MIN_GAIN:
+    case AL_MAX_GAIN:
+    case AL_MAX_DISTANCE:
+    case AL_ROLLOFF_FACTOR:
+    case AL_REFERENCE_DISTANCE:
+        valid = values[0] >= 0.0f;
+        break;
+
+    case AL_CONE_INNER_ANGLE:
+    case AL_CONE_OUTER_ANGLE:
+        valid = values[0] >= 0.0f && values[0] <= 360.0f;
+        break;
+
+    case AL_CONE_OUTER_GAIN:
+    case AL_CONE_OUTER_GAINHF:
+    case AL_DOPPLER_FACTOR:
+    case AL_SUPER_STEREO_WIDTH_SOFT:
+        valid = values[0] >= 0.0f && values[0] <= 1.0f;
+        break;
+
+    case AL_AIR_ABSORPTION_FACTOR:
+    case AL_ROOM_ROLLOFF_FACTOR:
+        valid = values[0] >= 0.0f && values[0] <= 10.0f;
+        break;
+
+    case AL_SOURCE_RADIUS:
+        valid = values[0] >= 0.0f && std::isfinite(values[0]);
+        break;
+
+    case AL_STEREO_ANGLES:
+        valid = all_finite(2);
+        break;
+
+    case AL_POSITION:
+    case AL_VELOCITY:
+    case AL_DIRECTION:
+        valid = all_finite(3);
+        break;
+
+    case AL_ORIENTATION:
+        valid = all_finite(6);
+        break;
+
+    default:
+        context->setError(AL_INVALID_ENUM, "Invalid batched source property 0x%04x",
+            record.param);
+        return false;
+    }
+    if UNLIKELY(!valid)
+        context->setError(AL_INVALID_VALUE, "Batched source property 0x%04x out of range",
+            record.param);
+    return valid;
+}
+
 
 void SetSourcefv(ALsource *Source, ALCcontext *Context, SourceProp prop, const al::span<const float> values);
 void SetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop, const al::span<const int> values);
@@ -1375,6 +1477,7 @@ void SetSourcefv(ALsource *Source, ALCcontext *Context, SourceProp prop,
     case AL_BYTE_LENGTH_SOFT:
     case AL_SAMPLE_LENGTH_SOFT:
     case AL_STEREO_MODE_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         CHECKSIZE(values, 1);
         ival = static_cast<int>(values[0]);
         return SetSourceiv(Source, Context, prop, {&ival, 1u});
@@ -1476,6 +1579,9 @@ void SetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop,
             newlist.back().mLoopStart = buffer->mLoopStart;
             newlist.back().mLoopEnd = buffer->mLoopEnd;
             newlist.back().mSamples = buffer->mData.data();
+            UseBufferCache(device, buffer);
+            newlist.back().mPlanarSamples = buffer->planarSamples();
+            newlist.back().mPlanarStride = buffer->mFloatStride;
             newlist.back().mBuffer = buffer;
             IncrementRef(buffer->ref);
 
@@ -1492,6 +1598,7 @@ void SetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop,
         }
 
         /* Delete all elements in the previous queue */
+        SyncVoiceChanges(Context);
         for(auto &item : oldlist)
         {
             if(ALbuffer *buffer{item.mBuffer})
@@ -1621,6 +1728,11 @@ void SetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop,
             values[0]);
         return;
 
+    case AL_SOURCE_PRIORITY_SOFT:
+        CHECKSIZE(values, 1);
+        Source->mPriority = values[0];
+        return UpdateSourceProps(Source, Context);
+
     case AL_AUXILIARY_SEND_FILTER:
         CHECKSIZE(values, 3);
         slotlock = std::unique_lock<std::mutex>{Context->mEffectSlotLock};
@@ -1770,6 +1882,7 @@ void SetSourcei64v(ALsource *Source, ALCcontext *Context, SourceProp prop,
     case AL_SOURCE_RESAMPLER_SOFT:
     case AL_SOURCE_SPATIALIZE_SOFT:
     case AL_STEREO_MODE_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         CHECKSIZE(values, 1);
         CHECKVAL(values[0] <= INT_MAX && values[0] >= INT_MIN);
 
@@ -2050,6 +2163,7 @@ bool GetSourcedv(ALsource *Source, ALCcontext *Context, SourceProp prop, const a
     case AL_SOURCE_RESAMPLER_SOFT:
     case AL_SOURCE_SPATIALIZE_SOFT:
     case AL_STEREO_MODE_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         CHECKSIZE(values, 1);
         if((err=GetSourceiv(Source, Context, prop, {ivals, 1u})) != false)
             values[0] = static_cast<double>(ivals[0]);
@@ -2186,6 +2300,11 @@ bool GetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop, const a
         values[0] = EnumFromStereoMode(Source->mStereoMode);
         return true;
 
+    case AL_SOURCE_PRIORITY_SOFT:
+        CHECKSIZE(values, 1);
+        values[0] = Source->mPriority;
+        return true;
+
     /* 1x float/double */
     case AL_CONE_INNER_ANGLE:
     case AL_CONE_OUTER_ANGLE:
@@ -2370,6 +2489,7 @@ bool GetSourcei64v(ALsource *Source, ALCcontext *Context, SourceProp prop, const
     case AL_SOURCE_RESAMPLER_SOFT:
     case AL_SOURCE_SPATIALIZE_SOFT:
     case AL_STEREO_MODE_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         CHECKSIZE(values, 1);
         if((err=GetSourceiv(Source, Context, prop, {ivals, 1u})) != false)
             values[0] = ivals[0];
@@ -2578,6 +2698,56 @@ START_API_FUNC
 }
 END_API_FUNC
 
+AL_API void AL_APIENTRY alSourcePropsfvSOFT(ALsizei count, const ALsourcepropSOFT *props)
+START_API_FUNC
+{
+    ContextRef context{GetContextRef()};
+    if UNLIKELY(!context) return;
+
+    if UNLIKELY(count < 0)
+        context->setError(AL_INVALID_VALUE, "Setting %d source properties", count);
+    if UNLIKELY(count <= 0) return;
+    if UNLIKELY(!props)
+        return context->setError(AL_INVALID_VALUE, "NULL pointer");
+
+    const al::span<const ALsourcepropSOFT> records{props, static_cast<ALuint>(count)};
+
+    std::lock_guard<std::mutex> _{context->mPropLock};
+    std::lock_guard<std::mutex> __{context->mSourceLock};
+    /* Check every record before applying any, so an error leaves all the
+     * sources unchanged.
+     */
+    for(const ALsourcepropSOFT &record : records)
+    {
+        if UNLIKELY(!LookupSource(context.get(), record.source))
+            return context->setError(AL_INVALID_NAME, "Invalid source ID %u", record.source);
+        if UNLIKELY(!CheckSourcePropRecord(context.get(), record))
+            return;
+    }
+
+    /* Apply the properties as if updates were deferred, so each source only
+     * gets marked dirty. Sources are then updated once each, rather than once
+     * per property.
+     */
+    const bool deferring{std::exchange(context->mDeferUpdates, true)};
+    for(const ALsourcepropSOFT &record : records)
+    {
+        ALsource *source{LookupSource(context.get(), record.source)};
+        SetSourcefv(source, context.get(), static_cast<SourceProp>(record.param),
+            {record.values, MaxValues});
+    }
+    context->mDeferUpdates = deferring;
+    if(deferring) return;
+
+    for(const ALsourcepropSOFT &record : records)
+    {
+        ALsource *source{LookupSource(context.get(), record.source)};
+        if(std::exchange(source->mPropsDirty, false))
+            CommitAndUpdateSourceProps(source, context.get());
+    }
+}
+END_API_FUNC
+
 
 AL_API void AL_APIENTRY alSourcedSOFT(ALuint source, ALenum param, ALdouble value)
 START_API_FUNC
@@ -3470,6 +3640,9 @@ START_API_FUNC
         BufferList->mSampleLen = buffer->mSampleLen;
         BufferList->mLoopEnd = buffer->mSampleLen;
         BufferList->mSamples = buffer->mData.data();
+        UseBufferCache(device, buffer);
+        BufferList->mPlanarSamples = buffer->planarSamples();
+        BufferList->mPlanarStride = buffer->mFloatStride;
         BufferList->mBuffer = buffer;
         IncrementRef(buffer->ref);
 
@@ -3565,6 +3738,7 @@ START_API_FUNC
         SETERR_RETURN(context, AL_INVALID_VALUE,, "Unqueueing %d buffer%s (only %u processed)",
             nb, (nb==1)?"":"s", processed);
 
+    SyncVoiceChanges(context.get());
     do {
         auto &head = source->mQueue.front();
         if(ALbuffer *buffer{head.mBuffer})
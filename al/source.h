@@ -86,6 +86,7 @@ struct ALsource {
     DirectMode DirectChannels{DirectMode::Off};
     SpatializeMode mSpatialize{SpatializeMode::Auto};
     SourceStereo mStereoMode{SourceStereo::Normal};
+    int mPriority{0};
 
     bool DryGainHFAuto{true};
     bool WetGainAuto{true};
@@ -174,6 +174,13 @@ START_API_FUNC
         context->setError(AL_INVALID_OPERATION, "Re-enabling AL_STOP_SOURCES_ON_DISCONNECT_SOFT not yet supported");
         break;
 
+    case AL_ASYNC_VOICE_CHANGES_SOFT:
+        {
+            std::lock_guard<std::mutex> _{context->mSourceLock};
+            context->mAsyncVoiceChanges = true;
+        }
+        break;
+
     default:
         context->setError(AL_INVALID_VALUE, "Invalid enable property 0x%04x", capability);
     }
@@ -200,6 +207,13 @@ START_API_FUNC
         context->mStopVoicesOnDisconnect = false;
         break;
 
+    case AL_ASYNC_VOICE_CHANGES_SOFT:
+        {
+            std::lock_guard<std::mutex> _{context->mSourceLock};
+            context->mAsyncVoiceChanges = false;
+        }
+        break;
+
     default:
         context->setError(AL_INVALID_VALUE, "Invalid disable property 0x%04x", capability);
     }
@@ -224,6 +238,13 @@ START_API_FUNC
         value = context->mStopVoicesOnDisconnect ? AL_TRUE : AL_FALSE;
         break;
 
+    case AL_ASYNC_VOICE_CHANGES_SOFT:
+        {
+            std::lock_guard<std::mutex> __{context->mSourceLock};
+            value = context->mAsyncVoiceChanges ? AL_TRUE : AL_FALSE;
+        }
+        break;
+
     default:
         context->setError(AL_INVALID_VALUE, "Invalid is enabled property 0x%04x", capability);
     }
@@ -434,6 +455,14 @@ START_API_FUNC
         value = static_cast<int>(ResamplerDefault);
         break;
 
+    case AL_MIXED_VOICES_SOFT:
+        value = static_cast<int>(context->mMixedVoiceCount.load(std::memory_order_relaxed));
+        break;
+
+    case AL_VIRTUAL_VOICES_SOFT:
+        value = static_cast<int>(context->mVirtualVoiceCount.load(std::memory_order_relaxed));
+        break;
+
 #ifdef ALSOFT_EAX
 
 #define EAX_ERROR "[alGetInteger] EAX not enabled."
@@ -520,6 +549,14 @@ START_API_FUNC
         value = static_cast<ALint64SOFT>(ResamplerDefault);
         break;
 
+    case AL_MIXED_VOICES_SOFT:
+        value = context->mMixedVoiceCount.load(std::memory_order_relaxed);
+        break;
+
+    case AL_VIRTUAL_VOICES_SOFT:
+        value = context->mVirtualVoiceCount.load(std::memory_order_relaxed);
+        break;
+
     default:
         context->setError(AL_INVALID_VALUE, "Invalid integer64 property 0x%04x", pname);
     }
@@ -668,6 +705,8 @@ START_API_FUNC
             case AL_GAIN_LIMIT_SOFT:
             case AL_NUM_RESAMPLERS_SOFT:
             case AL_DEFAULT_RESAMPLER_SOFT:
+            case AL_MIXED_VOICES_SOFT:
+            case AL_VIRTUAL_VOICES_SOFT:
                 values[0] = alGetInteger(pname);
                 return;
         }
@@ -701,6 +740,8 @@ START_API_FUNC
             case AL_GAIN_LIMIT_SOFT:
             case AL_NUM_RESAMPLERS_SOFT:
             case AL_DEFAULT_RESAMPLER_SOFT:
+            case AL_MIXED_VOICES_SOFT:
+            case AL_VIRTUAL_VOICES_SOFT:
                 values[0] = alGetInteger64SOFT(pname);
                 return;
         }
@@ -37,6 +37,7 @@
 #include <cinttypes>
 #include <climits>
 #include <cmath>
+#include <condition_variable>
 #include <csignal>
 #include <cstdint>
 #include <cstdio>
@@ -51,6 +52,7 @@
 #include <stddef.h>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
@@ -62,6 +64,7 @@
 #include "al/auxeffectslot.h"
 #include "al/buffer.h"
 #include "al/effect.h"
+#include "al/event.h"
 #include "al/filter.h"
 #include "al/listener.h"
 #include "al/source.h"
@@ -77,6 +80,7 @@
 #include "atomic.h"
 #include "context.h"
 #include "core/ambidefs.h"
+#include "core/async_event.h"
 #include "core/bformatdec.h"
 #include "core/bs2b.h"
 #include "core/context.h"
@@ -86,8 +90,10 @@
 #include "core/effectslot.h"
 #include "core/except.h"
 #include "core/helpers.h"
+#include "core/hrtf.h"
 #include "core/mastering.h"
 #include "core/mixer/hrtfdefs.h"
+#include "core/mixer_pool.h"
 #include "core/fpu_ctrl.h"
 #include "core/front_stablizer.h"
 #include "core/logging.h"
@@ -99,6 +105,7 @@
 #include "inprogext.h"
 #include "intrusive_ptr.h"
 #include "opthelpers.h"
+#include "ringbuffer.h"
 #include "strutils.h"
 #include "threads.h"
 #include "vector.h"
@@ -151,6 +158,9 @@
 #ifdef HAVE_SDL2
 #include "backends/sdl2.h"
 #endif
+#ifdef HAVE_SHM
+#include "backends/shm.h"
+#endif
 #ifdef HAVE_WAVE
 #include "backends/wave.h"
 #endif
@@ -190,6 +200,7 @@ namespace {
 
 using namespace std::placeholders;
 using std::chrono::seconds;
+using std::chrono::milliseconds;
 using std::chrono::nanoseconds;
 
 using voidp = void*;
@@ -199,9 +210,16 @@ using float2 = std::array<float,2>;
 /************************************************
  * Backends
  ************************************************/
+enum class BackendState : unsigned char {
+    Untried,
+    Ready,
+    Failed
+};
+
 struct BackendInfo {
     const char *name;
     BackendFactory& (*getFactory)(void);
+    BackendState state{BackendState::Untried};
 };
 
 BackendInfo BackendList[] = {
@@ -252,13 +270,36 @@ BackendInfo BackendList[] = {
 #endif
 
     { "null", NullBackendFactory::getFactory },
+#ifdef HAVE_SHM
+    { "shm", ShmBackendFactory::getFactory },
+#endif
 #ifdef HAVE_WAVE
     { "wave", WaveBackendFactory::getFactory },
 #endif
 };
 
+/* The end of the backends to use, after the drivers option is applied. */
+BackendInfo *BackendListEnd{std::end(BackendList)};
+
+/* Backends are only initialized when a device of the given type is needed, so
+ * an app that never captures won't load a capture-only backend, and none are
+ * loaded by the ALC queries that don't need a device.
+ */
+std::mutex BackendLock;
+
+/* Held while probing a backend's devices or opening one, since backends may
+ * update the same device lists for both. Probes run on their own thread (see
+ * ProbeDeviceList), so this can't rely on ListLock. When both are needed, this
+ * is taken first.
+ */
+std::mutex ProbeLock;
 BackendFactory *PlaybackFactory{};
 BackendFactory *CaptureFactory{};
+bool PlaybackFactorySearched{false};
+bool CaptureFactorySearched{false};
+
+/* How long to wait for a backend to probe its devices. */
+milliseconds ProbeTimeout{2000};
 
 
 /************************************************
@@ -452,6 +493,10 @@ const struct {
     DECL(alAuxiliaryEffectSlotPlayvSOFT),
     DECL(alAuxiliaryEffectSlotStopSOFT),
     DECL(alAuxiliaryEffectSlotStopvSOFT),
+
+    DECL(alSourcePropsfvSOFT),
+
+    DECL(alEventBatchCallbackSOFT),
 #ifdef ALSOFT_EAX
 }, eaxFunctions[] = {
     DECL(EAXGet),
@@ -545,6 +590,22 @@ constexpr struct {
     DECL(ALC_SURROUND_6_1_SOFT),
     DECL(ALC_SURROUND_7_1_SOFT),
 
+    DECL(ALC_MIX_TIMING_SOFT),
+    DECL(ALC_MIX_UPDATE_COUNT_SOFT),
+    DECL(ALC_MIX_SAMPLE_COUNT_SOFT),
+    DECL(ALC_MIX_TIME_TOTAL_SOFT),
+    DECL(ALC_MIX_TIME_MAX_SOFT),
+    DECL(ALC_MIX_TIME_PARAMS_SOFT),
+    DECL(ALC_MIX_TIME_VOICES_SOFT),
+    DECL(ALC_MIX_TIME_EFFECTS_SOFT),
+    DECL(ALC_MIX_TIME_POSTPROCESS_SOFT),
+    DECL(ALC_MIX_TIME_LIMITER_SOFT),
+    DECL(ALC_MIX_TIME_DISTANCE_COMP_SOFT),
+    DECL(ALC_MIX_TIME_DITHER_SOFT),
+    DECL(ALC_MIX_MIXED_VOICES_SOFT),
+    DECL(ALC_MIX_VIRTUAL_VOICES_SOFT),
+    DECL(ALC_MIX_MAX_MIXED_VOICES_SOFT),
+
     DECL(ALC_NO_ERROR),
     DECL(ALC_INVALID_DEVICE),
     DECL(ALC_INVALID_CONTEXT),
@@ -891,6 +952,12 @@ constexpr struct {
     DECL(AL_SUPER_STEREO_WIDTH_SOFT),
 
     DECL(AL_STOP_SOURCES_ON_DISCONNECT_SOFT),
+    DECL(AL_ASYNC_VOICE_CHANGES_SOFT),
+
+    DECL(AL_MIXED_VOICES_SOFT),
+    DECL(AL_VIRTUAL_VOICES_SOFT),
+
+    DECL(AL_SOURCE_PRIORITY_SOFT),
 
 #ifdef ALSOFT_EAX
 }, eaxEnumerations[] = {
@@ -941,6 +1008,9 @@ bool SuspendDefers{true};
 /* Initial seed for dithering. */
 constexpr uint DitherRNGSeed{22222u};
 
+/* Default memory budget for the buffers' float sample caches, in megabytes. */
+constexpr uint DefaultBufferCacheSize{0u};
+
 
 /************************************************
  * ALC information
@@ -966,6 +1036,7 @@ constexpr ALCchar alcExtensionList[] =
     "ALC_SOFT_HRTF "
     "ALC_SOFT_loopback "
     "ALC_SOFT_loopback_bformat "
+    "ALC_SOFTX_mixer_timing "
     "ALC_SOFT_output_limiter "
     "ALC_SOFT_output_mode "
     "ALC_SOFT_pause_device "
@@ -1063,6 +1134,9 @@ void alc_initconfig(void)
 #elif defined(HAVE_SSE)
     capfilter |= CPU_CAP_SSE;
 #endif
+#ifdef HAVE_AVX2
+    capfilter |= CPU_CAP_AVX2 | CPU_CAP_FMA;
+#endif
 #ifdef HAVE_NEON
     capfilter |= CPU_CAP_NEON;
 #endif
@@ -1094,6 +1168,10 @@ void alc_initconfig(void)
                     capfilter &= ~CPU_CAP_SSE3;
                 else if(len == 6 && al::strncasecmp(str, "sse4.1", len) == 0)
                     capfilter &= ~CPU_CAP_SSE4_1;
+                else if(len == 4 && al::strncasecmp(str, "avx2", len) == 0)
+                    capfilter &= ~CPU_CAP_AVX2;
+                else if(len == 3 && al::strncasecmp(str, "fma", len) == 0)
+                    capfilter &= ~CPU_CAP_FMA;
                 else if(len == 4 && al::strncasecmp(str, "neon", len) == 0)
                     capfilter &= ~CPU_CAP_NEON;
                 else
@@ -1109,11 +1187,13 @@ void alc_initconfig(void)
             TRACE("Name: \"%s\"\n", cpuopt->mName.c_str());
         }
         const int caps{cpuopt->mCaps};
-        TRACE("Extensions:%s%s%s%s%s%s\n",
+        TRACE("Extensions:%s%s%s%s%s%s%s%s\n",
             ((capfilter&CPU_CAP_SSE)    ? ((caps&CPU_CAP_SSE)    ? " +SSE"    : " -SSE")    : ""),
             ((capfilter&CPU_CAP_SSE2)   ? ((caps&CPU_CAP_SSE2)   ? " +SSE2"   : " -SSE2")   : ""),
             ((capfilter&CPU_CAP_SSE3)   ? ((caps&CPU_CAP_SSE3)   ? " +SSE3"   : " -SSE3")   : ""),
             ((capfilter&CPU_CAP_SSE4_1) ? ((caps&CPU_CAP_SSE4_1) ? " +SSE4.1" : " -SSE4.1") : ""),
+            ((capfilter&CPU_CAP_AVX2)   ? ((caps&CPU_CAP_AVX2)   ? " +AVX2"   : " -AVX2")   : ""),
+            ((capfilter&CPU_CAP_FMA)    ? ((caps&CPU_CAP_FMA)    ? " +FMA"    : " -FMA")    : ""),
             ((capfilter&CPU_CAP_NEON)   ? ((caps&CPU_CAP_NEON)   ? " +NEON"   : " -NEON")   : ""),
             ((!capfilter) ? " -none-" : ""));
         CPUCapFlags = caps & capfilter;
@@ -1124,6 +1204,11 @@ void alc_initconfig(void)
     if(auto limopt = ConfigValueBool(nullptr, nullptr, "rt-time-limit"))
         AllowRTTimeLimit = *limopt;
 
+    if(!GetConfigValueBool(nullptr, nullptr, "hrtf-cache", false))
+        HrtfCachePath.clear();
+    else if(auto cacheopt = ConfigValueStr(nullptr, nullptr, "hrtf-cache-path"))
+        HrtfCachePath = *cacheopt;
+
     {
         CompatFlagBitset compatflags{};
         auto checkflag = [](const char *envname, const char *optname) -> bool
@@ -1184,8 +1269,19 @@ void alc_initconfig(void)
         const float valf{std::isfinite(*boostopt) ? clampf(*boostopt, -24.0f, 24.0f) : 0.0f};
         ReverbBoost *= std::pow(10.0f, valf / 20.0f);
     }
+    if(auto lateopt = ConfigValueStr(nullptr, "reverb", "late-rate"))
+    {
+        const char *rate{lateopt->c_str()};
+        if(al::strcasecmp(rate, "full") == 0)
+            ReverbLateDecimation = 1;
+        else if(al::strcasecmp(rate, "quarter") == 0)
+            ReverbLateDecimation = 4;
+        else
+            ERR("Unhandled reverb late-rate: \"%s\"\n", rate);
+    }
+
+    ConvolutionTailThread = !!GetConfigValueBool(nullptr, "convolution", "tail-thread", false);
 
-    auto BackendListEnd = std::end(BackendList);
     auto devopt = al::getenv("ALSOFT_DRIVERS");
     if(devopt || (devopt=ConfigValueStr(nullptr, nullptr, "drivers")))
     {
@@ -1240,38 +1336,10 @@ void alc_initconfig(void)
             BackendListEnd = backendlist_cur;
     }
 
-    auto init_backend = [](BackendInfo &backend) -> void
-    {
-        if(PlaybackFactory && CaptureFactory)
-            return;
-
-        BackendFactory &factory = backend.getFactory();
-        if(!factory.init())
-        {
-            WARN("Failed to initialize backend \"%s\"\n", backend.name);
-            return;
-        }
-
-        TRACE("Initialized backend \"%s\"\n", backend.name);
-        if(!PlaybackFactory && factory.querySupport(BackendType::Playback))
-        {
-            PlaybackFactory = &factory;
-            TRACE("Added \"%s\" for playback\n", backend.name);
-        }
-        if(!CaptureFactory && factory.querySupport(BackendType::Capture))
-        {
-            CaptureFactory = &factory;
-            TRACE("Added \"%s\" for capture\n", backend.name);
-        }
-    };
-    std::for_each(std::begin(BackendList), BackendListEnd, init_backend);
-
     LoopbackBackendFactory::getFactory().init();
 
-    if(!PlaybackFactory)
-        WARN("No playback backend available!\n");
-    if(!CaptureFactory)
-        WARN("No capture backend available!\n");
+    if(auto timeoutopt = ConfigValueUInt(nullptr, nullptr, "probe-timeout"))
+        ProbeTimeout = milliseconds{*timeoutopt};
 
     if(auto exclopt = ConfigValueStr(nullptr, nullptr, "excludefx"))
     {
@@ -1328,33 +1396,202 @@ inline void InitConfig()
 { std::call_once(alc_config_once, [](){alc_initconfig();}); }
 
 
+/* Gets the factory to use for the given device type, initializing backends in
+ * order until one supports it. Each backend is only initialized once, even
+ * if it's tried for both types.
+ */
+BackendFactory *GetBackendFactory(BackendType type)
+{
+    InitConfig();
+
+    const bool playback{type == BackendType::Playback};
+    std::lock_guard<std::mutex> _{BackendLock};
+    BackendFactory *&factory = playback ? PlaybackFactory : CaptureFactory;
+    bool &searched = playback ? PlaybackFactorySearched : CaptureFactorySearched;
+    if(searched)
+        return factory;
+    searched = true;
+
+    for(auto backend = std::begin(BackendList);backend != BackendListEnd;++backend)
+    {
+        BackendFactory &curfactory = backend->getFactory();
+        if(backend->state == BackendState::Untried)
+        {
+            if(!curfactory.init())
+            {
+                WARN("Failed to initialize backend \"%s\"\n", backend->name);
+                backend->state = BackendState::Failed;
+                continue;
+            }
+            TRACE("Initialized backend \"%s\"\n", backend->name);
+            backend->state = BackendState::Ready;
+        }
+        if(backend->state != BackendState::Ready || !curfactory.querySupport(type))
+            continue;
+
+        factory = &curfactory;
+        TRACE("Added \"%s\" for %s\n", backend->name, playback ? "playback" : "capture");
+        break;
+    }
+    if(!factory)
+        WARN("No %s backend available!\n", playback ? "playback" : "capture");
+
+    return factory;
+}
+
+
 /************************************************
  * Device enumeration
  ************************************************/
+/* The device names most recently probed from a backend. These are kept until
+ * the backend reports its devices changed, or for a short time if it can't
+ * report changes, so repeated enumeration queries don't reprobe the backend
+ * each time.
+ */
+struct DeviceListCache {
+    std::mutex mMutex;
+    std::condition_variable mCond;
+
+    bool mProbing{false};
+    bool mValid{false};
+    al::optional<uint> mVersion;
+    std::chrono::steady_clock::time_point mTime;
+    std::string mNames;
+
+    std::thread mThread;
+};
+
+/* Cleans up a cache at exit, giving a probe that's still running up to the
+ * probe timeout to get out of the backend before the backend is cleaned up.
+ * If it's still stuck after that, the thread is detached and the cache is
+ * left for it so the process can exit.
+ */
+struct DeviceListCacheDeleter {
+    void operator()(DeviceListCache *cache) const
+    {
+        std::unique_lock<std::mutex> cachelock{cache->mMutex};
+        auto probe_done = [cache]() noexcept -> bool { return !cache->mProbing; };
+        if(ProbeTimeout.count() == 0)
+            cache->mCond.wait(cachelock, probe_done);
+        else if(!cache->mCond.wait_for(cachelock, ProbeTimeout, probe_done))
+        {
+            WARN("Device probe still running at exit, detaching it\n");
+            cache->mThread.detach();
+            return;
+        }
+        cachelock.unlock();
+
+        if(cache->mThread.joinable())
+            cache->mThread.join();
+        delete cache;
+    }
+};
+using DeviceListCachePtr = std::unique_ptr<DeviceListCache,DeviceListCacheDeleter>;
+
+/* The caches are created on first use, after the factory they probe, so they
+ * are cleaned up before the backends are.
+ */
+DeviceListCache &GetPlaybackListCache()
+{
+    static DeviceListCachePtr cache{new DeviceListCache{}};
+    return *cache;
+}
+DeviceListCache &GetCaptureListCache()
+{
+    static DeviceListCachePtr cache{new DeviceListCache{}};
+    return *cache;
+}
+
+constexpr seconds DeviceListCacheTime{1};
+
+std::string ProbeDeviceList(BackendFactory *factory, const BackendType type,
+    DeviceListCache &cache)
+{
+    std::unique_lock<std::mutex> cachelock{cache.mMutex};
+    if(cache.mValid && !cache.mProbing)
+    {
+        const al::optional<uint> version{factory->deviceListVersion()};
+        if(version ? (cache.mVersion && *cache.mVersion == *version)
+            : (std::chrono::steady_clock::now()-cache.mTime < DeviceListCacheTime))
+            return cache.mNames;
+    }
+
+    if(!cache.mProbing)
+    {
+        /* Probe on a separate thread, so a backend that stalls while probing
+         * only holds up the caller for the probe timeout. A probe that takes
+         * longer still updates the cache for the next query once it finishes.
+         */
+        auto do_probe = [factory,type,&cache]() -> void
+        {
+            std::unique_lock<std::mutex> probelock{ProbeLock};
+            const al::optional<uint> version{factory->deviceListVersion()};
+            std::string names{factory->probe(type)};
+            probelock.unlock();
+
+            std::lock_guard<std::mutex> _{cache.mMutex};
+            cache.mNames = std::move(names);
+            cache.mVersion = version;
+            cache.mTime = std::chrono::steady_clock::now();
+            cache.mValid = true;
+            cache.mProbing = false;
+            cache.mCond.notify_all();
+        };
+
+        cache.mProbing = true;
+        /* The previous probe has finished with the cache, so this won't wait
+         * long.
+         */
+        if(cache.mThread.joinable())
+            cache.mThread.join();
+        try {
+            cache.mThread = std::thread{do_probe};
+        }
+        catch(std::exception& e) {
+            ERR("Failed to start device probe thread: %s\n", e.what());
+            cachelock.unlock();
+            do_probe();
+            cachelock.lock();
+        }
+    }
+
+    auto probe_done = [&cache]() noexcept -> bool { return !cache.mProbing; };
+    if(ProbeTimeout.count() == 0)
+        cache.mCond.wait(cachelock, probe_done);
+    else if(!cache.mCond.wait_for(cachelock, ProbeTimeout, probe_done))
+        WARN("Timed out probing %s devices, using %s list\n",
+            (type == BackendType::Playback) ? "playback" : "capture",
+            cache.mValid ? "the previous" : "an empty");
+
+    return cache.mNames;
+}
+
 void ProbeAllDevicesList()
 {
-    InitConfig();
+    BackendFactory *factory{GetBackendFactory(BackendType::Playback)};
 
     std::lock_guard<std::recursive_mutex> _{ListLock};
-    if(!PlaybackFactory)
+    if(!factory)
         decltype(alcAllDevicesList){}.swap(alcAllDevicesList);
     else
     {
-        std::string names{PlaybackFactory->probe(BackendType::Playback)};
+        std::string names{ProbeDeviceList(factory, BackendType::Playback,
+            GetPlaybackListCache())};
         if(names.empty()) names += '\0';
         names.swap(alcAllDevicesList);
     }
 }
 void ProbeCaptureDeviceList()
 {
-    InitConfig();
+    BackendFactory *factory{GetBackendFactory(BackendType::Capture)};
 
     std::lock_guard<std::recursive_mutex> _{ListLock};
-    if(!CaptureFactory)
+    if(!factory)
         decltype(alcCaptureDeviceList){}.swap(alcCaptureDeviceList);
     else
     {
-        std::string names{CaptureFactory->probe(BackendType::Capture)};
+        std::string names{ProbeDeviceList(factory, BackendType::Capture,
+            GetCaptureListCache())};
         if(names.empty()) names += '\0';
         names.swap(alcCaptureDeviceList);
     }
@@ -1594,7 +1831,7 @@ static inline void UpdateClockBase(ALCdevice *device)
     IncrementRef(device->MixCount);
     device->ClockBase += nanoseconds{seconds{device->SamplesDone}} / device->Frequency;
     device->SamplesDone = 0;
-    IncrementRef(device->MixCount);
+    device->finishMix();
 }
 
 /**
@@ -1865,6 +2102,7 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     device->PostProcess = nullptr;
 
     device->Limiter = nullptr;
+    device->mMixerPool = nullptr;
     device->ChannelDelays = nullptr;
 
     std::fill(std::begin(device->HrtfAccumData), std::end(device->HrtfAccumData), float2{});
@@ -2216,11 +2454,41 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     device->FixedLatency += nanoseconds{seconds{sample_delay}} / device->Frequency;
     TRACE("Fixed device latency: %" PRId64 "ns\n", int64_t{device->FixedLatency.count()});
 
+    device->mTimeMixer = device->getConfigValueBool(nullptr, "mixer-timing", false);
+    if(device->mTimeMixer)
+        TRACE("Mixer timing enabled\n");
+
+    /* The number of events each event ring needs room for. */
+    const size_t numevents{EventRingSize(device->NumMonoSources + device->NumStereoSources)};
+
+    if(auto threadsopt = device->configValue<uint>(nullptr, "mixer-threads"))
+    {
+        const uint numthreads{clampu(*threadsopt, 1u, MaxMixerThreads)};
+        if(numthreads > 1)
+        {
+            try {
+                device->mMixerPool = std::make_unique<MixerPool>(device, numthreads-1,
+                    numevents);
+            }
+            catch(std::exception &e) {
+                ERR("Failed to start mixer worker threads: %s\n", e.what());
+            }
+        }
+    }
+
     FPUCtl mixer_mode{};
     for(ContextBase *ctxbase : *device->mContexts.load())
     {
         auto *context = static_cast<ALCcontext*>(ctxbase);
 
+        /* Grow the event ring if the device's sources won't fit. The mixer is
+         * stopped, so nothing else is writing events. If the old ring is full,
+         * it's kept until a later reset.
+         */
+        if(context->mAsyncEvents->getCapacity() < numevents
+            && !GrowEventRing(context, numevents))
+            WARN("Failed to grow event ring to %zu events\n", numevents);
+
         auto GetEffectBuffer = [](ALbuffer *buffer) noexcept -> EffectState::Buffer
         {
             if(!buffer) return EffectState::Buffer{};
@@ -2448,6 +2716,43 @@ ContextRef VerifyContext(ALCcontext *context)
     return nullptr;
 }
 
+
+/**
+ * Gets the given mixer timing counter of the device. The counters are atomic
+ * and only written by the mixer, so this doesn't need the device lock.
+ */
+al::optional<int64_t> GetMixTiming(ALCdevice *device, ALCenum param) noexcept
+{
+    const MixTimings &times = device->mMixTimes;
+    auto stage_time = [&times](MixStage stage) noexcept -> int64_t
+    {
+        const auto &counter = times.StageTime[static_cast<size_t>(stage)];
+        return static_cast<int64_t>(counter.load(std::memory_order_relaxed));
+    };
+    auto value = [](const auto &counter) noexcept -> int64_t
+    { return static_cast<int64_t>(counter.load(std::memory_order_relaxed)); };
+
+    switch(param)
+    {
+    case ALC_MIX_TIMING_SOFT: return device->mTimeMixer ? ALC_TRUE : ALC_FALSE;
+    case ALC_MIX_UPDATE_COUNT_SOFT: return value(times.Updates);
+    case ALC_MIX_SAMPLE_COUNT_SOFT: return value(times.Samples);
+    case ALC_MIX_TIME_TOTAL_SOFT: return value(times.TotalTime);
+    case ALC_MIX_TIME_MAX_SOFT: return value(times.MaxUpdateTime);
+    case ALC_MIX_TIME_PARAMS_SOFT: return stage_time(MixStage::Params);
+    case ALC_MIX_TIME_VOICES_SOFT: return stage_time(MixStage::Voices);
+    case ALC_MIX_TIME_EFFECTS_SOFT: return stage_time(MixStage::Effects);
+    case ALC_MIX_TIME_POSTPROCESS_SOFT: return stage_time(MixStage::PostProcess);
+    case ALC_MIX_TIME_LIMITER_SOFT: return stage_time(MixStage::Limiter);
+    case ALC_MIX_TIME_DISTANCE_COMP_SOFT: return stage_time(MixStage::DistanceComp);
+    case ALC_MIX_TIME_DITHER_SOFT: return stage_time(MixStage::Dither);
+    case ALC_MIX_MIXED_VOICES_SOFT: return value(times.MixedVoices);
+    case ALC_MIX_VIRTUAL_VOICES_SOFT: return value(times.VirtualVoices);
+    case ALC_MIX_MAX_MIXED_VOICES_SOFT: return value(times.MaxMixedVoices);
+    }
+    return al::nullopt;
+}
+
 } // namespace
 
 /** Returns a new reference to the currently active context for this thread. */
@@ -2987,6 +3292,12 @@ START_API_FUNC
         return;
     }
     /* render device */
+    if(auto timing = GetMixTiming(dev.get(), pname))
+    {
+        *values = *timing;
+        return;
+    }
+
     auto NumAttrsForDevice = [](ALCdevice *aldev) noexcept
     {
         if(aldev->Type == DeviceType::Loopback && aldev->FmtChans == DevFmtAmbi3D)
@@ -3240,6 +3551,11 @@ START_API_FUNC
             TRACE("volume-adjust gain: %f\n", context->mGainBoost);
         }
     }
+    if(auto limitopt = dev->configValue<uint>(nullptr, "voice-limit"))
+    {
+        context->mVoiceLimit = *limitopt;
+        TRACE("Voice limit: %u\n", context->mVoiceLimit);
+    }
 
     {
         using ContextArray = al::FlexArray<ContextBase*>;
@@ -3408,9 +3724,8 @@ END_API_FUNC
 ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *deviceName)
 START_API_FUNC
 {
-    InitConfig();
-
-    if(!PlaybackFactory)
+    BackendFactory *factory{GetBackendFactory(BackendType::Playback)};
+    if(!factory)
     {
         alcSetError(nullptr, ALC_INVALID_VALUE);
         return nullptr;
@@ -3458,7 +3773,11 @@ START_API_FUNC
     device->NumAuxSends = DefaultSends;
 
     try {
-        auto backend = PlaybackFactory->createBackend(device.get(), BackendType::Playback);
+        auto backend = factory->createBackend(device.get(), BackendType::Playback);
+        /* Wait for any device probe before taking the list lock, so a stalled
+         * probe doesn't hold up every other call that needs it.
+         */
+        std::lock_guard<std::mutex> probelock{ProbeLock};
         std::lock_guard<std::recursive_mutex> _{ListLock};
         backend->open(deviceName);
         device->Backend = std::move(backend);
@@ -3491,6 +3810,9 @@ START_API_FUNC
     if(auto slotsmax = device->configValue<uint>(nullptr, "slots").value_or(0))
         device->AuxiliaryEffectSlotMax = minu(slotsmax, INT_MAX);
 
+    device->mBufferCacheBudget = size_t{device->configValue<uint>(nullptr, "buffer-cache-size")
+        .value_or(DefaultBufferCacheSize)} << 20;
+
     if(auto sendsopt = device->configValue<int>(nullptr, "sends"))
     {
         const int max_sends{clampi(*sendsopt, 0, MAX_SENDS)};
@@ -3568,9 +3890,8 @@ END_API_FUNC
 ALC_API ALCdevice* ALC_APIENTRY alcCaptureOpenDevice(const ALCchar *deviceName, ALCuint frequency, ALCenum format, ALCsizei samples)
 START_API_FUNC
 {
-    InitConfig();
-
-    if(!CaptureFactory)
+    BackendFactory *factory{GetBackendFactory(BackendType::Capture)};
+    if(!factory)
     {
         alcSetError(nullptr, ALC_INVALID_VALUE);
         return nullptr;
@@ -3613,7 +3934,11 @@ START_API_FUNC
             DevFmtChannelsString(device->FmtChans), DevFmtTypeString(device->FmtType),
             device->Frequency, device->UpdateSize, device->BufferSize);
 
-        auto backend = CaptureFactory->createBackend(device.get(), BackendType::Capture);
+        auto backend = factory->createBackend(device.get(), BackendType::Capture);
+        /* Wait for any device probe before taking the list lock, so a stalled
+         * probe doesn't hold up every other call that needs it.
+         */
+        std::lock_guard<std::mutex> probelock{ProbeLock};
         std::lock_guard<std::recursive_mutex> _{ListLock};
         backend->open(deviceName);
         device->Backend = std::move(backend);
@@ -3787,6 +4112,9 @@ START_API_FUNC
     if(auto slotsmax = ConfigValueUInt(nullptr, nullptr, "slots").value_or(0))
         device->AuxiliaryEffectSlotMax = minu(slotsmax, INT_MAX);
 
+    device->mBufferCacheBudget = size_t{ConfigValueUInt(nullptr, nullptr, "buffer-cache-size")
+        .value_or(DefaultBufferCacheSize)} << 20;
+
     if(auto sendsopt = ConfigValueInt(nullptr, nullptr, "sends"))
     {
         const int max_sends{clampi(*sendsopt, 0, MAX_SENDS)};
@@ -3987,11 +4315,16 @@ START_API_FUNC
             deviceName = nullptr;
     }
 
+    /* The probe lock has to be taken before the list lock, so a stalled
+     * device probe doesn't hold up every other call that needs the list lock.
+     */
+    std::unique_lock<std::mutex> probelock{ProbeLock};
     std::unique_lock<std::recursive_mutex> listlock{ListLock};
     DeviceRef dev{VerifyDevice(device)};
     if(!dev || dev->Type != DeviceType::Playback)
     {
         listlock.unlock();
+        probelock.unlock();
         alcSetError(dev.get(), ALC_INVALID_DEVICE);
         return ALC_FALSE;
     }
@@ -4007,11 +4340,14 @@ START_API_FUNC
 
     BackendPtr newbackend;
     try {
-        newbackend = PlaybackFactory->createBackend(dev.get(), BackendType::Playback);
+        BackendFactory *factory{GetBackendFactory(BackendType::Playback)};
+        newbackend = factory->createBackend(dev.get(), BackendType::Playback);
         newbackend->open(deviceName);
+        probelock.unlock();
     }
     catch(al::backend_exception &e) {
         listlock.unlock();
+        probelock.unlock();
         newbackend = nullptr;
 
         WARN("Failed to reopen playback device: %s\n", e.what());
@@ -36,6 +36,7 @@
 #include <limits>
 #include <memory>
 #include <new>
+#include <numeric>
 #include <stdint.h>
 #include <utility>
 
@@ -67,6 +68,8 @@
 #include "core/mixer.h"
 #include "core/mixer/defs.h"
 #include "core/mixer/hrtfdefs.h"
+#include "core/mixer/writebase.h"
+#include "core/mixer_pool.h"
 #include "core/resampler_limits.h"
 #include "core/uhjfilter.h"
 #include "core/voice.h"
@@ -89,6 +92,9 @@ struct SSE2Tag;
 #ifdef HAVE_SSE4_1
 struct SSE4Tag;
 #endif
+#ifdef HAVE_AVX2
+struct AVX2Tag;
+#endif
 #ifdef HAVE_NEON
 struct NEONTag;
 #endif
@@ -157,6 +163,10 @@ inline HrtfDirectMixerFunc SelectHrtfMixer(void)
     if((CPUCapFlags&CPU_CAP_NEON))
         return MixDirectHrtf_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2) && (CPUCapFlags&CPU_CAP_FMA))
+        return MixDirectHrtf_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return MixDirectHrtf_<SSETag>;
@@ -166,6 +176,52 @@ inline HrtfDirectMixerFunc SelectHrtfMixer(void)
 }
 
 
+/* The number of full-width frames buffered at a time for integer output.
+ * Narrower frames fit more per block.
+ */
+constexpr size_t WriteBlockFrames{64};
+
+using InterleaveFunc = void(*)(const al::span<const FloatBufferLine> InBuffer, const size_t InPos,
+    float *RESTRICT dst, const size_t FrameStep, const size_t todo);
+using ConvertFunc = void(*)(const float *RESTRICT src, void *dst, const DevFmtType type,
+    const size_t count);
+
+InterleaveFunc InterleaveSamples{Interleave_<CTag>};
+ConvertFunc ConvertSamples{ConvertSamples_<CTag>};
+
+inline InterleaveFunc SelectInterleaver()
+{
+#ifdef HAVE_NEON
+    if((CPUCapFlags&CPU_CAP_NEON))
+        return Interleave_<NEONTag>;
+#endif
+#ifdef HAVE_SSE
+    if((CPUCapFlags&CPU_CAP_SSE))
+        return Interleave_<SSETag>;
+#endif
+
+    return Interleave_<CTag>;
+}
+
+inline ConvertFunc SelectConverter()
+{
+#ifdef HAVE_NEON
+    if((CPUCapFlags&CPU_CAP_NEON))
+        return ConvertSamples_<NEONTag>;
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+        return ConvertSamples_<AVX2Tag>;
+#endif
+#ifdef HAVE_SSE2
+    if((CPUCapFlags&CPU_CAP_SSE2))
+        return ConvertSamples_<SSE2Tag>;
+#endif
+
+    return ConvertSamples_<CTag>;
+}
+
+
 inline void BsincPrepare(const uint increment, BsincState *state, const BSincTable *table)
 {
     size_t si{BSincScaleCount - 1};
@@ -200,6 +256,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
         if((CPUCapFlags&CPU_CAP_NEON))
             return Resample_<LerpTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&CPU_CAP_AVX2) && (CPUCapFlags&CPU_CAP_FMA))
+            return Resample_<LerpTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE4_1
         if((CPUCapFlags&CPU_CAP_SSE4_1))
             return Resample_<LerpTag,SSE4Tag>;
@@ -210,6 +270,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
 #endif
         return Resample_<LerpTag,CTag>;
     case Resampler::Cubic:
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&CPU_CAP_AVX2) && (CPUCapFlags&CPU_CAP_FMA))
+            return Resample_<CubicTag,AVX2Tag>;
+#endif
         return Resample_<CubicTag,CTag>;
     case Resampler::BSinc12:
     case Resampler::BSinc24:
@@ -219,6 +283,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
             if((CPUCapFlags&CPU_CAP_NEON))
                 return Resample_<BSincTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+            if((CPUCapFlags&CPU_CAP_AVX2) && (CPUCapFlags&CPU_CAP_FMA))
+                return Resample_<BSincTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
             if((CPUCapFlags&CPU_CAP_SSE))
                 return Resample_<BSincTag,SSETag>;
@@ -232,6 +300,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
         if((CPUCapFlags&CPU_CAP_NEON))
             return Resample_<FastBSincTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&CPU_CAP_AVX2) && (CPUCapFlags&CPU_CAP_FMA))
+            return Resample_<FastBSincTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
         if((CPUCapFlags&CPU_CAP_SSE))
             return Resample_<FastBSincTag,SSETag>;
@@ -247,6 +319,8 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
 void aluInit(CompatFlagBitset flags, const float nfcscale)
 {
     MixDirectHrtf = SelectHrtfMixer();
+    InterleaveSamples = SelectInterleaver();
+    ConvertSamples = SelectConverter();
     XScale = flags.test(CompatFlags::ReverseX) ? -1.0f : 1.0f;
     YScale = flags.test(CompatFlags::ReverseY) ? -1.0f : 1.0f;
     ZScale = flags.test(CompatFlags::ReverseZ) ? -1.0f : 1.0f;
@@ -1692,7 +1766,11 @@ void SendSourceStateEvent(ContextBase *context, uint id, VChangeState state)
 {
     RingBuffer *ring{context->mAsyncEvents.get()};
     auto evt_vec = ring->getWriteVector();
-    if(evt_vec.first.len < 1) return;
+    if(evt_vec.first.len < 1)
+    {
+        context->mEventsDropped.fetch_add(1u, std::memory_order_relaxed);
+        return;
+    }
 
     AsyncEvent *evt{al::construct_at(reinterpret_cast<AsyncEvent*>(evt_vec.first.buf),
         AsyncEvent::SourceStateChange)};
@@ -1837,10 +1915,125 @@ void ProcessParamUpdates(ContextBase *ctx, const EffectSlotArray &slots,
     IncrementRef(ctx->mUpdateCount);
 }
 
+/* Gets the loudest target gain of the voice's dry path and sends, as
+ * calculated for its current properties.
+ */
+float GetVoiceLevel(const Voice *voice, const uint NumSends)
+{
+    auto abs_max = [](const float cur, const float gain) noexcept -> float
+    { return maxf(cur, std::abs(gain)); };
+
+    float level{0.0f};
+    for(const auto &chandata : voice->mChans)
+    {
+        const DirectParams &dparms = chandata.mDryParams;
+        if(voice->mFlags.test(VoiceHasHrtf))
+            level = abs_max(level, dparms.Hrtf.Target.Gain);
+        else
+            level = std::accumulate(dparms.Gains.Target.cbegin(), dparms.Gains.Target.cend(),
+                level, abs_max);
+
+        for(uint send{0};send < NumSends;++send)
+        {
+            if(voice->mSend[send].Buffer.empty())
+                continue;
+            const SendParams &sparms = chandata.mWetParams[send];
+            level = std::accumulate(sparms.Gains.Target.cbegin(), sparms.Gains.Target.cend(),
+                level, abs_max);
+        }
+    }
+    return level;
+}
+
+/* Demotes the playing voices past the context's voice limit, so they fade out
+ * and stay virtual instead of being mixed. Voices are ranked by their source's
+ * priority, then by their loudest gain. Voices that are already mixing get a
+ * boost to their level, so similarly loud voices don't keep trading places.
+ * Callback voices are always mixed, and count against the limit.
+ */
+void LimitVoices(ContextBase *ctx, const al::span<Voice*> voices)
+{
+    const uint NumSends{ctx->mDevice->NumAuxSends};
+
+    /* The voice array has scratch space after it, to hold the voices being
+     * ranked.
+     */
+    ContextBase::VoiceArray &allvoices = *ctx->mVoices.load(std::memory_order_relaxed);
+    Voice **ranked{allvoices.data() + allvoices.size()};
+
+    size_t limit{ctx->mVoiceLimit};
+    size_t count{0};
+    for(Voice *voice : voices)
+    {
+        const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+        if(vstate != Voice::Playing || voice->mFlags.test(VoiceIsCallback))
+        {
+            voice->mFlags.reset(VoiceIsDemoted);
+            if(vstate == Voice::Playing)
+                limit = limit ? limit-1 : 0;
+            voice->mRank = 0;
+            continue;
+        }
+
+        float level{GetVoiceLevel(voice, NumSends)};
+        if(!voice->mFlags.test(VoiceIsDemoted))
+            level *= 2.0f;
+        /* The priority is stored in the upper 32 bits, flipping the sign bit
+         * so it sorts as unsigned, and the level as 16.16 fixed point in the
+         * lower 32 bits. Anything below the fixed point's precision is silent
+         * anyway.
+         */
+        const auto priority = static_cast<uint32_t>(voice->mProps.Priority) ^ 0x80000000u;
+        const auto fixedlevel = static_cast<uint32_t>(minf(level, 65535.0f) * 65536.0f);
+        voice->mRank = maxu64((uint64_t{priority}<<32) | fixedlevel, 1);
+        ranked[count++] = voice;
+    }
+    if(count <= limit)
+    {
+        for(Voice *voice : voices)
+            voice->mFlags.reset(VoiceIsDemoted);
+        return;
+    }
+
+    /* Partition the ranked voices so the highest ranked ones within the limit
+     * come first, which are kept while the rest are demoted.
+     */
+    const al::span<Voice*> rankspan{ranked, count};
+    if(limit > 0)
+        std::nth_element(rankspan.begin(), rankspan.begin()+(limit-1), rankspan.end(),
+            [](const Voice *lhs, const Voice *rhs) noexcept -> bool
+            { return lhs->mRank > rhs->mRank; });
+    for(Voice *voice : rankspan.first(limit))
+        voice->mFlags.reset(VoiceIsDemoted);
+    for(Voice *voice : rankspan.subspan(limit))
+        voice->mFlags.set(VoiceIsDemoted);
+}
+
+using MixClock = std::chrono::steady_clock;
+
+/* Adds the time since mark to the given stage's counter, and moves mark up to
+ * now.
+ */
+void LapMixStage(DeviceBase *device, const MixStage stage, MixClock::time_point &mark) noexcept
+{
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+
+    const MixClock::time_point now{MixClock::now()};
+    const auto elapsed = static_cast<uint64_t>(duration_cast<nanoseconds>(now - mark).count());
+    auto &counter = device->mMixTimes.StageTime[static_cast<size_t>(stage)];
+    counter.store(counter.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+    mark = now;
+}
+
 void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
 {
     ASSUME(SamplesToDo > 0);
 
+    const bool timing{device->mTimeMixer};
+    MixClock::time_point mark{timing ? MixClock::now() : MixClock::time_point{}};
+    uint total_mixed{0u}, total_virtual{0u};
+
     for(ContextBase *ctx : *device->mContexts.load(std::memory_order_acquire))
     {
         const EffectSlotArray &auxslots = *ctx->mActiveAuxSlots.load(std::memory_order_acquire);
@@ -1848,6 +2041,9 @@ void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
 
         /* Process pending propery updates for objects on the context. */
         ProcessParamUpdates(ctx, auxslots, voices);
+        if(ctx->mVoiceLimit)
+            LimitVoices(ctx, voices);
+        if(timing) LapMixStage(device, MixStage::Params, mark);
 
         /* Clear auxiliary effect slot mixing buffers. */
         for(EffectSlot *slot : auxslots)
@@ -1856,13 +2052,38 @@ void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
                 buffer.fill(0.0f);
         }
 
-        /* Process voices that have a playing source. */
+        /* Process voices that have a playing source. Split them between the
+         * mixer worker threads when there's enough to be worth it.
+         */
+        MixerPool *pool{device->mMixerPool.get()};
+        if(pool && voices.size() >= pool->threadCount()*4)
+            pool->mixVoices(ctx, voices, auxslots, SamplesToDo);
+        else
+        {
+            for(Voice *voice : voices)
+            {
+                const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+                if(vstate != Voice::Stopped && vstate != Voice::Pending)
+                    voice->mix(vstate, ctx, *device, SamplesToDo);
+            }
+        }
+
+        uint mixed_voices{0u}, virtual_voices{0u};
         for(Voice *voice : voices)
         {
-            const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
-            if(vstate != Voice::Stopped && vstate != Voice::Pending)
-                voice->mix(vstate, ctx, SamplesToDo);
+            const Voice::State vstate{voice->mPlayState.load(std::memory_order_relaxed)};
+            if(vstate == Voice::Stopped || vstate == Voice::Pending)
+                continue;
+            if(voice->mFlags.test(VoiceIsVirtual))
+                ++virtual_voices;
+            else
+                ++mixed_voices;
         }
+        ctx->mMixedVoiceCount.store(mixed_voices, std::memory_order_relaxed);
+        ctx->mVirtualVoiceCount.store(virtual_voices, std::memory_order_relaxed);
+        total_mixed += mixed_voices;
+        total_virtual += virtual_voices;
+        if(timing) LapMixStage(device, MixStage::Voices, mark);
 
         /* Process effects. */
         if(const size_t num_slots{auxslots.size()})
@@ -1918,13 +2139,51 @@ void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
                             { return slot->Target != *next_target; });
                     } while(split_point - sorted_slots.begin() > 1);
                 }
+
+                /* Calculate each slot's level, working back from the slots
+                 * that go to the output, then group the slots by level with a
+                 * stable insertion sort. Slots in the same level can be
+                 * processed together once the previous level is done.
+                 */
+                std::for_each(sorted_slots.rbegin(), sorted_slots.rend(),
+                    [](EffectSlot *slot) noexcept -> void
+                    { slot->mLevel = slot->Target ? slot->Target->mLevel+1 : 0u; });
+                for(auto iter = sorted_slots.begin()+1;iter != sorted_slots.end();++iter)
+                {
+                    EffectSlot *slot{*iter};
+                    auto dst = iter;
+                    for(;dst != sorted_slots.begin() && (*(dst-1))->mLevel < slot->mLevel;--dst)
+                        *dst = *(dst-1);
+                    *dst = slot;
+                }
             }
 
-            for(const EffectSlot *slot : sorted_slots)
+            auto level_begin = sorted_slots.begin();
+            while(level_begin != sorted_slots.end())
             {
-                EffectState *state{slot->mEffectState.get()};
-                state->process(SamplesToDo, slot->Wet.Buffer, state->mOutTarget);
+                const uint level{(*level_begin)->mLevel};
+                auto level_end = std::find_if(level_begin+1, sorted_slots.end(),
+                    [level](const EffectSlot *slot) noexcept -> bool
+                    { return slot->mLevel != level; });
+
+                if(pool && level_end-level_begin > 1)
+                    pool->processEffects(ctx, {level_begin, level_end}, auxslots, SamplesToDo);
+                else
+                {
+                    for(EffectSlot *slot : al::span<EffectSlot*>{level_begin, level_end})
+                    {
+                        /* Skip slots with no input once their effect's tail
+                         * has decayed.
+                         */
+                        if(!slot->needsProcessing(SamplesToDo))
+                            continue;
+                        EffectState *state{slot->mEffectState.get()};
+                        state->process(SamplesToDo, slot->Wet.Buffer, state->mOutTarget);
+                    }
+                }
+                level_begin = level_end;
             }
+            if(timing) LapMixStage(device, MixStage::Effects, mark);
         }
 
         /* Signal the event handler if there are any events to read. */
@@ -1932,6 +2191,15 @@ void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
         if(ring->readSpace() > 0)
             ctx->mEventSem.post();
     }
+
+    if(timing)
+    {
+        MixTimings &times = device->mMixTimes;
+        times.MixedVoices.store(total_mixed, std::memory_order_relaxed);
+        times.VirtualVoices.store(total_virtual, std::memory_order_relaxed);
+        if(total_mixed > times.MaxMixedVoices.load(std::memory_order_relaxed))
+            times.MaxMixedVoices.store(total_mixed, std::memory_order_relaxed);
+    }
 }
 
 
@@ -1991,36 +2259,6 @@ void ApplyDither(const al::span<FloatBufferLine> Samples, uint *dither_seed,
 }
 
 
-/* Base template left undefined. Should be marked =delete, but Clang 3.8.1
- * chokes on that given the inline specializations.
- */
-template<typename T>
-inline T SampleConv(float) noexcept;
-
-template<> inline float SampleConv(float val) noexcept
-{ return val; }
-template<> inline int32_t SampleConv(float val) noexcept
-{
-    /* Floats have a 23-bit mantissa, plus an implied 1 bit and a sign bit.
-     * This means a normalized float has at most 25 bits of signed precision.
-     * When scaling and clamping for a signed 32-bit integer, these following
-     * values are the best a float can give.
-     */
-    return fastf2i(clampf(val*2147483648.0f, -2147483648.0f, 2147483520.0f));
-}
-template<> inline int16_t SampleConv(float val) noexcept
-{ return static_cast<int16_t>(fastf2i(clampf(val*32768.0f, -32768.0f, 32767.0f))); }
-template<> inline int8_t SampleConv(float val) noexcept
-{ return static_cast<int8_t>(fastf2i(clampf(val*128.0f, -128.0f, 127.0f))); }
-
-/* Define unsigned output variations. */
-template<> inline uint32_t SampleConv(float val) noexcept
-{ return static_cast<uint32_t>(SampleConv<int32_t>(val)) + 2147483648u; }
-template<> inline uint16_t SampleConv(float val) noexcept
-{ return static_cast<uint16_t>(SampleConv<int16_t>(val) + 32768); }
-template<> inline uint8_t SampleConv(float val) noexcept
-{ return static_cast<uint8_t>(SampleConv<int8_t>(val) + 128); }
-
 template<DevFmtType T>
 void Write(const al::span<const FloatBufferLine> InBuffer, void *OutBuffer, const size_t Offset,
     const size_t SamplesToDo, const size_t FrameStep)
@@ -2029,6 +2267,32 @@ void Write(const al::span<const FloatBufferLine> InBuffer, void *OutBuffer, cons
     ASSUME(SamplesToDo > 0);
 
     DevFmtType_t<T> *outbase{static_cast<DevFmtType_t<T>*>(OutBuffer) + Offset*FrameStep};
+    if(T == DevFmtFloat)
+    {
+        InterleaveSamples(InBuffer, 0, reinterpret_cast<float*>(outbase), FrameStep,
+            SamplesToDo);
+        return;
+    }
+
+    /* Integer output is interleaved into a small float buffer that stays in
+     * cache, which is then converted to the output in one contiguous pass.
+     */
+    alignas(16) float buffer[WriteBlockFrames*MAX_OUTPUT_CHANNELS];
+    const size_t blockframes{al::size(buffer) / FrameStep};
+    if LIKELY(blockframes > 0)
+    {
+        for(size_t base{0};base < SamplesToDo;)
+        {
+            const size_t todo{minz(SamplesToDo-base, blockframes)};
+            InterleaveSamples(InBuffer, base, buffer, FrameStep, todo);
+            ConvertSamples(buffer, outbase, T, todo*FrameStep);
+            outbase += todo*FrameStep;
+            base += todo;
+        }
+        return;
+    }
+
+    /* Frames too wide for the buffer are converted directly. */
     size_t c{0};
     for(const FloatBufferLine &inbuf : InBuffer)
     {
@@ -2065,6 +2329,9 @@ uint DeviceBase::renderSamples(const uint numSamples)
     /* Increment the mix count at the start (lsb should now be 1). */
     IncrementRef(MixCount);
 
+    const bool timing{mTimeMixer};
+    const MixClock::time_point start{timing ? MixClock::now() : MixClock::time_point{}};
+
     /* Process and mix each context's sources and effects. */
     ProcessContexts(this, samplesToDo);
 
@@ -2077,25 +2344,54 @@ uint DeviceBase::renderSamples(const uint numSamples)
     SamplesDone %= Frequency;
 
     /* Increment the mix count at the end (lsb should now be 0). */
-    IncrementRef(MixCount);
+    finishMix();
+
+    MixClock::time_point mark{timing ? MixClock::now() : MixClock::time_point{}};
 
     /* Apply any needed post-process for finalizing the Dry mix to the RealOut
      * (Ambisonic decode, UHJ encode, etc).
      */
     postProcess(samplesToDo);
+    if(timing) LapMixStage(this, MixStage::PostProcess, mark);
 
     /* Apply compression, limiting sample amplitude if needed or desired. */
-    if(Limiter) Limiter->process(samplesToDo, RealOut.Buffer.data());
+    if(Limiter)
+    {
+        Limiter->process(samplesToDo, RealOut.Buffer.data());
+        if(timing) LapMixStage(this, MixStage::Limiter, mark);
+    }
 
     /* Apply delays and attenuation for mismatched speaker distances. */
     if(ChannelDelays)
+    {
         ApplyDistanceComp(RealOut.Buffer, samplesToDo, ChannelDelays->mChannels.data());
+        if(timing) LapMixStage(this, MixStage::DistanceComp, mark);
+    }
 
     /* Apply dithering. The compressor should have left enough headroom for the
      * dither noise to not saturate.
      */
     if(DitherDepth > 0.0f)
+    {
         ApplyDither(RealOut.Buffer, &DitherSeed, DitherDepth, samplesToDo);
+        if(timing) LapMixStage(this, MixStage::Dither, mark);
+    }
+
+    if(timing)
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::nanoseconds;
+
+        const auto elapsed = static_cast<uint64_t>(
+            duration_cast<nanoseconds>(MixClock::now() - start).count());
+        auto add_to = [](std::atomic<uint64_t> &counter, const uint64_t value) noexcept
+        { counter.store(counter.load(std::memory_order_relaxed)+value, std::memory_order_relaxed); };
+        add_to(mMixTimes.Updates, 1u);
+        add_to(mMixTimes.Samples, samplesToDo);
+        add_to(mMixTimes.TotalTime, elapsed);
+        if(elapsed > mMixTimes.MaxUpdateTime.load(std::memory_order_relaxed))
+            mMixTimes.MaxUpdateTime.store(elapsed, std::memory_order_relaxed);
+    }
 
     return samplesToDo;
 }
@@ -2198,5 +2494,5 @@ void DeviceBase::handleDisconnect(const char *msg, ...)
             std::for_each(voicelist.begin(), voicelist.end(), stop_voice);
         }
     }
-    IncrementRef(MixCount);
+    finishMix();
 }
@@ -8,6 +8,7 @@
 #include <string>
 
 #include "albyte.h"
+#include "aloptional.h"
 #include "core/device.h"
 #include "core/except.h"
 
@@ -80,6 +81,13 @@ struct BackendFactory {
 
     virtual std::string probe(BackendType type) = 0;
 
+    /**
+     * Returns a counter that changes whenever the backend's devices are added,
+     * removed, or renamed, so probed device lists can be kept until then.
+     * Backends that don't track their devices return an empty optional.
+     */
+    virtual al::optional<uint> deviceListVersion() { return al::nullopt; }
+
     virtual BackendPtr createBackend(DeviceBase *device, BackendType type) = 0;
 
 protected:
@@ -10,6 +10,7 @@
 #include "alnumeric.h"
 #include "core/device.h"
 #include "core/logging.h"
+#include "renderahead.h"
 #include "ringbuffer.h"
 
 #include "oboe/Oboe.h"
@@ -21,9 +22,10 @@ constexpr char device_name[] = "Oboe Default";
 
 
 struct OboePlayback final : public BackendBase, public oboe::AudioStreamCallback {
-    OboePlayback(DeviceBase *device) : BackendBase{device} { }
+    OboePlayback(DeviceBase *device) : BackendBase{device}, mRenderAhead{device} { }
 
     oboe::ManagedStream mStream;
+    RenderAhead mRenderAhead;
 
     oboe::DataCallbackResult onAudioReady(oboe::AudioStream *oboeStream, void *audioData,
         int32_t numFrames) override;
@@ -32,6 +34,7 @@ struct OboePlayback final : public BackendBase, public oboe::AudioStreamCallback
     bool reset() override;
     void start() override;
     void stop() override;
+    ClockLatency getClockLatency() override;
 };
 
 
@@ -41,8 +44,11 @@ oboe::DataCallbackResult OboePlayback::onAudioReady(oboe::AudioStream *oboeStrea
     assert(numFrames > 0);
     const int32_t numChannels{oboeStream->getChannelCount()};
 
-    mDevice->renderSamples(audioData, static_cast<uint32_t>(numFrames),
-        static_cast<uint32_t>(numChannels));
+    if(mRenderAhead.enabled())
+        mRenderAhead.read(audioData, static_cast<uint32_t>(numFrames));
+    else
+        mDevice->renderSamples(audioData, static_cast<uint32_t>(numFrames),
+            static_cast<uint32_t>(numChannels));
     return oboe::DataCallbackResult::Continue;
 }
 
@@ -169,25 +175,42 @@ bool OboePlayback::reset()
     mDevice->BufferSize = maxu(mDevice->UpdateSize * 2,
         static_cast<uint32_t>(mStream->getBufferSizeInFrames()));
 
+    mRenderAhead.reset();
     return true;
 }
 
 void OboePlayback::start()
 {
+    mRenderAhead.start();
     const oboe::Result result{mStream->start()};
     if(result != oboe::Result::OK)
+    {
+        mRenderAhead.stop();
         throw al::backend_exception{al::backend_error::DeviceError, "Failed to start stream: %s",
             oboe::convertToText(result)};
+    }
 }
 
 void OboePlayback::stop()
 {
     oboe::Result result{mStream->stop()};
+    mRenderAhead.stop();
     if(result != oboe::Result::OK)
         throw al::backend_exception{al::backend_error::DeviceError, "Failed to stop stream: %s",
             oboe::convertToText(result)};
 }
 
+ClockLatency OboePlayback::getClockLatency()
+{
+    if(!mRenderAhead.enabled())
+        return BackendBase::getClockLatency();
+
+    ClockLatency ret{mRenderAhead.getClockLatency()};
+    ret.Latency += std::chrono::nanoseconds{std::chrono::seconds{mDevice->BufferSize
+        - mDevice->UpdateSize}} / mDevice->Frequency;
+    return ret;
+}
+
 
 struct OboeCapture final : public BackendBase, public oboe::AudioStreamCallback {
     OboeCapture(DeviceBase *device) : BackendBase{device} { }
@@ -48,6 +48,7 @@
 #include "core/logging.h"
 #include "dynload.h"
 #include "opthelpers.h"
+#include "renderahead.h"
 #include "ringbuffer.h"
 
 /* Ignore warnings caused by PipeWire headers (lots in standard C++ mode). GCC
@@ -574,6 +575,9 @@ std::vector<DeviceNode> DeviceNode::sList;
 std::string DefaultSinkDevice;
 std::string DefaultSourceDevice;
 
+/* Incremented whenever the device list or the default devices change. */
+std::atomic<uint> DeviceListVersion{0u};
+
 const char *AsString(NodeType type) noexcept
 {
     switch(type)
@@ -597,6 +601,7 @@ DeviceNode &DeviceNode::Add(uint32_t id)
     sList.emplace_back();
     auto &n = sList.back();
     n.mId = id;
+    DeviceListVersion.fetch_add(1u, std::memory_order_release);
     return n;
 }
 
@@ -622,7 +627,11 @@ void DeviceNode::Remove(uint32_t id)
     };
 
     auto end = std::remove_if(sList.begin(), sList.end(), match_id);
-    sList.erase(end, sList.end());
+    if(end != sList.end())
+    {
+        sList.erase(end, sList.end());
+        DeviceListVersion.fetch_add(1u, std::memory_order_release);
+    }
 }
 
 
@@ -885,6 +894,7 @@ void NodeProxy::infoCallback(const pw_node_info *info)
         node.mType = ntype;
         node.mIsHeadphones = form_factor && (al::strcasecmp(form_factor, "headphones") == 0
             || al::strcasecmp(form_factor, "headset") == 0);
+        DeviceListVersion.fetch_add(1u, std::memory_order_release);
     }
 }
 
@@ -956,6 +966,7 @@ int MetadataProxy::propertyCallback(uint32_t id, const char *key, const char *ty
         TRACE("Default %s device cleared\n", isCapture ? "capture" : "playback");
         if(!isCapture) DefaultSinkDevice.clear();
         else DefaultSourceDevice.clear();
+        DeviceListVersion.fetch_add(1u, std::memory_order_release);
         return 0;
     }
     if(std::strcmp(type, "Spa:String:JSON") != 0)
@@ -997,6 +1008,7 @@ int MetadataProxy::propertyCallback(uint32_t id, const char *key, const char *ty
                 DefaultSinkDevice = std::move(*propValue);
             else
                 DefaultSourceDevice = std::move(*propValue);
+            DeviceListVersion.fetch_add(1u, std::memory_order_release);
         }
         else
         {
@@ -1278,6 +1290,8 @@ class PipeWirePlayback final : public BackendBase {
     std::unique_ptr<float*[]> mChannelPtrs;
     uint mNumChannels{};
 
+    RenderAhead mRenderAhead;
+
     static constexpr pw_stream_events CreateEvents()
     {
         pw_stream_events ret{};
@@ -1289,7 +1303,7 @@ class PipeWirePlayback final : public BackendBase {
     }
 
 public:
-    PipeWirePlayback(DeviceBase *device) noexcept : BackendBase{device} { }
+    PipeWirePlayback(DeviceBase *device) noexcept : BackendBase{device}, mRenderAhead{device} { }
     ~PipeWirePlayback()
     {
         /* Stop the mainloop so the stream can be properly destroyed. */
@@ -1348,7 +1362,10 @@ void PipeWirePlayback::outputCallback()
         ++chanptr_end;
     }
 
-    mDevice->renderSamples({mChannelPtrs.get(), chanptr_end}, length);
+    if(mRenderAhead.enabled())
+        mRenderAhead.read({mChannelPtrs.get(), chanptr_end}, length);
+    else
+        mDevice->renderSamples({mChannelPtrs.get(), chanptr_end}, length);
 
     for(const auto &data : datas)
     {
@@ -1564,6 +1581,7 @@ bool PipeWirePlayback::reset()
     mChannelPtrs = std::make_unique<float*[]>(mNumChannels);
 
     setDefaultWFXChannelOrder();
+    mRenderAhead.reset();
 
     return true;
 }
@@ -1593,6 +1611,12 @@ void PipeWirePlayback::start()
         mDevice->UpdateSize = mRateMatch->size;
         mDevice->BufferSize = mDevice->UpdateSize * 2;
     }
+    plock.unlock();
+
+    /* Start mixing ahead once the actual update size is known. The stream
+     * gets silence until the mixer thread catches up.
+     */
+    mRenderAhead.start();
 }
 
 void PipeWirePlayback::stop()
@@ -1605,6 +1629,9 @@ void PipeWirePlayback::stop()
     /* Wait for the stream to stop playing. */
     plock.wait([stream=mStream.get()]()
     { return pw_stream_get_state(stream, nullptr) != PW_STREAM_STATE_STREAMING; });
+    plock.unlock();
+
+    mRenderAhead.stop();
 }
 
 ClockLatency PipeWirePlayback::getClockLatency()
@@ -2002,6 +2029,13 @@ bool PipeWireBackendFactory::init()
 bool PipeWireBackendFactory::querySupport(BackendType type)
 { return type == BackendType::Playback || type == BackendType::Capture; }
 
+al::optional<uint> PipeWireBackendFactory::deviceListVersion()
+{
+    /* Make sure the initial device list is complete before it's cached. */
+    gEventHandler.waitForInit();
+    return DeviceListVersion.load(std::memory_order_acquire);
+}
+
 std::string PipeWireBackendFactory::probe(BackendType type)
 {
     std::string outnames;
@@ -15,6 +15,8 @@ public:
 
     std::string probe(BackendType type) override;
 
+    al::optional<uint> deviceListVersion() override;
+
     BackendPtr createBackend(DeviceBase *device, BackendType type) override;
 
     static BackendFactory &getFactory();
@@ -31,6 +31,7 @@
 #include "core/device.h"
 #include "core/logging.h"
 #include "dynload.h"
+#include "renderahead.h"
 #include "ringbuffer.h"
 
 #include <portaudio.h>
@@ -72,7 +73,7 @@ MAKE_FUNC(Pa_GetStreamInfo);
 
 
 struct PortPlayback final : public BackendBase {
-    PortPlayback(DeviceBase *device) noexcept : BackendBase{device} { }
+    PortPlayback(DeviceBase *device) noexcept : BackendBase{device}, mRenderAhead{device} { }
     ~PortPlayback() override;
 
     int writeCallback(const void *inputBuffer, void *outputBuffer, unsigned long framesPerBuffer,
@@ -89,11 +90,14 @@ struct PortPlayback final : public BackendBase {
     bool reset() override;
     void start() override;
     void stop() override;
+    ClockLatency getClockLatency() override;
 
     PaStream *mStream{nullptr};
     PaStreamParameters mParams{};
     uint mUpdateSize{0u};
 
+    RenderAhead mRenderAhead;
+
     DEF_NEWDEL(PortPlayback)
 };
 
@@ -109,8 +113,11 @@ PortPlayback::~PortPlayback()
 int PortPlayback::writeCallback(const void*, void *outputBuffer, unsigned long framesPerBuffer,
     const PaStreamCallbackTimeInfo*, const PaStreamCallbackFlags) noexcept
 {
-    mDevice->renderSamples(outputBuffer, static_cast<uint>(framesPerBuffer),
-        static_cast<uint>(mParams.channelCount));
+    if(mRenderAhead.enabled())
+        mRenderAhead.read(outputBuffer, static_cast<uint>(framesPerBuffer));
+    else
+        mDevice->renderSamples(outputBuffer, static_cast<uint>(framesPerBuffer),
+            static_cast<uint>(mParams.channelCount));
     return 0;
 }
 
@@ -210,16 +217,21 @@ bool PortPlayback::reset()
         return false;
     }
     setDefaultChannelOrder();
+    mRenderAhead.reset();
 
     return true;
 }
 
 void PortPlayback::start()
 {
+    mRenderAhead.start();
     const PaError err{Pa_StartStream(mStream)};
-    if(err == paNoError)
+    if(err != paNoError)
+    {
+        mRenderAhead.stop();
         throw al::backend_exception{al::backend_error::DeviceError, "Failed to start playback: %s",
             Pa_GetErrorText(err)};
+    }
 }
 
 void PortPlayback::stop()
@@ -227,6 +239,18 @@ void PortPlayback::stop()
     PaError err{Pa_StopStream(mStream)};
     if(err != paNoError)
         ERR("Error stopping stream: %s\n", Pa_GetErrorText(err));
+    mRenderAhead.stop();
+}
+
+ClockLatency PortPlayback::getClockLatency()
+{
+    if(!mRenderAhead.enabled())
+        return BackendBase::getClockLatency();
+
+    ClockLatency ret{mRenderAhead.getClockLatency()};
+    ret.Latency += std::chrono::nanoseconds{std::chrono::seconds{mDevice->BufferSize
+        - mDevice->UpdateSize}} / mDevice->Frequency;
+    return ret;
 }
 
 
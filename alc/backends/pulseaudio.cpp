@@ -54,6 +54,7 @@
 #include "core/logging.h"
 #include "dynload.h"
 #include "opthelpers.h"
+#include "renderahead.h"
 #include "strutils.h"
 #include "vector.h"
 
@@ -599,7 +600,7 @@ PulseMainloop gGlobalMainloop;
 
 
 struct PulsePlayback final : public BackendBase {
-    PulsePlayback(DeviceBase *device) noexcept : BackendBase{device} { }
+    PulsePlayback(DeviceBase *device) noexcept : BackendBase{device}, mRenderAhead{device} { }
     ~PulsePlayback() override;
 
     void bufferAttrCallback(pa_stream *stream) noexcept;
@@ -645,6 +646,8 @@ struct PulsePlayback final : public BackendBase {
 
     uint mFrameSize{0u};
 
+    RenderAhead mRenderAhead;
+
     DEF_NEWDEL(PulsePlayback)
 };
 
@@ -696,7 +699,10 @@ void PulsePlayback::streamWriteCallback(pa_stream *stream, size_t nbytes) noexce
             buflen = minz(buflen, nbytes);
         nbytes -= buflen;
 
-        mDevice->renderSamples(buf, static_cast<uint>(buflen/mFrameSize), mSpec.channels);
+        if(mRenderAhead.enabled())
+            mRenderAhead.read(buf, static_cast<uint>(buflen/mFrameSize));
+        else
+            mDevice->renderSamples(buf, static_cast<uint>(buflen/mFrameSize), mSpec.channels);
 
         int ret{pa_stream_write(stream, buf, buflen, free_func, 0, PA_SEEK_RELATIVE)};
         if UNLIKELY(ret != PA_OK)
@@ -972,12 +978,15 @@ bool PulsePlayback::reset()
 
     mDevice->BufferSize = mAttr.tlength / mFrameSize;
     mDevice->UpdateSize = mAttr.minreq / mFrameSize;
+    mRenderAhead.reset();
 
     return true;
 }
 
 void PulsePlayback::start()
 {
+    mRenderAhead.start();
+
     auto plock = mMainloop.getUniqueLock();
 
     /* Write some (silent) samples to fill the buffer before we start feeding
@@ -1019,6 +1028,9 @@ void PulsePlayback::stop()
         &mMainloop)};
     mMainloop.waitForOperation(op, plock);
     pa_stream_set_write_callback(mStream, nullptr, nullptr);
+    plock.unlock();
+
+    mRenderAhead.stop();
 }
 
 
@@ -1030,7 +1042,7 @@ ClockLatency PulsePlayback::getClockLatency()
 
     {
         auto plock = mMainloop.getUniqueLock();
-        ret.ClockTime = GetDeviceClockTime(mDevice);
+        ret = mRenderAhead.getClockLatency();
         err = pa_stream_get_latency(mStream, &latency, &neg);
     }
 
@@ -1047,7 +1059,7 @@ ClockLatency PulsePlayback::getClockLatency()
     }
     else if UNLIKELY(neg)
         latency = 0;
-    ret.Latency = std::chrono::microseconds{latency};
+    ret.Latency += std::chrono::microseconds{latency};
 
     return ret;
 }
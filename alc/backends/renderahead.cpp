@@ -0,0 +1,215 @@
+
+#include "config.h"
+
+#include "renderahead.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <stdint.h>
+
+#include "albyte.h"
+#include "alc/alconfig.h"
+#include "alnumeric.h"
+#include "core/device.h"
+#include "core/helpers.h"
+#include "core/logging.h"
+
+
+namespace {
+
+void WriteSilence(al::byte *outbuf, const DevFmtType type, const size_t numsamples) noexcept
+{
+    switch(type)
+    {
+    case DevFmtUByte:
+        std::fill_n(reinterpret_cast<uint8_t*>(outbuf), numsamples, uint8_t{0x80});
+        return;
+    case DevFmtUShort:
+        std::fill_n(reinterpret_cast<uint16_t*>(outbuf), numsamples, uint16_t{0x8000});
+        return;
+    case DevFmtUInt:
+        std::fill_n(reinterpret_cast<uint32_t*>(outbuf), numsamples, 0x80000000u);
+        return;
+    case DevFmtByte:
+    case DevFmtShort:
+    case DevFmtInt:
+    case DevFmtFloat:
+        break;
+    }
+    std::fill_n(outbuf, numsamples*BytesFromDevFmt(type), al::byte{});
+}
+
+} // namespace
+
+
+RenderAhead::~RenderAhead()
+{ stop(); }
+
+
+int RenderAhead::mixerProc()
+{
+    SetRTPriority();
+    althrd_setname(MIXER_THREAD_NAME);
+
+    const size_t frame_step{mDevice->channelsFromFmt()};
+
+    while(!mKillNow.load(std::memory_order_acquire)
+        && mDevice->Connected.load(std::memory_order_acquire))
+    {
+        const uint update_size{mDevice->UpdateSize};
+        if(mRing->writeSpace() < update_size)
+        {
+            mSem.wait();
+            continue;
+        }
+
+        auto data = mRing->getWriteVector();
+        size_t todo{data.first.len + data.second.len};
+        todo -= todo%update_size;
+
+        const auto len1 = static_cast<uint>(minz(data.first.len, todo));
+        const auto len2 = static_cast<uint>(minz(data.second.len, todo-len1));
+
+        mDevice->renderSamples(data.first.buf, len1, frame_step);
+        if(len2 > 0)
+            mDevice->renderSamples(data.second.buf, len2, frame_step);
+
+        std::lock_guard<std::mutex> _{mMutex};
+        mRing->writeAdvance(todo);
+        mClockTime = GetDeviceClockTime(mDevice);
+    }
+
+    return 0;
+}
+
+
+void RenderAhead::reset()
+{
+    mNumUpdates = ConfigValueUInt(mDevice->DeviceName.c_str(), nullptr, "render-ahead")
+        .value_or(0u);
+    if(mNumUpdates > 0)
+    {
+        mNumUpdates = clampu(mNumUpdates, 2, 16);
+        TRACE("Mixing %u updates ahead of the output\n", mNumUpdates);
+    }
+
+    std::lock_guard<std::mutex> _{mMutex};
+    mRing = nullptr;
+}
+
+void RenderAhead::start()
+{
+    if(!mNumUpdates)
+        return;
+
+    /* The backend may ask for its whole buffer at once when starting, so
+     * make sure the ring can hold at least that much.
+     */
+    const uint ringsize{maxu(mNumUpdates*mDevice->UpdateSize, mDevice->BufferSize)};
+    {
+        std::lock_guard<std::mutex> _{mMutex};
+        mRing = RingBuffer::Create(ringsize, mDevice->frameSizeFromFmt(), true);
+        mClockTime = GetDeviceClockTime(mDevice);
+    }
+
+    try {
+        mKillNow.store(false, std::memory_order_release);
+        mThread = std::thread{std::mem_fn(&RenderAhead::mixerProc), this};
+    }
+    catch(std::exception& e) {
+        throw al::backend_exception{al::backend_error::DeviceError,
+            "Failed to start mixing thread: %s", e.what()};
+    }
+    mPlaying.store(true, std::memory_order_release);
+}
+
+void RenderAhead::stop()
+{
+    mPlaying.store(false, std::memory_order_release);
+    mKillNow.store(true, std::memory_order_release);
+    if(mThread.joinable())
+    {
+        mSem.post();
+        mThread.join();
+    }
+}
+
+
+void RenderAhead::read(void *outbuf, const uint numframes) noexcept
+{
+    size_t total{0};
+    if LIKELY(mPlaying.load(std::memory_order_acquire))
+    {
+        total = mRing->read(outbuf, numframes);
+        mSem.post();
+    }
+
+    if(numframes > total)
+    {
+        const size_t frame_size{mDevice->frameSizeFromFmt()};
+        WriteSilence(static_cast<al::byte*>(outbuf) + total*frame_size, mDevice->FmtType,
+            (numframes-total) * mDevice->channelsFromFmt());
+    }
+}
+
+void RenderAhead::read(const al::span<float*> outbufs, const uint numframes) noexcept
+{
+    size_t total{0};
+    if LIKELY(mPlaying.load(std::memory_order_acquire))
+    {
+        const size_t frame_step{mDevice->channelsFromFmt()};
+        auto deinterleave = [outbufs,frame_step,&total](const al::byte *src, const size_t todo)
+            noexcept -> void
+        {
+            const float *RESTRICT in{reinterpret_cast<const float*>(src)};
+            for(float *outbuf : outbufs)
+            {
+                const float *RESTRICT chanin{in++};
+                float *RESTRICT out{outbuf + total};
+                for(size_t i{0};i < todo;++i)
+                {
+                    out[i] = *chanin;
+                    chanin += frame_step;
+                }
+            }
+            total += todo;
+        };
+
+        auto data = mRing->getReadVector();
+        deinterleave(data.first.buf, minz(numframes, data.first.len));
+        if(const size_t todo{minz(numframes-total, data.second.len)})
+            deinterleave(data.second.buf, todo);
+
+        mRing->readAdvance(total);
+        mSem.post();
+    }
+
+    if(numframes > total)
+    {
+        for(float *outbuf : outbufs)
+            std::fill(outbuf+total, outbuf+numframes, 0.0f);
+    }
+}
+
+
+ClockLatency RenderAhead::getClockLatency()
+{
+    ClockLatency ret;
+
+    std::lock_guard<std::mutex> _{mMutex};
+    if(mPlaying.load(std::memory_order_relaxed))
+    {
+        ret.ClockTime = mClockTime;
+        ret.Latency = std::chrono::seconds{mRing->readSpace()};
+        ret.Latency /= mDevice->Frequency;
+    }
+    else
+    {
+        ret.ClockTime = GetDeviceClockTime(mDevice);
+        ret.Latency = std::chrono::nanoseconds{};
+    }
+
+    return ret;
+}
@@ -0,0 +1,89 @@
+#ifndef ALC_BACKENDS_RENDERAHEAD_H
+#define ALC_BACKENDS_RENDERAHEAD_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "alspan.h"
+#include "base.h"
+#include "ringbuffer.h"
+#include "threads.h"
+
+struct DeviceBase;
+
+
+/**
+ * Mixes a device's output on a separate thread, a number of updates ahead of
+ * a callback-driven backend. The backend's callback then only has to copy the
+ * mixed samples out of a ring buffer, keeping the mix itself out of the audio
+ * server's real-time thread.
+ *
+ * Enabled with the device's render-ahead config option, which specifies the
+ * number of updates to mix ahead. At least the backend's buffer size is mixed
+ * ahead, since it may ask for all of it at once.
+ */
+class RenderAhead {
+    DeviceBase *const mDevice;
+
+    uint mNumUpdates{0u};
+    RingBufferPtr mRing;
+
+    std::atomic<bool> mPlaying{false};
+    std::atomic<bool> mKillNow{true};
+    al::semaphore mSem;
+    std::thread mThread;
+
+    /* The device clock time at the end of the samples written to the ring.
+     * The mutex is held while updating it along with the ring's write
+     * position, so the two can be read together, but not while rendering.
+     */
+    std::chrono::nanoseconds mClockTime{};
+    std::mutex mMutex;
+
+    int mixerProc();
+
+public:
+    RenderAhead(DeviceBase *device) noexcept : mDevice{device} { }
+    ~RenderAhead();
+
+    /**
+     * Reads the device's render-ahead option. Must be called from the
+     * backend's reset method, while stopped.
+     */
+    void reset();
+    bool enabled() const noexcept { return mNumUpdates > 0; }
+
+    /**
+     * Allocates the ring buffer for the device's current format, update and
+     * buffer size, and starts the mixer thread. Must be called before the
+     * backend starts invoking its callback, or the callback will get silence
+     * until the mixer catches up.
+     */
+    void start();
+    /**
+     * Stops the mixer thread. The backend must have stopped invoking its
+     * callback first.
+     */
+    void stop();
+
+    /**
+     * Copies numframes interleaved frames of the device's format to outbuf.
+     * Any frames the mixer hasn't reached yet are silenced.
+     */
+    void read(void *outbuf, const uint numframes) noexcept;
+    /**
+     * Copies numframes frames to separate channel buffers. The device format
+     * must be float.
+     */
+    void read(const al::span<float*> outbufs, const uint numframes) noexcept;
+
+    /**
+     * Gets the device clock time with the latency of the samples queued in the
+     * ring buffer. The backend should add the latency of its own output.
+     */
+    ClockLatency getClockLatency();
+};
+
+#endif /* ALC_BACKENDS_RENDERAHEAD_H */
@@ -31,6 +31,7 @@
 #include "alnumeric.h"
 #include "core/device.h"
 #include "core/logging.h"
+#include "renderahead.h"
 
 _Pragma("GCC diagnostic push")
 _Pragma("GCC diagnostic ignored \"-Wold-style-cast\"")
@@ -49,7 +50,7 @@ namespace {
 constexpr char defaultDeviceName[] = DEVNAME_PREFIX "Default Device";
 
 struct Sdl2Backend final : public BackendBase {
-    Sdl2Backend(DeviceBase *device) noexcept : BackendBase{device} { }
+    Sdl2Backend(DeviceBase *device) noexcept : BackendBase{device}, mRenderAhead{device} { }
     ~Sdl2Backend() override;
 
     void audioCallback(Uint8 *stream, int len) noexcept;
@@ -60,6 +61,7 @@ struct Sdl2Backend final : public BackendBase {
     bool reset() override;
     void start() override;
     void stop() override;
+    ClockLatency getClockLatency() override;
 
     SDL_AudioDeviceID mDeviceID{0u};
     uint mFrameSize{0};
@@ -69,6 +71,8 @@ struct Sdl2Backend final : public BackendBase {
     DevFmtType     mFmtType{};
     uint mUpdateSize{0u};
 
+    RenderAhead mRenderAhead;
+
     DEF_NEWDEL(Sdl2Backend)
 };
 
@@ -83,7 +87,10 @@ void Sdl2Backend::audioCallback(Uint8 *stream, int len) noexcept
 {
     const auto ulen = static_cast<unsigned int>(len);
     assert((ulen % mFrameSize) == 0);
-    mDevice->renderSamples(stream, ulen / mFrameSize, mDevice->channelsFromFmt());
+    if(mRenderAhead.enabled())
+        mRenderAhead.read(stream, ulen / mFrameSize);
+    else
+        mDevice->renderSamples(stream, ulen / mFrameSize, mDevice->channelsFromFmt());
 }
 
 void Sdl2Backend::open(const char *name)
@@ -172,14 +179,32 @@ bool Sdl2Backend::reset()
     mDevice->UpdateSize = mUpdateSize;
     mDevice->BufferSize = mUpdateSize * 2; /* SDL always (tries to) use two periods. */
     setDefaultWFXChannelOrder();
+    mRenderAhead.reset();
     return true;
 }
 
 void Sdl2Backend::start()
-{ SDL_PauseAudioDevice(mDeviceID, 0); }
+{
+    mRenderAhead.start();
+    SDL_PauseAudioDevice(mDeviceID, 0);
+}
 
 void Sdl2Backend::stop()
-{ SDL_PauseAudioDevice(mDeviceID, 1); }
+{
+    SDL_PauseAudioDevice(mDeviceID, 1);
+    mRenderAhead.stop();
+}
+
+ClockLatency Sdl2Backend::getClockLatency()
+{
+    if(!mRenderAhead.enabled())
+        return BackendBase::getClockLatency();
+
+    ClockLatency ret{mRenderAhead.getClockLatency()};
+    ret.Latency += std::chrono::nanoseconds{std::chrono::seconds{mDevice->BufferSize
+        - mDevice->UpdateSize}} / mDevice->Frequency;
+    return ret;
+}
 
 } // namespace
 
@@ -0,0 +1,537 @@
+/**
+ * OpenAL cross platform audio library
+ * Copyright (C) 2010 by Chris Robinson
+ * This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * Or go to http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#include "config.h"
+
+#include "shm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <signal.h>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <stdint.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "albyte.h"
+#include "alc/alconfig.h"
+#include "almalloc.h"
+#include "alnumeric.h"
+#include "core/device.h"
+#include "core/helpers.h"
+#include "core/logging.h"
+#include "shmring.h"
+#include "threads.h"
+
+
+namespace {
+
+using std::chrono::seconds;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+constexpr char shmDevice[] = "Shared Memory Ring";
+constexpr char defaultRingName[] = "/alsoft-output";
+
+
+/* A mapping of a shared memory ring, as created by the playback device or
+ * opened by the capture device.
+ */
+struct ShmRing {
+    std::string mName;
+    ShmRingHeader *mHeader{nullptr};
+    al::byte *mData{nullptr};
+    size_t mMapSize{0u};
+
+    /* Identifies the shared memory object, to tell if the name still refers
+     * to it.
+     */
+    dev_t mDev{};
+    ino_t mIno{};
+
+    ShmRing() = default;
+    ShmRing(const ShmRing&) = delete;
+    ~ShmRing() { unmap(); }
+
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    explicit operator bool() const noexcept { return mHeader != nullptr; }
+
+    void map(int fd, size_t size)
+    {
+        struct stat st{};
+        if(fstat(fd, &st) == 0)
+        {
+            mDev = st.st_dev;
+            mIno = st.st_ino;
+        }
+
+        void *ptr{mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)};
+        close(fd);
+        if(ptr == MAP_FAILED)
+            throw al::backend_exception{al::backend_error::DeviceError,
+                "Failed to map shared memory \"%s\": %s", mName.c_str(), strerror(errno)};
+
+        mHeader = static_cast<ShmRingHeader*>(ptr);
+        mData = static_cast<al::byte*>(ptr) + ShmRingDataOffset;
+        mMapSize = size;
+    }
+
+    void unmap() noexcept
+    {
+        if(mHeader)
+            munmap(mHeader, mMapSize);
+        mHeader = nullptr;
+        mData = nullptr;
+        mMapSize = 0;
+    }
+};
+
+
+/* Checks if the named shared memory is a ring still in use by a producer. A
+ * ring that was closed, or whose producer no longer exists, may be replaced.
+ * Anything that isn't a ring is left alone.
+ */
+bool IsRingInUse(const std::string &name)
+{
+    int fd{shm_open(name.c_str(), O_RDONLY, 0)};
+    if(fd == -1)
+        return errno != ENOENT;
+
+    struct stat st{};
+    void *ptr{MAP_FAILED};
+    if(fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmRingHeader))
+        ptr = mmap(nullptr, sizeof(ShmRingHeader), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(ptr == MAP_FAILED)
+        return true;
+
+    const auto *header = static_cast<const ShmRingHeader*>(ptr);
+    bool inuse{true};
+    if(header->mMagic == ShmRingHeader::Magic && header->mVersion == ShmRingHeader::Version)
+    {
+        const auto pid = static_cast<pid_t>(header->mProducerPid);
+        if(header->mState.load(std::memory_order_acquire) == ShmRingClosed)
+            inuse = false;
+        else if(pid > 0 && kill(pid, 0) == -1 && errno == ESRCH)
+        {
+            WARN("Replacing shared memory ring \"%s\" left by process %d\n", name.c_str(),
+                static_cast<int>(pid));
+            inuse = false;
+        }
+    }
+    munmap(ptr, sizeof(ShmRingHeader));
+
+    return inuse;
+}
+
+
+struct ShmPlayback final : public BackendBase {
+    ShmPlayback(DeviceBase *device) noexcept : BackendBase{device} { }
+    ~ShmPlayback() override;
+
+    int mixerProc();
+
+    void closeRing() noexcept;
+
+    void open(const char *name) override;
+    bool reset() override;
+    void start() override;
+    void stop() override;
+    ClockLatency getClockLatency() override;
+
+    ShmRing mRing;
+
+    std::mutex mMutex;
+
+    std::atomic<bool> mKillNow{true};
+    std::thread mThread;
+
+    DEF_NEWDEL(ShmPlayback)
+};
+
+ShmPlayback::~ShmPlayback()
+{ closeRing(); }
+
+void ShmPlayback::closeRing() noexcept
+{
+    if(!mRing) return;
+
+    /* Let any consumer know this ring is no longer used. */
+    mRing.mHeader->mState.store(ShmRingClosed, std::memory_order_release);
+    ShmRingWake(mRing.mHeader->mWriteSeq);
+    mRing.unmap();
+
+    /* Only remove the name if it still refers to this ring, as another
+     * producer may have replaced it after it was closed.
+     */
+    int fd{shm_open(mRing.mName.c_str(), O_RDONLY, 0)};
+    if(fd == -1) return;
+
+    struct stat st{};
+    if(fstat(fd, &st) == 0 && st.st_dev == mRing.mDev && st.st_ino == mRing.mIno)
+        shm_unlink(mRing.mName.c_str());
+    close(fd);
+}
+
+int ShmPlayback::mixerProc()
+{
+    SetRTPriority();
+    althrd_setname(MIXER_THREAD_NAME);
+
+    ShmRingHeader *header{mRing.mHeader};
+    const uint update_size{header->mUpdateSize};
+    const uint buffer_size{header->mBufferSize};
+    const uint64_t size_mask{header->mCapacity - 1u};
+    const size_t frame_size{header->mFrameSize};
+    const size_t frame_step{header->mChannels};
+    const nanoseconds restTime{nanoseconds{seconds{update_size}} / mDevice->Frequency};
+
+    while(!mKillNow.load(std::memory_order_acquire)
+        && mDevice->Connected.load(std::memory_order_acquire))
+    {
+        const uint32_t seq{header->mReadSeq.load(std::memory_order_acquire)};
+        const uint64_t writepos{header->mWritePos.load(std::memory_order_relaxed)};
+        const uint64_t readpos{header->mReadPos.load(std::memory_order_acquire)};
+
+        /* The consumer paces the output, so wait for it to make room. */
+        const uint64_t queued{minu64(writepos - readpos, buffer_size)};
+        uint todo{static_cast<uint>(buffer_size - queued)};
+        if(todo < update_size)
+        {
+            ShmRingWait(header->mReadSeq, seq, restTime);
+            continue;
+        }
+        todo -= todo%update_size;
+
+        const size_t offset{static_cast<size_t>(writepos & size_mask)};
+        const uint len1{static_cast<uint>(minu64(todo, size_mask+1 - offset))};
+        const uint len2{todo - len1};
+
+        std::lock_guard<std::mutex> _{mMutex};
+        mDevice->renderSamples(mRing.mData + offset*frame_size, len1, frame_step);
+        if(len2 > 0)
+            mDevice->renderSamples(mRing.mData, len2, frame_step);
+        header->mWritePos.store(writepos + todo, std::memory_order_release);
+        ShmRingWake(header->mWriteSeq);
+    }
+
+    return 0;
+}
+
+
+void ShmPlayback::open(const char *name)
+{
+    if(!name)
+        name = shmDevice;
+    else if(strcmp(name, shmDevice) != 0)
+        throw al::backend_exception{al::backend_error::NoDevice, "Device name \"%s\" not found",
+            name};
+
+    std::string ringname{ConfigValueStr(nullptr, "shm", "name").value_or(defaultRingName)};
+    if(IsRingInUse(ringname))
+        throw al::backend_exception{al::backend_error::NoDevice,
+            "Shared memory \"%s\" is in use; set a different [shm] name", ringname.c_str()};
+
+    mRing.mName = std::move(ringname);
+    mDevice->DeviceName = name;
+}
+
+bool ShmPlayback::reset()
+{
+    /* Consumers may still have the old ring mapped, so rather than resize it,
+     * close it and create a new one with the new format.
+     */
+    closeRing();
+
+    const uint frame_size{mDevice->frameSizeFromFmt()};
+    const uint capacity{NextPowerOf2(mDevice->BufferSize)};
+    const size_t size{ShmRingDataOffset + size_t{capacity}*frame_size};
+
+    /* Never open an existing ring, as another process may have it mapped with
+     * a different size. A stale one is removed first.
+     */
+    if(IsRingInUse(mRing.mName))
+    {
+        ERR("Shared memory \"%s\" is in use; set a different [shm] name\n",
+            mRing.mName.c_str());
+        return false;
+    }
+    shm_unlink(mRing.mName.c_str());
+
+    int fd{shm_open(mRing.mName.c_str(), O_RDWR|O_CREAT|O_EXCL, 0600)};
+    if(fd == -1)
+    {
+        ERR("Failed to create shared memory \"%s\": %s\n", mRing.mName.c_str(), strerror(errno));
+        return false;
+    }
+    if(ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        ERR("Failed to size shared memory \"%s\": %s\n", mRing.mName.c_str(), strerror(errno));
+        close(fd);
+        shm_unlink(mRing.mName.c_str());
+        return false;
+    }
+    try {
+        mRing.map(fd, size);
+    }
+    catch(al::backend_exception &e) {
+        ERR("%s\n", e.what());
+        shm_unlink(mRing.mName.c_str());
+        return false;
+    }
+
+    ShmRingHeader *header{::new(mRing.mHeader) ShmRingHeader{}};
+    header->mMagic = ShmRingHeader::Magic;
+    header->mVersion = ShmRingHeader::Version;
+    header->mDataOffset = ShmRingDataOffset;
+    header->mFrequency = mDevice->Frequency;
+    header->mChannels = mDevice->channelsFromFmt();
+    header->mSampleType = mDevice->FmtType;
+    header->mFrameSize = frame_size;
+    header->mCapacity = capacity;
+    header->mBufferSize = mDevice->BufferSize;
+    header->mUpdateSize = mDevice->UpdateSize;
+    header->mProducerPid = static_cast<uint32_t>(getpid());
+    header->mWritePos.store(0u, std::memory_order_relaxed);
+    header->mReadPos.store(0u, std::memory_order_relaxed);
+    header->mState.store(ShmRingStopped, std::memory_order_release);
+
+    TRACE("Created shared memory ring \"%s\", %u frames of %u bytes\n", mRing.mName.c_str(),
+        capacity, frame_size);
+
+    setDefaultWFXChannelOrder();
+    return true;
+}
+
+void ShmPlayback::start()
+{
+    mRing.mHeader->mState.store(ShmRingPlaying, std::memory_order_release);
+    ShmRingWake(mRing.mHeader->mWriteSeq);
+
+    try {
+        mKillNow.store(false, std::memory_order_release);
+        mThread = std::thread{std::mem_fn(&ShmPlayback::mixerProc), this};
+    }
+    catch(std::exception& e) {
+        mRing.mHeader->mState.store(ShmRingStopped, std::memory_order_release);
+        throw al::backend_exception{al::backend_error::DeviceError,
+            "Failed to start mixing thread: %s", e.what()};
+    }
+}
+
+void ShmPlayback::stop()
+{
+    if(mKillNow.exchange(true, std::memory_order_acq_rel) || !mThread.joinable())
+        return;
+    /* Wake the mixer in case it's waiting on the consumer. */
+    ShmRingWake(mRing.mHeader->mReadSeq);
+    mThread.join();
+
+    mRing.mHeader->mState.store(ShmRingStopped, std::memory_order_release);
+    ShmRingWake(mRing.mHeader->mWriteSeq);
+}
+
+ClockLatency ShmPlayback::getClockLatency()
+{
+    ClockLatency ret;
+
+    std::lock_guard<std::mutex> _{mMutex};
+    ret.ClockTime = GetDeviceClockTime(mDevice);
+    if(ShmRingHeader *header{mRing.mHeader})
+    {
+        const uint64_t writepos{header->mWritePos.load(std::memory_order_relaxed)};
+        const uint64_t readpos{header->mReadPos.load(std::memory_order_acquire)};
+        ret.Latency = std::chrono::seconds{minu64(writepos - readpos, header->mBufferSize)};
+        ret.Latency /= mDevice->Frequency;
+    }
+
+    return ret;
+}
+
+
+struct ShmCapture final : public BackendBase {
+    ShmCapture(DeviceBase *device) noexcept : BackendBase{device} { }
+
+    void open(const char *name) override;
+    void start() override;
+    void stop() override;
+    void captureSamples(al::byte *buffer, uint samples) override;
+    uint availableSamples() override;
+
+    ShmRing mRing;
+
+    /* Validated when opened, so they can't be changed by the peer. */
+    uint64_t mSizeMask{0u};
+    size_t mFrameSize{0u};
+
+    DEF_NEWDEL(ShmCapture)
+};
+
+void ShmCapture::open(const char *name)
+{
+    if(!name)
+        name = shmDevice;
+    else if(strcmp(name, shmDevice) != 0)
+        throw al::backend_exception{al::backend_error::NoDevice, "Device name \"%s\" not found",
+            name};
+
+    mRing.mName = ConfigValueStr(nullptr, "shm", "capture-name").value_or(defaultRingName);
+
+    int fd{shm_open(mRing.mName.c_str(), O_RDWR, 0)};
+    if(fd == -1)
+        throw al::backend_exception{al::backend_error::NoDevice,
+            "Failed to open shared memory \"%s\": %s", mRing.mName.c_str(), strerror(errno)};
+
+    struct stat st{};
+    if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < ShmRingDataOffset)
+    {
+        close(fd);
+        throw al::backend_exception{al::backend_error::DeviceError,
+            "Invalid shared memory ring \"%s\"", mRing.mName.c_str()};
+    }
+    mRing.map(fd, static_cast<size_t>(st.st_size));
+
+    const ShmRingHeader *header{mRing.mHeader};
+    const uint32_t capacity{header->mCapacity};
+    const uint32_t frame_size{header->mFrameSize};
+    if(header->mMagic != ShmRingHeader::Magic || header->mVersion != ShmRingHeader::Version
+        || header->mDataOffset != ShmRingDataOffset
+        || capacity == 0 || (capacity&(capacity-1)) != 0
+        || size_t{capacity}*frame_size > mRing.mMapSize - ShmRingDataOffset)
+        throw al::backend_exception{al::backend_error::DeviceError,
+            "Invalid shared memory ring \"%s\"", mRing.mName.c_str()};
+
+    /* The ring's format is fixed by the producer, so the requested format must
+     * match it.
+     */
+    if(header->mFrequency != mDevice->Frequency
+        || header->mChannels != mDevice->channelsFromFmt()
+        || header->mSampleType != mDevice->FmtType
+        || frame_size != mDevice->frameSizeFromFmt())
+        throw al::backend_exception{al::backend_error::DeviceError,
+            "Shared memory ring \"%s\" has %u channels of type %u at %uhz, requested %s %s %uhz",
+            mRing.mName.c_str(), header->mChannels, header->mSampleType, header->mFrequency,
+            DevFmtChannelsString(mDevice->FmtChans), DevFmtTypeString(mDevice->FmtType),
+            mDevice->Frequency};
+
+    mSizeMask = capacity - 1u;
+    mFrameSize = frame_size;
+    mDevice->DeviceName = name;
+}
+
+void ShmCapture::start()
+{
+    /* Skip anything queued while stopped, so capture starts from now. */
+    ShmRingHeader *header{mRing.mHeader};
+    header->mReadPos.store(header->mWritePos.load(std::memory_order_acquire),
+        std::memory_order_release);
+    ShmRingWake(header->mReadSeq);
+}
+
+void ShmCapture::stop()
+{
+}
+
+void ShmCapture::captureSamples(al::byte *buffer, uint samples)
+{
+    ShmRingHeader *header{mRing.mHeader};
+    const uint64_t size_mask{mSizeMask};
+    const size_t frame_size{mFrameSize};
+
+    const uint64_t readpos{header->mReadPos.load(std::memory_order_relaxed)};
+    const size_t offset{static_cast<size_t>(readpos & size_mask)};
+    const size_t len1{static_cast<size_t>(minu64(samples, size_mask+1 - offset))};
+    const size_t len2{samples - len1};
+
+    std::copy_n(mRing.mData + offset*frame_size, len1*frame_size, buffer);
+    if(len2 > 0)
+        std::copy_n(mRing.mData, len2*frame_size, buffer + len1*frame_size);
+
+    header->mReadPos.store(readpos + samples, std::memory_order_release);
+    ShmRingWake(header->mReadSeq);
+}
+
+uint ShmCapture::availableSamples()
+{
+    ShmRingHeader *header{mRing.mHeader};
+    if UNLIKELY(header->mState.load(std::memory_order_acquire) == ShmRingClosed)
+    {
+        mDevice->handleDisconnect("Shared memory ring closed");
+        return 0;
+    }
+
+    const uint64_t writepos{header->mWritePos.load(std::memory_order_acquire)};
+    const uint64_t readpos{header->mReadPos.load(std::memory_order_relaxed)};
+    return static_cast<uint>(minu64(writepos - readpos, mSizeMask+1));
+}
+
+} // namespace
+
+
+bool ShmBackendFactory::init()
+{
+    /* The ring positions are shared between processes, so they need to work
+     * without a lock.
+     */
+    return std::atomic<uint64_t>{}.is_lock_free() && std::atomic<uint32_t>{}.is_lock_free();
+}
+
+bool ShmBackendFactory::querySupport(BackendType type)
+{ return type == BackendType::Playback || type == BackendType::Capture; }
+
+std::string ShmBackendFactory::probe(BackendType type)
+{
+    std::string outnames;
+    switch(type)
+    {
+    case BackendType::Playback:
+    case BackendType::Capture:
+        /* Includes null char. */
+        outnames.append(shmDevice, sizeof(shmDevice));
+        break;
+    }
+    return outnames;
+}
+
+BackendPtr ShmBackendFactory::createBackend(DeviceBase *device, BackendType type)
+{
+    if(type == BackendType::Playback)
+        return BackendPtr{new ShmPlayback{device}};
+    if(type == BackendType::Capture)
+        return BackendPtr{new ShmCapture{device}};
+    return nullptr;
+}
+
+BackendFactory &ShmBackendFactory::getFactory()
+{
+    static ShmBackendFactory factory{};
+    return factory;
+}
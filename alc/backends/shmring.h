@@ -0,0 +1,112 @@
+#ifndef ALC_BACKENDS_SHMRING_H
+#define ALC_BACKENDS_SHMRING_H
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <thread>
+
+#ifdef __linux__
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+/* The layout of the shared memory ring created by the shm backend, for other
+ * processes to consume the device output from (or feed capture input to).
+ *
+ * The sample data follows the header at mDataOffset bytes from the start of
+ * the shared memory, as mCapacity frames of mFrameSize bytes. As with
+ * RingBuffer, the write and read positions are only advanced by the producer
+ * and consumer respectively, and are masked with mCapacity-1 to get the frame
+ * offset. They count frames since the ring was created, so they never wrap in
+ * practice. After advancing its position, the owner increments the matching
+ * sequence word and wakes any process waiting on it.
+ *
+ * The producer never has more than mBufferSize frames queued. It creates a new
+ * ring when the device is reset, marking the old one closed, so consumers
+ * should reopen the ring by name when they see ShmRingClosed. A producer won't
+ * replace a ring another producer is using, unless mProducerPid no longer
+ * exists.
+ */
+enum ShmRingState : uint32_t {
+    ShmRingStopped,
+    ShmRingPlaying,
+    ShmRingClosed
+};
+
+/* The same order as DevFmtType. */
+enum ShmSampleType : uint32_t {
+    ShmSampleInt8,
+    ShmSampleUInt8,
+    ShmSampleInt16,
+    ShmSampleUInt16,
+    ShmSampleInt32,
+    ShmSampleUInt32,
+    ShmSampleFloat32
+};
+
+struct ShmRingHeader {
+    static constexpr uint32_t Magic{0x52534c41}; /* "ALSR" */
+    static constexpr uint32_t Version{1};
+
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mDataOffset;
+
+    uint32_t mFrequency;
+    uint32_t mChannels;
+    uint32_t mSampleType;
+    uint32_t mFrameSize;
+    uint32_t mCapacity;
+    uint32_t mBufferSize;
+    uint32_t mUpdateSize;
+    uint32_t mProducerPid;
+
+    std::atomic<uint32_t> mState;
+
+    alignas(64) std::atomic<uint64_t> mWritePos;
+    std::atomic<uint32_t> mWriteSeq;
+
+    alignas(64) std::atomic<uint64_t> mReadPos;
+    std::atomic<uint32_t> mReadSeq;
+};
+
+constexpr uint32_t ShmRingDataOffset{(sizeof(ShmRingHeader)+63) & ~uint32_t{63}};
+
+
+/* Waits for the sequence word to change from seq, or until the timeout. This
+ * may return early.
+ */
+inline void ShmRingWait(std::atomic<uint32_t> &word, const uint32_t seq,
+    const std::chrono::nanoseconds timeout)
+{
+#ifdef __linux__
+    using std::chrono::seconds;
+    using std::chrono::nanoseconds;
+
+    const timespec ts{static_cast<time_t>(std::chrono::duration_cast<seconds>(timeout).count()),
+        static_cast<long>((timeout%seconds{1}).count())};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, seq, &ts, nullptr, 0);
+#else
+    /* Without futexes, poll the word a few times over the timeout. */
+    const auto rest = timeout / 4;
+    for(int i{0};i < 4 && word.load(std::memory_order_acquire) == seq;++i)
+        std::this_thread::sleep_for(rest);
+#endif
+}
+
+/* Increments the sequence word and wakes any process waiting on it. */
+inline void ShmRingWake(std::atomic<uint32_t> &word)
+{
+    word.fetch_add(1u, std::memory_order_acq_rel);
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr,
+        0);
+#endif
+}
+
+#endif /* ALC_BACKENDS_SHMRING_H */
@@ -23,6 +23,7 @@
 #include "wave.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cerrno>
 #include <chrono>
@@ -31,6 +32,7 @@
 #include <cstring>
 #include <exception>
 #include <functional>
+#include <string>
 #include <thread>
 
 #include "albit.h"
@@ -90,12 +92,61 @@ void fwrite32le(uint val, FILE *f)
     fwrite(data, 1, 4, f);
 }
 
+template<typename T>
+void SwapSampleBytes(al::byte *data, const size_t count)
+{
+    static_assert(sizeof(T) == 2 || sizeof(T) == 4, "Unexpected sample size");
+
+    for(size_t i{0};i < count;++i)
+    {
+        T val;
+        memcpy(&val, data, sizeof(T));
+        if(sizeof(T) == 2)
+            val = static_cast<T>((val>>8) | (val<<8));
+        else
+            val = static_cast<T>((val>>24) | ((val>>8)&0xff00) | ((val<<8)&0xff0000) | (val<<24));
+        memcpy(data, &val, sizeof(T));
+        data += sizeof(T);
+    }
+}
+
+FILE *OpenWaveFile(const std::string &fname)
+{
+#ifdef _WIN32
+    std::wstring wname{utf8_to_wstr(fname.c_str())};
+    return _wfopen(wname.c_str(), L"wb");
+#else
+    return fopen(fname.c_str(), "wb");
+#endif
+}
+
+/* Gets the name of the given part of a split output, inserting the index
+ * before the extension (e.g. "out.wav" -> "out-001.wav").
+ */
+std::string GetSplitName(const std::string &fname, const uint index)
+{
+    char idxstr[16];
+    snprintf(idxstr, sizeof(idxstr), "-%03u", index);
+
+    const size_t extpos{fname.rfind('.')};
+    const size_t seppos{fname.find_last_of("/\\")};
+    if(extpos == std::string::npos || (seppos != std::string::npos && extpos < seppos))
+        return fname + idxstr;
+    return fname.substr(0, extpos) + idxstr + fname.substr(extpos);
+}
+
 
 struct WaveBackend final : public BackendBase {
     WaveBackend(DeviceBase *device) noexcept : BackendBase{device} { }
     ~WaveBackend() override;
 
+    void renderBlock(const uint frames);
     int mixerProc();
+    int writerProc();
+
+    bool writeHeader();
+    void finishFile();
+    bool nextFile();
 
     void open(const char *name) override;
     bool reset() override;
@@ -105,10 +156,40 @@ struct WaveBackend final : public BackendBase {
     FILE *mFile{nullptr};
     long mDataStart{-1};
 
-    al::vector<al::byte> mBuffer;
+    /* For split output, the base filename, the current part's index, and
+     * the number of frames to write to each part.
+     */
+    std::string mFileName;
+    uint mSplitLength{0u};
+    uint mFileIndex{0u};
+    uint64_t mSplitFrames{0u};
+    uint64_t mFileFrames{0u};
+
+    uint mChanMask{0u};
+    bool mIsBFormat{false};
+
+    /* When offline, mix as fast as possible in blocks of mBlockFrames instead
+     * of pacing the output in real time.
+     */
+    bool mOffline{false};
+    uint mBlockFrames{0u};
+
+    /* Mixed blocks are handed off to a writer thread, so the mixer can work on
+     * the next block while the previous one is written out.
+     */
+    struct WriteBuffer {
+        al::vector<al::byte> mData;
+        uint mFrames{0u};
+    };
+    std::array<WriteBuffer,2> mBuffers;
+    size_t mMixIndex{0u};
+    size_t mWriteIndex{0u};
+    al::semaphore mFreeSem{static_cast<uint>(std::tuple_size<decltype(mBuffers)>::value)};
+    al::semaphore mFullSem;
 
     std::atomic<bool> mKillNow{true};
     std::thread mThread;
+    std::thread mWriteThread;
 
     DEF_NEWDEL(WaveBackend)
 };
@@ -120,14 +201,31 @@ WaveBackend::~WaveBackend()
     mFile = nullptr;
 }
 
+void WaveBackend::renderBlock(const uint frames)
+{
+    mFreeSem.wait();
+
+    WriteBuffer &buffer = mBuffers[mMixIndex];
+    mDevice->renderSamples(buffer.mData.data(), frames, mDevice->channelsFromFmt());
+    buffer.mFrames = frames;
+
+    mMixIndex = (mMixIndex+1) % mBuffers.size();
+    mFullSem.post();
+}
+
 int WaveBackend::mixerProc()
 {
     const milliseconds restTime{mDevice->UpdateSize*1000/mDevice->Frequency / 2};
 
     althrd_setname(MIXER_THREAD_NAME);
 
-    const size_t frameStep{mDevice->channelsFromFmt()};
-    const size_t frameSize{mDevice->frameSizeFromFmt()};
+    if(mOffline)
+    {
+        while(!mKillNow.load(std::memory_order_acquire)
+            && mDevice->Connected.load(std::memory_order_acquire))
+            renderBlock(mBlockFrames);
+        return 0;
+    }
 
     int64_t done{0};
     auto start = std::chrono::steady_clock::now();
@@ -146,37 +244,8 @@ int WaveBackend::mixerProc()
         }
         while(avail-done >= mDevice->UpdateSize)
         {
-            mDevice->renderSamples(mBuffer.data(), mDevice->UpdateSize, frameStep);
+            renderBlock(mDevice->UpdateSize);
             done += mDevice->UpdateSize;
-
-            if(al::endian::native != al::endian::little)
-            {
-                const uint bytesize{mDevice->bytesFromFmt()};
-
-                if(bytesize == 2)
-                {
-                    const size_t len{mBuffer.size() & ~size_t{1}};
-                    for(size_t i{0};i < len;i+=2)
-                        std::swap(mBuffer[i], mBuffer[i+1]);
-                }
-                else if(bytesize == 4)
-                {
-                    const size_t len{mBuffer.size() & ~size_t{3}};
-                    for(size_t i{0};i < len;i+=4)
-                    {
-                        std::swap(mBuffer[i  ], mBuffer[i+3]);
-                        std::swap(mBuffer[i+1], mBuffer[i+2]);
-                    }
-                }
-            }
-
-            const size_t fs{fwrite(mBuffer.data(), frameSize, mDevice->UpdateSize, mFile)};
-            if(fs < mDevice->UpdateSize || ferror(mFile))
-            {
-                ERR("Error writing to file\n");
-                mDevice->handleDisconnect("Failed to write playback samples");
-                break;
-            }
         }
 
         /* For every completed second, increment the start time and reduce the
@@ -195,6 +264,167 @@ int WaveBackend::mixerProc()
     return 0;
 }
 
+int WaveBackend::writerProc()
+{
+    althrd_setname("alsoft-wavewrite");
+
+    const size_t frameSize{mDevice->frameSizeFromFmt()};
+    const uint bytesize{mDevice->bytesFromFmt()};
+    bool failed{false};
+
+    while(true)
+    {
+        mFullSem.wait();
+
+        WriteBuffer &buffer = mBuffers[mWriteIndex];
+        mWriteIndex = (mWriteIndex+1) % mBuffers.size();
+        /* An empty buffer signals the end of the output. */
+        if(!buffer.mFrames)
+        {
+            mFreeSem.post();
+            break;
+        }
+
+        if(al::endian::native != al::endian::little)
+        {
+            const size_t numsamples{buffer.mFrames * mDevice->channelsFromFmt()};
+            if(bytesize == 2)
+                SwapSampleBytes<uint16_t>(buffer.mData.data(), numsamples);
+            else if(bytesize == 4)
+                SwapSampleBytes<uint32_t>(buffer.mData.data(), numsamples);
+        }
+
+        const al::byte *data{buffer.mData.data()};
+        uint64_t todo{buffer.mFrames};
+        while(!failed && todo > 0)
+        {
+            if(mSplitFrames > 0 && mFileFrames >= mSplitFrames && !nextFile())
+            {
+                failed = true;
+                break;
+            }
+
+            size_t len{static_cast<size_t>(todo)};
+            if(mSplitFrames > 0)
+                len = static_cast<size_t>(minu64(todo, mSplitFrames-mFileFrames));
+
+            const size_t fs{fwrite(data, frameSize, len, mFile)};
+            if(fs < len || ferror(mFile))
+            {
+                ERR("Error writing to file\n");
+                mDevice->handleDisconnect("Failed to write playback samples");
+                failed = true;
+                break;
+            }
+            data += len*frameSize;
+            todo -= len;
+            mFileFrames += len;
+        }
+
+        mFreeSem.post();
+    }
+
+    return 0;
+}
+
+bool WaveBackend::writeHeader()
+{
+    const uint channels{mDevice->channelsFromFmt()};
+    const uint bytes{mDevice->bytesFromFmt()};
+
+    rewind(mFile);
+
+    fputs("RIFF", mFile);
+    fwrite32le(0xFFFFFFFF, mFile); // 'RIFF' header len; filled in at close
+
+    fputs("WAVE", mFile);
+
+    fputs("fmt ", mFile);
+    fwrite32le(40, mFile); // 'fmt ' header len; 40 bytes for EXTENSIBLE
+
+    // 16-bit val, format type id (extensible: 0xFFFE)
+    fwrite16le(0xFFFE, mFile);
+    // 16-bit val, channel count
+    fwrite16le(static_cast<ushort>(channels), mFile);
+    // 32-bit val, frequency
+    fwrite32le(mDevice->Frequency, mFile);
+    // 32-bit val, bytes per second
+    fwrite32le(mDevice->Frequency * channels * bytes, mFile);
+    // 16-bit val, frame size
+    fwrite16le(static_cast<ushort>(channels * bytes), mFile);
+    // 16-bit val, bits per sample
+    fwrite16le(static_cast<ushort>(bytes * 8), mFile);
+    // 16-bit val, extra byte count
+    fwrite16le(22, mFile);
+    // 16-bit val, valid bits per sample
+    fwrite16le(static_cast<ushort>(bytes * 8), mFile);
+    // 32-bit val, channel mask
+    fwrite32le(mChanMask, mFile);
+    // 16 byte GUID, sub-type format
+    size_t val{fwrite((mDevice->FmtType == DevFmtFloat) ?
+        (mIsBFormat ? SUBTYPE_BFORMAT_FLOAT : SUBTYPE_FLOAT) :
+        (mIsBFormat ? SUBTYPE_BFORMAT_PCM : SUBTYPE_PCM), 1, 16, mFile)};
+    (void)val;
+
+    fputs("data", mFile);
+    fwrite32le(0xFFFFFFFF, mFile); // 'data' header len; filled in at close
+
+    if(ferror(mFile))
+    {
+        ERR("Error writing header: %s\n", strerror(errno));
+        return false;
+    }
+    mDataStart = ftell(mFile);
+    mFileFrames = 0;
+
+    return true;
+}
+
+void WaveBackend::finishFile()
+{
+    if(mDataStart > 0)
+    {
+        long size{ftell(mFile)};
+        if(size > 0)
+        {
+            long dataLen{size - mDataStart};
+            if(fseek(mFile, 4, SEEK_SET) == 0)
+                fwrite32le(static_cast<uint>(size-8), mFile); // 'WAVE' header len
+            if(fseek(mFile, mDataStart-4, SEEK_SET) == 0)
+                fwrite32le(static_cast<uint>(dataLen), mFile); // 'data' header len
+        }
+    }
+}
+
+bool WaveBackend::nextFile()
+{
+    /* Open the next part before finishing the current one, so if it fails the
+     * current file is left open and gets finished normally when stopping.
+     */
+    const std::string fname{GetSplitName(mFileName, mFileIndex+1)};
+    FILE *nextfile{OpenWaveFile(fname)};
+    if(!nextfile)
+    {
+        ERR("Could not open file '%s': %s\n", fname.c_str(), strerror(errno));
+        mDevice->handleDisconnect("Failed to open next output file");
+        return false;
+    }
+    TRACE("Writing to %s\n", fname.c_str());
+
+    finishFile();
+    fclose(mFile);
+    mFile = nextfile;
+    ++mFileIndex;
+
+    mDataStart = -1;
+    if(!writeHeader())
+    {
+        mDevice->handleDisconnect("Failed to write output file header");
+        return false;
+    }
+    return true;
+}
+
 void WaveBackend::open(const char *name)
 {
     auto fname = ConfigValueStr(nullptr, "wave", "file");
@@ -210,27 +440,22 @@ void WaveBackend::open(const char *name)
     /* There's only one "device", so if it's already open, we're done. */
     if(mFile) return;
 
-#ifdef _WIN32
-    {
-        std::wstring wname{utf8_to_wstr(fname->c_str())};
-        mFile = _wfopen(wname.c_str(), L"wb");
-    }
-#else
-    mFile = fopen(fname->c_str(), "wb");
-#endif
+    /* When splitting the output, the first part gets an index too. */
+    mFileName = std::move(*fname);
+    mSplitLength = ConfigValueUInt(nullptr, "wave", "split-length").value_or(0u);
+    mFileIndex = mSplitLength ? 1u : 0u;
+
+    const std::string partname{mSplitLength ? GetSplitName(mFileName, mFileIndex) : mFileName};
+    mFile = OpenWaveFile(partname);
     if(!mFile)
         throw al::backend_exception{al::backend_error::DeviceError, "Could not open file '%s': %s",
-            fname->c_str(), strerror(errno)};
+            partname.c_str(), strerror(errno)};
 
     mDevice->DeviceName = name;
 }
 
 bool WaveBackend::reset()
 {
-    uint channels{0}, bytes{0}, chanmask{0};
-    bool isbformat{false};
-    size_t val;
-
     fseek(mFile, 0, SEEK_SET);
     clearerr(mFile);
 
@@ -257,76 +482,51 @@ bool WaveBackend::reset()
     case DevFmtFloat:
         break;
     }
+    mChanMask = 0;
+    mIsBFormat = false;
     switch(mDevice->FmtChans)
     {
-    case DevFmtMono:   chanmask = 0x04; break;
-    case DevFmtStereo: chanmask = 0x01 | 0x02; break;
-    case DevFmtQuad:   chanmask = 0x01 | 0x02 | 0x10 | 0x20; break;
-    case DevFmtX51: chanmask = 0x01 | 0x02 | 0x04 | 0x08 | 0x200 | 0x400; break;
-    case DevFmtX61: chanmask = 0x01 | 0x02 | 0x04 | 0x08 | 0x100 | 0x200 | 0x400; break;
-    case DevFmtX71: chanmask = 0x01 | 0x02 | 0x04 | 0x08 | 0x010 | 0x020 | 0x200 | 0x400; break;
+    case DevFmtMono:   mChanMask = 0x04; break;
+    case DevFmtStereo: mChanMask = 0x01 | 0x02; break;
+    case DevFmtQuad:   mChanMask = 0x01 | 0x02 | 0x10 | 0x20; break;
+    case DevFmtX51: mChanMask = 0x01 | 0x02 | 0x04 | 0x08 | 0x200 | 0x400; break;
+    case DevFmtX61: mChanMask = 0x01 | 0x02 | 0x04 | 0x08 | 0x100 | 0x200 | 0x400; break;
+    case DevFmtX71: mChanMask = 0x01 | 0x02 | 0x04 | 0x08 | 0x010 | 0x020 | 0x200 | 0x400; break;
     /* NOTE: Same as 7.1. */
-    case DevFmtX3D71: chanmask = 0x01 | 0x02 | 0x04 | 0x08 | 0x010 | 0x020 | 0x200 | 0x400; break;
+    case DevFmtX3D71: mChanMask = 0x01 | 0x02 | 0x04 | 0x08 | 0x010 | 0x020 | 0x200 | 0x400; break;
     case DevFmtAmbi3D:
         /* .amb output requires FuMa */
         mDevice->mAmbiOrder = minu(mDevice->mAmbiOrder, 3);
         mDevice->mAmbiLayout = DevAmbiLayout::FuMa;
         mDevice->mAmbiScale = DevAmbiScaling::FuMa;
-        isbformat = true;
-        chanmask = 0;
+        mIsBFormat = true;
+        mChanMask = 0;
         break;
     }
-    bytes = mDevice->bytesFromFmt();
-    channels = mDevice->channelsFromFmt();
-
-    rewind(mFile);
-
-    fputs("RIFF", mFile);
-    fwrite32le(0xFFFFFFFF, mFile); // 'RIFF' header len; filled in at close
-
-    fputs("WAVE", mFile);
 
-    fputs("fmt ", mFile);
-    fwrite32le(40, mFile); // 'fmt ' header len; 40 bytes for EXTENSIBLE
+    if(!writeHeader())
+        return false;
 
-    // 16-bit val, format type id (extensible: 0xFFFE)
-    fwrite16le(0xFFFE, mFile);
-    // 16-bit val, channel count
-    fwrite16le(static_cast<ushort>(channels), mFile);
-    // 32-bit val, frequency
-    fwrite32le(mDevice->Frequency, mFile);
-    // 32-bit val, bytes per second
-    fwrite32le(mDevice->Frequency * channels * bytes, mFile);
-    // 16-bit val, frame size
-    fwrite16le(static_cast<ushort>(channels * bytes), mFile);
-    // 16-bit val, bits per sample
-    fwrite16le(static_cast<ushort>(bytes * 8), mFile);
-    // 16-bit val, extra byte count
-    fwrite16le(22, mFile);
-    // 16-bit val, valid bits per sample
-    fwrite16le(static_cast<ushort>(bytes * 8), mFile);
-    // 32-bit val, channel mask
-    fwrite32le(chanmask, mFile);
-    // 16 byte GUID, sub-type format
-    val = fwrite((mDevice->FmtType == DevFmtFloat) ?
-        (isbformat ? SUBTYPE_BFORMAT_FLOAT : SUBTYPE_FLOAT) :
-        (isbformat ? SUBTYPE_BFORMAT_PCM : SUBTYPE_PCM), 1, 16, mFile);
-    (void)val;
+    setDefaultWFXChannelOrder();
 
-    fputs("data", mFile);
-    fwrite32le(0xFFFFFFFF, mFile); // 'data' header len; filled in at close
+    mSplitFrames = uint64_t{mSplitLength} * mDevice->Frequency;
 
-    if(ferror(mFile))
+    /* Offline mixing uses larger blocks of about 100ms to reduce the overhead
+     * of each mix and write.
+     */
+    mOffline = GetConfigValueBool(nullptr, "wave", "offline", 0);
+    mBlockFrames = mDevice->UpdateSize;
+    if(mOffline)
     {
-        ERR("Error writing header: %s\n", strerror(errno));
-        return false;
+        const uint numupdates{(mDevice->Frequency/10 + mDevice->UpdateSize-1) /
+            mDevice->UpdateSize};
+        mBlockFrames *= maxu(numupdates, 1);
+        TRACE("Mixing offline in blocks of %u samples\n", mBlockFrames);
     }
-    mDataStart = ftell(mFile);
-
-    setDefaultWFXChannelOrder();
 
-    const uint bufsize{mDevice->frameSizeFromFmt() * mDevice->UpdateSize};
-    mBuffer.resize(bufsize);
+    const size_t bufsize{size_t{mDevice->frameSizeFromFmt()} * mBlockFrames};
+    for(WriteBuffer &buffer : mBuffers)
+        buffer.mData.resize(bufsize);
 
     return true;
 }
@@ -335,11 +535,23 @@ void WaveBackend::start()
 {
     if(mDataStart > 0 && fseek(mFile, 0, SEEK_END) != 0)
         WARN("Failed to seek on output file\n");
+    try {
+        mWriteThread = std::thread{std::mem_fn(&WaveBackend::writerProc), this};
+    }
+    catch(std::exception& e) {
+        throw al::backend_exception{al::backend_error::DeviceError,
+            "Failed to start writer thread: %s", e.what()};
+    }
     try {
         mKillNow.store(false, std::memory_order_release);
         mThread = std::thread{std::mem_fn(&WaveBackend::mixerProc), this};
     }
     catch(std::exception& e) {
+        mFreeSem.wait();
+        mBuffers[mMixIndex].mFrames = 0;
+        mMixIndex = (mMixIndex+1) % mBuffers.size();
+        mFullSem.post();
+        mWriteThread.join();
         throw al::backend_exception{al::backend_error::DeviceError,
             "Failed to start mixing thread: %s", e.what()};
     }
@@ -351,18 +563,14 @@ void WaveBackend::stop()
         return;
     mThread.join();
 
-    if(mDataStart > 0)
-    {
-        long size{ftell(mFile)};
-        if(size > 0)
-        {
-            long dataLen{size - mDataStart};
-            if(fseek(mFile, 4, SEEK_SET) == 0)
-                fwrite32le(static_cast<uint>(size-8), mFile); // 'WAVE' header len
-            if(fseek(mFile, mDataStart-4, SEEK_SET) == 0)
-                fwrite32le(static_cast<uint>(dataLen), mFile); // 'data' header len
-        }
-    }
+    /* Queue an empty buffer to have the writer finish after the mixed ones. */
+    mFreeSem.wait();
+    mBuffers[mMixIndex].mFrames = 0;
+    mMixIndex = (mMixIndex+1) % mBuffers.size();
+    mFullSem.post();
+    mWriteThread.join();
+
+    finishFile();
 }
 
 } // namespace
@@ -59,6 +59,7 @@ constexpr ALchar alExtList[] =
     "AL_EXT_SOURCE_RADIUS "
     "AL_EXT_STEREO_ANGLES "
     "AL_LOKI_quadriphonic "
+    "AL_SOFTX_async_voice_changes "
     "AL_SOFT_bformat_ex "
     "AL_SOFTX_bformat_hoa "
     "AL_SOFT_block_alignment "
@@ -68,17 +69,21 @@ constexpr ALchar alExtList[] =
     "AL_SOFT_direct_channels "
     "AL_SOFT_direct_channels_remix "
     "AL_SOFT_effect_target "
+    "AL_SOFTX_event_batch "
     "AL_SOFT_events "
     "AL_SOFT_gain_clamp_ex "
     "AL_SOFTX_hold_on_disconnect "
     "AL_SOFT_loop_points "
     "AL_SOFTX_map_buffer "
     "AL_SOFT_MSADPCM "
+    "AL_SOFTX_source_batch "
     "AL_SOFT_source_latency "
     "AL_SOFT_source_length "
+    "AL_SOFTX_source_priority "
     "AL_SOFT_source_resampler "
     "AL_SOFT_source_spatialize "
-    "AL_SOFT_UHJ";
+    "AL_SOFT_UHJ "
+    "AL_SOFTX_virtual_voices";
 
 } // namespace
 
@@ -183,7 +188,8 @@ void ALCcontext::init()
     mParams.mDistanceModel = mDistanceModel;
 
 
-    mAsyncEvents = RingBuffer::Create(511, sizeof(AsyncEvent), false);
+    mAsyncEvents = RingBuffer::Create(EventRingSize(mALDevice->NumMonoSources +
+        mALDevice->NumStereoSources), sizeof(AsyncEvent), false);
     StartEventThrd(this);
 
 
@@ -16,6 +16,7 @@
 #include "alnumeric.h"
 #include "atomic.h"
 #include "core/context.h"
+#include "inprogext.h"
 #include "intrusive_ptr.h"
 #include "vector.h"
 
@@ -87,6 +88,9 @@ struct ALCcontext : public al::intrusive_ref<ALCcontext>, ContextBase {
     std::mutex mEventCbLock;
     ALEVENTPROCSOFT mEventCb{};
     void *mEventParam{nullptr};
+    /* If set, events are delivered in batches to this instead of mEventCb. */
+    ALEVENTBATCHPROCSOFT mEventBatchCb{};
+    void *mEventBatchParam{nullptr};
 
     ALlistener mListener{};
 
@@ -94,6 +98,14 @@ struct ALCcontext : public al::intrusive_ref<ALCcontext>, ContextBase {
     ALuint mNumSources{0};
     std::mutex mSourceLock;
 
+    /* When enabled, voice changes (playing, stopping, etc) are sent to the
+     * mixer without waiting for a current mix to finish. The unsynced flag is
+     * then set, and a wait is done before any source memory the mixer may
+     * still be using is released. Both are protected by mSourceLock.
+     */
+    bool mAsyncVoiceChanges{false};
+    bool mVoiceChangesUnsynced{false};
+
     al::vector<EffectSlotSubList> mEffectSlotList;
     ALuint mNumEffectSlots{0u};
     std::mutex mEffectSlotLock;
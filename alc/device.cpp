@@ -3,6 +3,7 @@
 
 #include "device.h"
 
+#include <cinttypes>
 #include <numeric>
 #include <stddef.h>
 
@@ -32,6 +33,33 @@ ALCdevice::~ALCdevice()
 {
     TRACE("Freeing device %p\n", voidp{this});
 
+    if(const uint64_t updates{mMixTimes.Updates.load(std::memory_order_relaxed)})
+    {
+        static constexpr std::array<const char*,MixStageCount> StageNames{{
+            "params", "voices", "effects", "post-process", "limiter", "distance comp", "dither"
+        }};
+
+        /* Report the mixing time against the time the mixed samples cover. */
+        const uint64_t samples{mMixTimes.Samples.load(std::memory_order_relaxed)};
+        const uint64_t total{mMixTimes.TotalTime.load(std::memory_order_relaxed)};
+        const double budget{static_cast<double>(samples) * 1e9 / Frequency};
+        TRACE("Mixer timing: %" PRIu64 " updates, %" PRIu64 " samples, %.3fms total (%.2f%% of "
+            "budget), %.3fms max\n", updates, samples, static_cast<double>(total) / 1e6,
+            static_cast<double>(total) * 100.0 / budget,
+            static_cast<double>(mMixTimes.MaxUpdateTime.load(std::memory_order_relaxed)) / 1e6);
+        for(size_t i{0};i < MixStageCount;++i)
+        {
+            const uint64_t stage{mMixTimes.StageTime[i].load(std::memory_order_relaxed)};
+            TRACE("  %s: %.3fms (%.3fus/update)\n", StageNames[i],
+                static_cast<double>(stage) / 1e6,
+                static_cast<double>(stage) / 1e3 / static_cast<double>(updates));
+        }
+        TRACE("  voice counts: %u mixed, %u virtual, %u max mixed\n",
+            mMixTimes.MixedVoices.load(std::memory_order_relaxed),
+            mMixTimes.VirtualVoices.load(std::memory_order_relaxed),
+            mMixTimes.MaxMixedVoices.load(std::memory_order_relaxed));
+    }
+
     Backend = nullptr;
 
     size_t count{std::accumulate(BufferList.cbegin(), BufferList.cend(), size_t{0u},
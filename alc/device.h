@@ -119,6 +119,14 @@ struct ALCdevice : public al::intrusive_ref<ALCdevice>, DeviceBase {
     std::mutex BufferLock;
     al::vector<BufferSubList> BufferList;
 
+    /* Memory budget and usage, in bytes, of the buffers' pre-decoded float
+     * sample caches. The clock provides the buffer use stamps for LRU
+     * eviction. Protected by BufferLock.
+     */
+    size_t mBufferCacheBudget{0u};
+    size_t mBufferCacheSize{0u};
+    uint64_t mBufferCacheClock{0u};
+
     // Map of Effects for this device
     std::mutex EffectLock;
     al::vector<EffectSubList> EffectList;
@@ -118,6 +118,9 @@ void ChorusState::update(const ContextBase *Context, const EffectSlot *Slot,
         static_cast<float>(mDelay - mindelay));
 
     mFeedback = props->Chorus.Feedback;
+    /* The longest the modulated delay gets, in whole samples. */
+    const uint maxdelay{(static_cast<uint>(mDelay + float2int(mDepth)) >> MixerFracBits) + 1};
+    mTailLength = CalcFeedbackTailLength(maxdelay, mFeedback);
 
     /* Gains for left and right sides */
     static constexpr auto lcoeffs = CalcDirectionCoeffs({-1.0f, 0.0f, 0.0f});
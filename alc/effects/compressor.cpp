@@ -33,6 +33,7 @@
 #include "config.h"
 
 #include <array>
+#include <cmath>
 #include <cstdlib>
 #include <iterator>
 #include <utility>
@@ -95,6 +96,11 @@ void CompressorState::deviceUpdate(const DeviceBase *device, const Buffer&)
      */
     mAttackMult  = std::pow(AMP_ENVELOPE_MAX/AMP_ENVELOPE_MIN, 1.0f/attackCount);
     mReleaseMult = std::pow(AMP_ENVELOPE_MIN/AMP_ENVELOPE_MAX, 1.0f/releaseCount);
+
+    /* The output is the input with a varying gain, but the envelope needs to
+     * keep processing silence to release back down after the input stops.
+     */
+    mTailLength = float2uint(std::ceil(releaseCount));
 }
 
 void CompressorState::update(const ContextBase*, const EffectSlot *slot,
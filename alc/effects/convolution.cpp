@@ -3,12 +3,12 @@
 
 #include <algorithm>
 #include <array>
-#include <complex>
 #include <cstddef>
 #include <functional>
 #include <iterator>
 #include <memory>
 #include <stdint.h>
+#include <thread>
 #include <utility>
 
 #ifdef HAVE_SSE_INTRINSICS
@@ -18,7 +18,6 @@
 #endif
 
 #include "albyte.h"
-#include "alcomplex.h"
 #include "almalloc.h"
 #include "alnumbers.h"
 #include "alnumeric.h"
@@ -33,30 +32,41 @@
 #include "core/effectslot.h"
 #include "core/filters/splitter.h"
 #include "core/fmt_traits.h"
+#include "core/fpu_ctrl.h"
+#include "core/helpers.h"
+#include "core/logging.h"
 #include "core/mixer.h"
 #include "intrusive_ptr.h"
 #include "polyphase_resampler.h"
+#include "realfft.h"
+#include "threads.h"
 #include "vector.h"
 
+/* This is a user config option for processing the tail of long convolution
+ * responses with a background thread.
+ */
+bool ConvolutionTailThread{false};
 
 namespace {
 
 /* Convolution reverb is implemented using a segmented overlap-add method. The
  * impulse response is broken up into multiple segments of 128 samples, and
- * each segment has an FFT applied with a 256-sample buffer (the latter half
- * left silent) to get its frequency-domain response. The resulting response
- * has its positive/non-mirrored frequencies saved (129 bins) in each segment.
+ * each segment has a real FFT applied with a 256-sample buffer (the latter
+ * half left silent) to get its frequency-domain response. The resulting
+ * response has its positive/non-mirrored frequencies saved in each segment,
+ * as 128 real and 128 imaginary components (the Nyquist bin being packed in
+ * with the DC bin, see RealFFT).
  *
  * Input samples are similarly broken up into 128-sample segments, with an FFT
- * applied to each new incoming segment to get its 129 bins. A history of FFT'd
+ * applied to each new incoming segment to get its bins. A history of FFT'd
  * input segments is maintained, equal to the length of the impulse response.
  *
  * To apply the reverberation, each impulse response segment is convolved with
  * its paired input segment (using complex multiplies, far cheaper than FIRs),
- * accumulating into a 256-bin FFT buffer. The input history is then shifted to
- * align with later impulse response segments for next time.
+ * accumulating into a frequency-domain buffer. The input history is then
+ * shifted to align with later impulse response segments for next time.
  *
- * An inverse FFT is then applied to the accumulated FFT buffer to get a 256-
+ * An inverse FFT is then applied to the accumulated buffer to get a 256-
  * sample time-domain response for output, which is split in two halves. The
  * first half is the 128-sample output, and the second half is a 128-sample
  * (really, 127) delayed extension, which gets added to the output next time.
@@ -69,6 +79,15 @@ namespace {
  * the first segment is applied directly in the time-domain as the samples come
  * in. Once enough have been retrieved, the FFT is applied on the input and
  * it's paired with the remaining (FFT'd) filter segments for processing.
+ *
+ * Since the cost of this grows with the length of the impulse response, long
+ * responses are split in two tiers. The 128-sample segments only cover the
+ * head of the response, and the tail uses segments of 1024 samples (with a
+ * 2048-sample FFT), processed each time 1024 new input samples are gathered.
+ * The tail starts two tail segments into the response, so its output isn't
+ * needed until one tail segment's worth of samples after it's calculated.
+ * This allows it to be processed asynchronously by a background thread, which
+ * only needs to finish before the next tail segment is ready.
  */
 
 
@@ -124,11 +143,28 @@ constexpr float Deg2Rad(float x) noexcept
 { return static_cast<float>(al::numbers::pi / 180.0 * x); }
 
 
-using complex_d = std::complex<double>;
-
 constexpr size_t ConvolveUpdateSize{256};
 constexpr size_t ConvolveUpdateSamples{ConvolveUpdateSize / 2};
 
+/* Each segment's frequency-domain response is stored as ConvolveUpdateSamples
+ * real components followed by as many imaginary components.
+ */
+constexpr size_t ConvolveSegmentSize{ConvolveUpdateSize};
+
+/* Tail segments have 1024 samples, with the tail starting after 2048 samples
+ * of head segments. The tail's output is accumulated into a ring buffer that
+ * holds enough for the latest calculated output to be added while the prior
+ * is still playing.
+ */
+constexpr size_t ConvolveTailSamples{1024};
+constexpr size_t ConvolveTailSize{ConvolveTailSamples * 2};
+constexpr size_t ConvolveHeadLength{ConvolveTailSamples * 2};
+constexpr size_t ConvolveTailRingSize{ConvolveTailSamples * 4};
+
+/* Must be less than 15 characters (16 including terminating null) for
+ * compatibility with pthread_setname_np limitations. */
+#define CONVOLVE_TAIL_THREAD_NAME "alsoft-convtail"
+
 
 void apply_fir(al::span<float> dst, const float *RESTRICT src, const float *RESTRICT filter)
 {
@@ -176,6 +212,64 @@ void apply_fir(al::span<float> dst, const float *RESTRICT src, const float *REST
 #endif
 }
 
+/* Accumulates the complex products of the input and filter responses, for
+ * count segments with m bins each. The DC/Nyquist bin's packed components are
+ * real, so they need to be multiplied separately.
+ */
+void apply_cmac(float *RESTRICT accum, const float *RESTRICT input, const float *RESTRICT filter,
+    const size_t count, const size_t m)
+{
+    float *RESTRICT accRe{al::assume_aligned<16>(accum)};
+    float *RESTRICT accIm{al::assume_aligned<16>(accum + m)};
+    float dc{accRe[0]}, nyquist{accIm[0]};
+    for(size_t s{0};s < count;++s)
+    {
+        const float *RESTRICT inRe{al::assume_aligned<16>(input)};
+        const float *RESTRICT inIm{al::assume_aligned<16>(input + m)};
+        const float *RESTRICT fRe{al::assume_aligned<16>(filter)};
+        const float *RESTRICT fIm{al::assume_aligned<16>(filter + m)};
+        dc += inRe[0] * fRe[0];
+        nyquist += inIm[0] * fIm[0];
+
+#ifdef HAVE_SSE_INTRINSICS
+        for(size_t i{0};i < m;i+=4)
+        {
+            const __m128 ar{_mm_load_ps(&inRe[i])}, ai{_mm_load_ps(&inIm[i])};
+            const __m128 br{_mm_load_ps(&fRe[i])}, bi{_mm_load_ps(&fIm[i])};
+            const __m128 r{_mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi))};
+            const __m128 j{_mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br))};
+            _mm_store_ps(&accRe[i], _mm_add_ps(_mm_load_ps(&accRe[i]), r));
+            _mm_store_ps(&accIm[i], _mm_add_ps(_mm_load_ps(&accIm[i]), j));
+        }
+
+#elif defined(HAVE_NEON)
+
+        for(size_t i{0};i < m;i+=4)
+        {
+            const float32x4_t ar{vld1q_f32(&inRe[i])}, ai{vld1q_f32(&inIm[i])};
+            const float32x4_t br{vld1q_f32(&fRe[i])}, bi{vld1q_f32(&fIm[i])};
+            const float32x4_t r{vmlsq_f32(vmlaq_f32(vld1q_f32(&accRe[i]), ar, br), ai, bi)};
+            const float32x4_t j{vmlaq_f32(vmlaq_f32(vld1q_f32(&accIm[i]), ar, bi), ai, br)};
+            vst1q_f32(&accRe[i], r);
+            vst1q_f32(&accIm[i], j);
+        }
+
+#else
+
+        for(size_t i{0};i < m;++i)
+        {
+            accRe[i] += inRe[i]*fRe[i] - inIm[i]*fIm[i];
+            accIm[i] += inRe[i]*fIm[i] + inIm[i]*fRe[i];
+        }
+#endif
+
+        input += m*2;
+        filter += m*2;
+    }
+    accRe[0] = dc;
+    accIm[0] = nyquist;
+}
+
 struct ConvolutionState final : public EffectState {
     FmtChannels mChannels{};
     AmbiLayout mAmbiLayout{};
@@ -187,11 +281,41 @@ struct ConvolutionState final : public EffectState {
     al::vector<std::array<float,ConvolveUpdateSamples>,16> mFilter;
     al::vector<std::array<float,ConvolveUpdateSamples*2>,16> mOutput;
 
-    alignas(16) std::array<complex_d,ConvolveUpdateSize> mFftBuffer{};
+    const RealFFT mFft{ConvolveUpdateSize};
+    alignas(16) std::array<float,ConvolveUpdateSize> mFftBuffer{};
+    alignas(16) std::array<float,ConvolveSegmentSize> mFftAccum{};
 
     size_t mCurrentSegment{0};
     size_t mNumConvolveSegs{0};
 
+    /* Tail processing. The input is gathered into mTailInput, and copied to
+     * mTailJobInput for the tail job to process. The job's output is then
+     * added to the ring buffer at mTailJobPos.
+     */
+    const RealFFT mTailFft{ConvolveTailSize};
+    size_t mNumTailSegs{0};
+    size_t mCurrentTailSegment{0};
+    size_t mTailFifoPos{0};
+    size_t mTailPos{0};
+    size_t mTailJobPos{0};
+    al::vector<float,16> mTailInput;
+    al::vector<float,16> mTailJobInput;
+    al::vector<float,16> mTailBuffer;
+    al::vector<float,16> mTailAccum;
+    al::vector<float,16> mTailComplexData;
+    al::vector<float,16> mTailOutput;
+    al::vector<float,16> mTailRing;
+
+    std::thread mTailThread;
+    al::semaphore mTailSem;
+    al::semaphore mTailDoneSem;
+    std::atomic<bool> mTailQuit{false};
+    /* Set by whichever of the tail thread or mixer processes the pending
+     * job.
+     */
+    std::atomic<bool> mTailJobClaimed{true};
+    bool mTailPending{false};
+
     struct ChannelData {
         alignas(16) FloatBufferLine mBuffer{};
         float mHfScale{};
@@ -201,11 +325,16 @@ struct ConvolutionState final : public EffectState {
     };
     using ChannelDataArray = al::FlexArray<ChannelData>;
     std::unique_ptr<ChannelDataArray> mChans;
-    std::unique_ptr<complex_d[]> mComplexData;
+    al::vector<float,16> mComplexData;
 
 
     ConvolutionState() = default;
-    ~ConvolutionState() override = default;
+    ~ConvolutionState() override;
+
+    void tailThreadProc();
+    void processTail();
+    void waitTail();
+    void finishTail();
 
     void NormalMix(const al::span<FloatBufferLine> samplesOut, const size_t samplesToDo);
     void UpsampleMix(const al::span<FloatBufferLine> samplesOut, const size_t samplesToDo);
@@ -221,6 +350,98 @@ struct ConvolutionState final : public EffectState {
     DEF_NEWDEL(ConvolutionState)
 };
 
+ConvolutionState::~ConvolutionState()
+{
+    if(mTailThread.joinable())
+    {
+        mTailQuit.store(true, std::memory_order_release);
+        mTailSem.post();
+        mTailThread.join();
+    }
+}
+
+void ConvolutionState::tailThreadProc()
+{
+    SetRTPriority();
+    althrd_setname(CONVOLVE_TAIL_THREAD_NAME);
+
+    FPUCtl mixer_mode{};
+    while(true)
+    {
+        mTailSem.wait();
+        if(mTailQuit.load(std::memory_order_acquire))
+            break;
+        /* The mixer may have needed the output before this thread got to
+         * the job, and processed it itself.
+         */
+        if(mTailJobClaimed.exchange(true, std::memory_order_acq_rel))
+            continue;
+        processTail();
+        mTailDoneSem.post();
+    }
+}
+
+/* Calculates the output for the tail segments from the latest input in
+ * mTailJobInput, storing it in mTailOutput.
+ */
+void ConvolutionState::processTail()
+{
+    const size_t numChans{mChans->size()};
+    const size_t curseg{mCurrentTailSegment};
+
+    auto fftiter = std::copy(mTailJobInput.cbegin(), mTailJobInput.cend(), mTailBuffer.begin());
+    std::fill(fftiter, mTailBuffer.end(), 0.0f);
+    float *curinput{&mTailComplexData[curseg*ConvolveTailSize]};
+    mTailFft.forward(mTailBuffer.data(), curinput, curinput+ConvolveTailSamples);
+
+    const float *filter{mTailComplexData.data() + mNumTailSegs*ConvolveTailSize};
+    for(size_t c{0};c < numChans;++c)
+    {
+        std::fill(mTailAccum.begin(), mTailAccum.end(), 0.0f);
+
+        apply_cmac(mTailAccum.data(), curinput, filter, mNumTailSegs-curseg,
+            ConvolveTailSamples);
+        filter += (mNumTailSegs-curseg) * ConvolveTailSize;
+        apply_cmac(mTailAccum.data(), mTailComplexData.data(), filter, curseg,
+            ConvolveTailSamples);
+        filter += curseg * ConvolveTailSize;
+
+        mTailFft.inverse(mTailAccum.data(), mTailAccum.data()+ConvolveTailSamples,
+            mTailBuffer.data());
+
+        constexpr float scale{1.0f / float{ConvolveTailSize}};
+        std::transform(mTailBuffer.cbegin(), mTailBuffer.cend(),
+            mTailOutput.begin() + ptrdiff_t(c*ConvolveTailSize),
+            [scale](const float s) noexcept -> float { return s * scale; });
+    }
+
+    mCurrentTailSegment = curseg ? (curseg-1) : (mNumTailSegs-1);
+}
+
+/* Makes sure the pending tail job is done. If the tail thread hasn't started
+ * on it yet, it's processed here instead, so the mixer only ever waits on a
+ * job that's in progress, not on the thread getting scheduled.
+ */
+void ConvolutionState::waitTail()
+{
+    if(!mTailJobClaimed.exchange(true, std::memory_order_acq_rel))
+        processTail();
+    else
+        mTailDoneSem.wait();
+}
+
+/* Adds the last tail job's output to the ring buffer. */
+void ConvolutionState::finishTail()
+{
+    for(size_t c{0};c < mChans->size();++c)
+    {
+        float *ring{&mTailRing[c*ConvolveTailRingSize]};
+        const float *output{&mTailOutput[c*ConvolveTailSize]};
+        for(size_t i{0};i < ConvolveTailSize;++i)
+            ring[(mTailJobPos+i) & (ConvolveTailRingSize-1)] += output[i];
+    }
+}
+
 void ConvolutionState::NormalMix(const al::span<FloatBufferLine> samplesOut,
     const size_t samplesToDo)
 {
@@ -245,22 +466,42 @@ void ConvolutionState::deviceUpdate(const DeviceBase *device, const Buffer &buff
 {
     constexpr uint MaxConvolveAmbiOrder{1u};
 
+    /* Make sure the tail thread isn't still working on the old data. */
+    if(mTailPending)
+    {
+        waitTail();
+        mTailPending = false;
+    }
+
     mFifoPos = 0;
     mInput.fill(0.0f);
     decltype(mFilter){}.swap(mFilter);
     decltype(mOutput){}.swap(mOutput);
-    mFftBuffer.fill(complex_d{});
+    mFftBuffer.fill(0.0f);
+    mFftAccum.fill(0.0f);
 
     mCurrentSegment = 0;
     mNumConvolveSegs = 0;
 
+    mNumTailSegs = 0;
+    mCurrentTailSegment = 0;
+    mTailFifoPos = 0;
+    mTailPos = 0;
+    decltype(mTailInput){}.swap(mTailInput);
+    decltype(mTailJobInput){}.swap(mTailJobInput);
+    decltype(mTailBuffer){}.swap(mTailBuffer);
+    decltype(mTailAccum){}.swap(mTailAccum);
+    decltype(mTailComplexData){}.swap(mTailComplexData);
+    decltype(mTailOutput){}.swap(mTailOutput);
+    decltype(mTailRing){}.swap(mTailRing);
+
     mChans = nullptr;
-    mComplexData = nullptr;
+    decltype(mComplexData){}.swap(mComplexData);
 
     /* An empty buffer doesn't need a convolution filter. */
+    mTailLength = 0;
     if(!buffer.storage || buffer.storage->mSampleLen < 1) return;
 
-    constexpr size_t m{ConvolveUpdateSize/2 + 1};
     auto bytesPerSample = BytesFromFmt(buffer.storage->mType);
     auto realChannels = ChannelsFromFmt(buffer.storage->mChannels, buffer.storage->mAmbiOrder);
     auto numChannels = ChannelsFromFmt(buffer.storage->mChannels,
@@ -287,17 +528,52 @@ void ConvolutionState::deviceUpdate(const DeviceBase *device, const Buffer &buff
     mFilter.resize(numChannels, {});
     mOutput.resize(numChannels, {});
 
+    /* Long impulse responses get split into head and tail segments, with the
+     * head only covering the start of the response. The rest is handled by
+     * the (much fewer) tail segments.
+     */
+    const bool useTail{resampledCount > ConvolveHeadLength*2};
+    const size_t headCount{useTail ? ConvolveHeadLength : resampledCount};
+
+    /* The output continues for the length of the response, after the input
+     * FIFO and any tail output still in the ring buffer.
+     */
+    mTailLength = static_cast<uint>(resampledCount + ConvolveUpdateSamples
+        + (useTail ? ConvolveTailRingSize : 0u));
+
     /* Calculate the number of segments needed to hold the impulse response and
      * the input history (rounded up), and allocate them. Exclude one segment
      * which gets applied as a time-domain FIR filter. Make sure at least one
      * segment is allocated to simplify handling.
      */
-    mNumConvolveSegs = (resampledCount+(ConvolveUpdateSamples-1)) / ConvolveUpdateSamples;
+    mNumConvolveSegs = (headCount+(ConvolveUpdateSamples-1)) / ConvolveUpdateSamples;
     mNumConvolveSegs = maxz(mNumConvolveSegs, 2) - 1;
 
-    const size_t complex_length{mNumConvolveSegs * m * (numChannels+1)};
-    mComplexData = std::make_unique<complex_d[]>(complex_length);
-    std::fill_n(mComplexData.get(), complex_length, complex_d{});
+    mComplexData.resize(mNumConvolveSegs * ConvolveSegmentSize * (numChannels+1), 0.0f);
+
+    if(useTail)
+    {
+        mNumTailSegs = (resampledCount-ConvolveHeadLength+(ConvolveTailSamples-1)) /
+            ConvolveTailSamples;
+
+        mTailInput.resize(ConvolveTailSamples, 0.0f);
+        mTailJobInput.resize(ConvolveTailSamples, 0.0f);
+        mTailBuffer.resize(ConvolveTailSize, 0.0f);
+        mTailAccum.resize(ConvolveTailSize, 0.0f);
+        mTailComplexData.resize(mNumTailSegs * ConvolveTailSize * (numChannels+1), 0.0f);
+        mTailOutput.resize(ConvolveTailSize * numChannels, 0.0f);
+        mTailRing.resize(ConvolveTailRingSize * numChannels, 0.0f);
+
+        if(ConvolutionTailThread && !mTailThread.joinable())
+        {
+            try {
+                mTailThread = std::thread{std::mem_fn(&ConvolutionState::tailThreadProc), this};
+            }
+            catch(std::exception &e) {
+                ERR("Failed to start convolution tail thread: %s\n", e.what());
+            }
+        }
+    }
 
     mChannels = buffer.storage->mChannels;
     mAmbiLayout = buffer.storage->mAmbiLayout;
@@ -305,7 +581,7 @@ void ConvolutionState::deviceUpdate(const DeviceBase *device, const Buffer &buff
     mAmbiOrder = minu(buffer.storage->mAmbiOrder, MaxConvolveAmbiOrder);
 
     auto srcsamples = std::make_unique<double[]>(maxz(buffer.storage->mSampleLen, resampledCount));
-    complex_d *filteriter = mComplexData.get() + mNumConvolveSegs*m;
+    float *filteriter{mComplexData.data() + mNumConvolveSegs*ConvolveSegmentSize};
     for(size_t c{0};c < numChannels;++c)
     {
         /* Load the samples from the buffer, and resample to match the device. */
@@ -325,14 +601,31 @@ void ConvolutionState::deviceUpdate(const DeviceBase *device, const Buffer &buff
         size_t done{first_size};
         for(size_t s{0};s < mNumConvolveSegs;++s)
         {
-            const size_t todo{minz(resampledCount-done, ConvolveUpdateSamples)};
+            const size_t todo{minz(headCount-done, ConvolveUpdateSamples)};
 
-            auto iter = std::copy_n(&srcsamples[done], todo, mFftBuffer.begin());
+            auto iter = std::transform(&srcsamples[done], &srcsamples[done]+todo,
+                mFftBuffer.begin(),
+                [](const double d) noexcept -> float { return static_cast<float>(d); });
             done += todo;
-            std::fill(iter, mFftBuffer.end(), complex_d{});
+            std::fill(iter, mFftBuffer.end(), 0.0f);
 
-            forward_fft(mFftBuffer);
-            filteriter = std::copy_n(mFftBuffer.cbegin(), m, filteriter);
+            mFft.forward(mFftBuffer.data(), filteriter, filteriter+ConvolveUpdateSamples);
+            filteriter += ConvolveSegmentSize;
+        }
+
+        float *tailiter{mTailComplexData.data() + (mNumTailSegs*(c+1))*ConvolveTailSize};
+        for(size_t s{0};s < mNumTailSegs;++s)
+        {
+            const size_t todo{minz(resampledCount-done, ConvolveTailSamples)};
+
+            auto iter = std::transform(&srcsamples[done], &srcsamples[done]+todo,
+                mTailBuffer.begin(),
+                [](const double d) noexcept -> float { return static_cast<float>(d); });
+            done += todo;
+            std::fill(iter, mTailBuffer.end(), 0.0f);
+
+            mTailFft.forward(mTailBuffer.data(), tailiter, tailiter+ConvolveTailSamples);
+            tailiter += ConvolveTailSize;
         }
     }
 }
@@ -499,7 +792,6 @@ void ConvolutionState::process(const size_t samplesToDo,
     if(mNumConvolveSegs < 1)
         return;
 
-    constexpr size_t m{ConvolveUpdateSize/2 + 1};
     size_t curseg{mCurrentSegment};
     auto &chans = *mChans;
 
@@ -523,6 +815,28 @@ void ConvolutionState::process(const size_t samplesToDo,
             std::transform(fifo_iter, fifo_iter+todo, buf_iter, buf_iter, std::plus<>{});
         }
 
+        if(mNumTailSegs > 0)
+        {
+            /* Add in the tail's output, and gather the input for the next tail
+             * segment.
+             */
+            for(size_t c{0};c < chans.size();++c)
+            {
+                float *ring{&mTailRing[c*ConvolveTailRingSize]};
+                auto buf_iter = chans[c].mBuffer.begin() + base;
+                for(size_t i{0};i < todo;++i)
+                {
+                    float &sample = ring[(mTailPos+i) & (ConvolveTailRingSize-1)];
+                    buf_iter[i] += sample;
+                    sample = 0.0f;
+                }
+            }
+            mTailPos = (mTailPos+todo) & (ConvolveTailRingSize-1);
+
+            std::copy_n(samplesIn[0].begin() + base, todo, mTailInput.begin()+mTailFifoPos);
+            mTailFifoPos += todo;
+        }
+
         mFifoPos += todo;
         base += todo;
 
@@ -537,60 +851,72 @@ void ConvolutionState::process(const size_t samplesToDo,
          * frequency bins to the FFT history.
          */
         auto fftiter = std::copy_n(mInput.cbegin(), ConvolveUpdateSamples, mFftBuffer.begin());
-        std::fill(fftiter, mFftBuffer.end(), complex_d{});
-        forward_fft(mFftBuffer);
+        std::fill(fftiter, mFftBuffer.end(), 0.0f);
+        float *curinput{&mComplexData[curseg*ConvolveSegmentSize]};
+        mFft.forward(mFftBuffer.data(), curinput, curinput+ConvolveUpdateSamples);
 
-        std::copy_n(mFftBuffer.cbegin(), m, &mComplexData[curseg*m]);
-
-        const complex_d *RESTRICT filter{mComplexData.get() + mNumConvolveSegs*m};
+        const float *filter{mComplexData.data() + mNumConvolveSegs*ConvolveSegmentSize};
         for(size_t c{0};c < chans.size();++c)
         {
-            std::fill_n(mFftBuffer.begin(), m, complex_d{});
+            mFftAccum.fill(0.0f);
 
             /* Convolve each input segment with its IR filter counterpart
              * (aligned in time).
              */
-            const complex_d *RESTRICT input{&mComplexData[curseg*m]};
-            for(size_t s{curseg};s < mNumConvolveSegs;++s)
-            {
-                for(size_t i{0};i < m;++i,++input,++filter)
-                    mFftBuffer[i] += *input * *filter;
-            }
-            input = mComplexData.get();
-            for(size_t s{0};s < curseg;++s)
-            {
-                for(size_t i{0};i < m;++i,++input,++filter)
-                    mFftBuffer[i] += *input * *filter;
-            }
-
-            /* Reconstruct the mirrored/negative frequencies to do a proper
-             * inverse FFT.
-             */
-            for(size_t i{m};i < ConvolveUpdateSize;++i)
-                mFftBuffer[i] = std::conj(mFftBuffer[ConvolveUpdateSize-i]);
+            apply_cmac(mFftAccum.data(), curinput, filter, mNumConvolveSegs-curseg,
+                ConvolveUpdateSamples);
+            filter += (mNumConvolveSegs-curseg) * ConvolveSegmentSize;
+            apply_cmac(mFftAccum.data(), mComplexData.data(), filter, curseg,
+                ConvolveUpdateSamples);
+            filter += curseg * ConvolveSegmentSize;
 
             /* Apply iFFT to get the 256 (really 255) samples for output. The
              * 128 output samples are combined with the last output's 127
              * second-half samples (and this output's second half is
              * subsequently saved for next time).
              */
-            inverse_fft(mFftBuffer);
+            mFft.inverse(mFftAccum.data(), mFftAccum.data()+ConvolveUpdateSamples,
+                mFftBuffer.data());
 
             /* The iFFT'd response is scaled up by the number of bins, so apply
              * the inverse to normalize the output.
              */
+            constexpr float scale{1.0f / float{ConvolveUpdateSize}};
             for(size_t i{0};i < ConvolveUpdateSamples;++i)
-                mOutput[c][i] =
-                    static_cast<float>(mFftBuffer[i].real() * (1.0/double{ConvolveUpdateSize})) +
-                    mOutput[c][ConvolveUpdateSamples+i];
+                mOutput[c][i] = mFftBuffer[i]*scale + mOutput[c][ConvolveUpdateSamples+i];
             for(size_t i{0};i < ConvolveUpdateSamples;++i)
-                mOutput[c][ConvolveUpdateSamples+i] =
-                    static_cast<float>(mFftBuffer[ConvolveUpdateSamples+i].real() *
-                        (1.0/double{ConvolveUpdateSize}));
+                mOutput[c][ConvolveUpdateSamples+i] = mFftBuffer[ConvolveUpdateSamples+i]*scale;
         }
 
         /* Shift the input history. */
         curseg = curseg ? (curseg-1) : (mNumConvolveSegs-1);
+
+        if(mTailFifoPos < ConvolveTailSamples)
+            continue;
+        mTailFifoPos = 0;
+
+        /* A new tail segment is ready. Its output starts playing one tail
+         * segment from now, by which time the tail thread must be done with
+         * it.
+         */
+        if(mTailPending)
+        {
+            waitTail();
+            finishTail();
+        }
+        std::swap(mTailInput, mTailJobInput);
+        mTailJobPos = (mTailPos+ConvolveTailSamples) & (ConvolveTailRingSize-1);
+        if(mTailThread.joinable())
+        {
+            mTailPending = true;
+            mTailJobClaimed.store(false, std::memory_order_release);
+            mTailSem.post();
+        }
+        else
+        {
+            processTail();
+            finishTail();
+        }
     }
     mCurrentSegment = curseg;
 
@@ -63,6 +63,8 @@ struct DedicatedState final : public EffectState {
 void DedicatedState::deviceUpdate(const DeviceBase*, const Buffer&)
 {
     std::fill(std::begin(mCurrentGains), std::end(mCurrentGains), 0.0f);
+    /* The output is only the scaled input, so there's no tail. */
+    mTailLength = 0;
 }
 
 void DedicatedState::update(const ContextBase*, const EffectSlot *slot,
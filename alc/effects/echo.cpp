@@ -110,6 +110,7 @@ void EchoState::update(const ContextBase *context, const EffectSlot *slot,
     mFilter.setParamsFromSlope(BiquadType::HighShelf, LowpassFreqRef/frequency, gainhf, 1.0f);
 
     mFeedGain = props->Echo.Feedback;
+    mTailLength = CalcFeedbackTailLength(mTap[1].delay, mFeedGain);
 
     /* Convert echo spread (where 0 = center, +/-1 = sides) to angle. */
     const float angle{std::asin(props->Echo.Spread)};
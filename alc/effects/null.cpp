@@ -46,6 +46,8 @@ NullState::~NullState() = default;
  */
 void NullState::deviceUpdate(const DeviceBase* /*device*/, const Buffer& /*buffer*/)
 {
+    /* No output means no tail, so the slot can sleep when it gets no input. */
+    mTailLength = 0;
 }
 
 /* This updates the effect state with new properties. This is called any time
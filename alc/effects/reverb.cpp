@@ -53,6 +53,12 @@
  */
 float ReverbBoost = 1.0f;
 
+/* This is a user config option for running the late reverb at a fraction of
+ * the device's sample rate (1 or 4), trading high frequency detail in the
+ * tail for less processing.
+ */
+unsigned int ReverbLateDecimation = 1;
+
 namespace {
 
 using uint = unsigned int;
@@ -443,6 +449,18 @@ struct ReverbState final : public EffectState {
     /* The current write offset for all delay lines. */
     size_t mOffset{};
 
+    /* The late reverb may run at a reduced rate, given by the decimation
+     * factor. The early reflections' output is averaged down into the late
+     * delay line, and the late output is linearly interpolated back up to the
+     * device rate. The late delay lines then have their own write offset, and
+     * the phase tracks where the next decimated sample starts.
+     */
+    uint mLateDecim{1u};
+    uint mLatePhase{0u};
+    size_t mLateOffset{};
+    float mLateDownSum[NUM_LINES]{};
+    float mLateUpLast[NUM_LINES][2]{};
+
     /* Temporary storage used when processing. */
     union {
         alignas(16) FloatBufferLine mTempLine{};
@@ -547,8 +565,11 @@ struct ReverbState final : public EffectState {
     void earlyUnfaded(size_t offset, const size_t samplesToDo);
     void earlyFaded(size_t offset, const size_t samplesToDo, const float fadeStep);
 
+    void feedLate(const size_t todo);
+
     void lateUnfaded(size_t offset, const size_t samplesToDo);
     void lateFaded(size_t offset, const size_t samplesToDo, const float fadeStep);
+    void upsampleLate(const size_t samplesToDo, const uint phase, const size_t lateCount);
 
     void deviceUpdate(const DeviceBase *device, const Buffer &buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
@@ -576,6 +597,9 @@ void ReverbState::allocLines(const float frequency)
      */
     size_t totalSamples{0u};
 
+    /* The late reverb lines run at the decimated rate. */
+    const float lateFreq{frequency / static_cast<float>(mLateDecim)};
+
     /* Multiplier for the maximum density value, i.e. density=1, which is
      * actually the least density...
      */
@@ -592,7 +616,7 @@ void ReverbState::allocLines(const float frequency)
     constexpr float LateLineDiffAvg{(LATE_LINE_LENGTHS.back()-LATE_LINE_LENGTHS.front()) /
         float{NUM_LINES}};
     length = ReverbMaxLateReverbDelay + LateLineDiffAvg*multiplier;
-    totalSamples += mLateDelayIn.calcLineLength(length, totalSamples, frequency, BufferLineSize);
+    totalSamples += mLateDelayIn.calcLineLength(length, totalSamples, lateFreq, BufferLineSize);
 
     /* The early vector all-pass line. */
     length = EARLY_ALLPASS_LENGTHS.back() * multiplier;
@@ -605,7 +629,7 @@ void ReverbState::allocLines(const float frequency)
 
     /* The late vector all-pass line. */
     length = LATE_ALLPASS_LENGTHS.back() * multiplier;
-    totalSamples += mLate.VecAp.Delay.calcLineLength(length, totalSamples, frequency, 0);
+    totalSamples += mLate.VecAp.Delay.calcLineLength(length, totalSamples, lateFreq, 0);
 
     /* The modulator's line length is calculated from the maximum modulation
      * time and depth coefficient, and halfed for the low-to-high frequency
@@ -618,7 +642,7 @@ void ReverbState::allocLines(const float frequency)
      * added to keep it stable when there is no modulation.
      */
     length = LATE_LINE_LENGTHS.back()*multiplier + max_mod_delay;
-    totalSamples += mLate.Delay.calcLineLength(length, totalSamples, frequency, 1);
+    totalSamples += mLate.Delay.calcLineLength(length, totalSamples, lateFreq, 1);
 
     if(totalSamples != mSampleBuffer.size())
         decltype(mSampleBuffer)(totalSamples).swap(mSampleBuffer);
@@ -639,6 +663,11 @@ void ReverbState::deviceUpdate(const DeviceBase *device, const Buffer&)
 {
     const auto frequency = static_cast<float>(device->Frequency);
 
+    /* Don't let the decimated rate go below 11025hz, so the late reverb
+     * keeps a reasonable bandwidth.
+     */
+    mLateDecim = (ReverbLateDecimation == 4 && device->Frequency/4 >= 11025) ? 4u : 1u;
+
     /* Allocate the delay lines. */
     allocLines(frequency);
 
@@ -679,9 +708,15 @@ void ReverbState::deviceUpdate(const DeviceBase *device, const Buffer&)
     for(auto &gains : mLate.PanGain)
         std::fill(std::begin(gains), std::end(gains), 0.0f);
 
+    std::fill(std::begin(mLateDownSum), std::end(mLateDownSum), 0.0f);
+    for(auto &last : mLateUpLast)
+        std::fill(std::begin(last), std::end(last), 0.0f);
+
     /* Reset fading and offset base. */
     mDoFading = true;
     mOffset = 0;
+    mLateOffset = 0;
+    mLatePhase = 0;
 
     if(device->mAmbiOrder > 1)
     {
@@ -920,8 +955,9 @@ void ReverbState::updateDelayLine(const float earlyDelay, const float lateDelay,
      *
      * Late reverb taps are based on the late line lengths to allow a zero-
      * delay path and offsets that would continue the propagation naturally
-     * into the late lines.
+     * into the late lines, and run at the late reverb's rate.
      */
+    const float lateFreq{frequency / static_cast<float>(mLateDecim)};
     for(size_t i{0u};i < NUM_LINES;i++)
     {
         float length{EARLY_TAP_LENGTHS[i]*density_mult};
@@ -930,7 +966,7 @@ void ReverbState::updateDelayLine(const float earlyDelay, const float lateDelay,
 
         length = (LATE_LINE_LENGTHS[i] - LATE_LINE_LENGTHS.front())/float{NUM_LINES}*density_mult +
             lateDelay;
-        mLateDelayTap[i][1] = float2uint(length * frequency);
+        mLateDelayTap[i][1] = float2uint(length * lateFreq);
     }
 }
 
@@ -1119,6 +1155,15 @@ void ReverbState::update(const ContextBase *Context, const EffectSlot *Slot,
         mFilter[i].Hp.copyParamsFrom(mFilter[0].Hp);
     }
 
+    /* The tail lasts through the initial delays and the longest line, then
+     * until the slowest decay reaches silence.
+     */
+    const float maxDecayTime{maxf(props->Reverb.DecayTime, maxf(lfDecayTime, hfDecayTime))};
+    const float tailTime{props->Reverb.ReflectionsDelay + props->Reverb.LateReverbDelay
+        + LATE_LINE_LENGTHS.back()*CalcDelayLengthMult(props->Reverb.Density)
+        + maxDecayTime*std::log(EffectTailSilenceGain)/std::log(ReverbDecayGain)};
+    mTailLength = float2uint(minf(tailTime*frequency, 1e9f));
+
     /* Update early and late 3D panning. */
     const float gain{props->Reverb.Gain * Slot->Gain * ReverbBoost};
     update3DPanning(props->Reverb.ReflectionsPan, props->Reverb.LateReverbPan,
@@ -1147,13 +1192,17 @@ void ReverbState::update(const ContextBase *Context, const EffectSlot *Slot,
         /* Get the mixing matrix coefficients. */
         CalcMatrixCoeffs(props->Reverb.Diffusion, &mMixX, &mMixY);
 
-        /* Update the modulator rate and depth. */
+        /* Update the modulator rate and depth, and the late lines, at the
+         * late reverb's rate.
+         */
+        const float lateFreq{frequency / static_cast<float>(mLateDecim)};
         mLate.Mod.updateModulator(props->Reverb.ModulationTime, props->Reverb.ModulationDepth,
-            frequency);
+            lateFreq);
 
-        /* Update the late lines. */
+        const float lateScale{static_cast<float>(mLateDecim)};
         mLate.updateLines(density_mult, props->Reverb.Diffusion, lfDecayTime,
-            props->Reverb.DecayTime, hfDecayTime, lf0norm, hf0norm, frequency);
+            props->Reverb.DecayTime, hfDecayTime, minf(lf0norm*lateScale, 0.49f),
+            minf(hf0norm*lateScale, 0.49f), lateFreq);
     }
 }
 
@@ -1333,6 +1382,48 @@ void VecAllpass::processFaded(const al::span<ReverbUpdateLine,NUM_LINES> samples
     }
 }
 
+/* Writes the early reflections to the late delay line input, scattered and
+ * reversed. When the late reverb runs at a reduced rate, each set of decimated
+ * samples is first averaged down to one, which is enough band-limiting for
+ * the diffuse late reverb and much cheaper than a proper low-pass filter. The
+ * average is written where the next set starts, to line up with how the late
+ * output gets interpolated back up.
+ */
+void ReverbState::feedLate(const size_t todo)
+{
+    const uint decim{mLateDecim};
+    size_t count{todo};
+    if(decim > 1)
+    {
+        const float scale{1.0f / static_cast<float>(decim)};
+        for(size_t j{0u};j < NUM_LINES;j++)
+        {
+            float *RESTRICT line{mTempSamples[j].data()};
+            float sum{mLateDownSum[j]};
+            uint phase{mLatePhase};
+            count = 0;
+            for(size_t i{0u};i < todo;++i)
+            {
+                /* The write position never passes the read position. */
+                const float sample{line[i]};
+                if(phase == 0)
+                {
+                    line[count++] = sum * scale;
+                    sum = 0.0f;
+                }
+                sum += sample;
+                if(++phase == decim) phase = 0;
+            }
+            mLateDownSum[j] = sum;
+        }
+        mLatePhase = static_cast<uint>((mLatePhase + todo) % decim);
+        if(count == 0) return;
+    }
+
+    VectorScatterRevDelayIn(mLateDelayIn, mLateOffset, mMixX, mMixY, mTempSamples, count);
+    mLateOffset += count;
+}
+
 /* This generates early reflections.
  *
  * This is done by obtaining the primary reflections (those arriving from the
@@ -1427,7 +1518,7 @@ void ReverbState::earlyUnfaded(size_t offset, const size_t samplesToDo)
          * reverb stage to pick up at the appropriate time, applying a scatter
          * and bounce to improve the initial diffusion in the late reverb.
          */
-        VectorScatterRevDelayIn(mLateDelayIn, offset, mixX, mixY, mTempSamples, todo);
+        feedLate(todo);
 
         base += todo;
         offset += todo;
@@ -1504,7 +1595,7 @@ void ReverbState::earlyFaded(size_t offset, const size_t samplesToDo, const floa
             }
         }
 
-        VectorScatterRevDelayIn(mLateDelayIn, offset, mixX, mixY, mTempSamples, todo);
+        feedLate(todo);
 
         base += todo;
         offset += todo;
@@ -1722,6 +1813,68 @@ void ReverbState::lateFaded(size_t offset, const size_t samplesToDo, const float
     }
 }
 
+/* Linearly interpolates the decimated late reverb output back up to the
+ * device rate. The interpolation also attenuates the images well enough for
+ * the late reverb's already damped high frequencies. The phase is the
+ * decimation phase from the start of the update, so each late sample lines up
+ * with the device-rate sample it was written at, delayed by one decimated
+ * sample.
+ */
+void ReverbState::upsampleLate(const size_t samplesToDo, const uint phase, const size_t lateCount)
+{
+    const uint decim{mLateDecim};
+    const float scale{1.0f / static_cast<float>(decim)};
+
+    /* Keep the last two decimated samples for the next update, before they
+     * get overwritten.
+     */
+    float prevLast[NUM_LINES][2];
+    for(size_t j{0u};j < NUM_LINES;j++)
+    {
+        prevLast[j][0] = mLateUpLast[j][0];
+        prevLast[j][1] = mLateUpLast[j][1];
+        if(lateCount > 0)
+        {
+            mLateUpLast[j][0] = (lateCount > 1) ? mLateSamples[j][lateCount-2] : prevLast[j][1];
+            mLateUpLast[j][1] = mLateSamples[j][lateCount-1];
+        }
+    }
+
+    /* Expand the decimated samples in place, working backwards so each one is
+     * read before its expanded output can overwrite it. Each output sample is
+     * interpolated between the preceding decimated sample and the most recent
+     * one, delaying the late reverb by one decimated sample.
+     */
+    const size_t first{(decim - phase) % decim};
+    const size_t end{lateCount ? first : samplesToDo};
+    for(size_t j{0u};j < NUM_LINES;j++)
+    {
+        float *RESTRICT line{mLateSamples[j].data()};
+        size_t pos{samplesToDo};
+        for(size_t src{lateCount};src > 0;)
+        {
+            --src;
+            const size_t start{first + src*decim};
+            const float prev{src ? line[src-1] : prevLast[j][1]};
+            const float step{(line[src]-prev) * scale};
+            while(pos > start)
+            {
+                --pos;
+                line[pos] = prev + step*static_cast<float>(pos-start);
+            }
+        }
+    }
+    /* The samples before the first decimated sample continue interpolating
+     * from the previous update.
+     */
+    for(size_t j{0u};j < NUM_LINES;j++)
+    {
+        for(size_t i{0u};i < end;++i)
+            mLateSamples[j][i] = lerpf(prevLast[j][0], prevLast[j][1],
+                static_cast<float>(phase+i)*scale);
+    }
+}
+
 void ReverbState::process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
 {
     size_t offset{mOffset};
@@ -1751,12 +1904,22 @@ void ReverbState::process(const size_t samplesToDo, const al::span<const FloatBu
         mEarlyDelayIn.write(offset, c, tmpspan.cbegin(), samplesToDo);
     }
 
+    /* The early reflections feed the late reverb as they're generated, which
+     * at a reduced rate may yield fewer (or no) late samples to process.
+     */
+    const size_t lateOffset{mLateOffset};
+    const uint latePhase{mLatePhase};
+
     /* Process reverb for these samples. */
     if LIKELY(!mDoFading)
     {
         /* Generate non-faded early reflections and late reverb. */
         earlyUnfaded(offset, samplesToDo);
-        lateUnfaded(offset, samplesToDo);
+        const size_t lateCount{mLateOffset - lateOffset};
+        if(lateCount > 0)
+            lateUnfaded(lateOffset, lateCount);
+        if(mLateDecim > 1)
+            upsampleLate(samplesToDo, latePhase, lateCount);
 
         /* Finally, mix early reflections and late reverb. */
         mixOut(samplesOut, samplesToDo);
@@ -1767,7 +1930,11 @@ void ReverbState::process(const size_t samplesToDo, const al::span<const FloatBu
 
         /* Generate cross-faded early reflections and late reverb. */
         earlyFaded(offset, samplesToDo, fadeStep);
-        lateFaded(offset, samplesToDo, fadeStep);
+        const size_t lateCount{mLateOffset - lateOffset};
+        if(lateCount > 0)
+            lateFaded(lateOffset, lateCount, 1.0f / static_cast<float>(lateCount));
+        if(mLateDecim > 1)
+            upsampleLate(samplesToDo, latePhase, lateCount);
 
         mixOut(samplesOut, samplesToDo);
 
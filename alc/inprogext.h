@@ -54,6 +54,80 @@ AL_API void AL_APIENTRY alAuxiliaryEffectSlotStopvSOFT(ALsizei n, const ALuint *
 #define AL_STOP_SOURCES_ON_DISCONNECT_SOFT       0x19AB
 #endif
 
+#ifndef AL_SOFT_async_voice_changes
+#define AL_SOFT_async_voice_changes
+#define AL_ASYNC_VOICE_CHANGES_SOFT              0x19C0
+#endif
+
+#ifndef AL_SOFT_virtual_voices
+#define AL_SOFT_virtual_voices
+#define AL_MIXED_VOICES_SOFT                     0x19C1
+#define AL_VIRTUAL_VOICES_SOFT                   0x19C2
+#endif
+
+#ifndef AL_SOFT_source_priority
+#define AL_SOFT_source_priority
+#define AL_SOURCE_PRIORITY_SOFT                  0x19C3
+#endif
+
+/* alSourcePropsfvSOFT sets each record's float property on its source, as
+ * alSourcefv would, with the sources updated once at the end. Only float
+ * properties that don't depend on the source's state are accepted (pitch,
+ * gains, distances, cone, factors, radius, stereo angles, position, velocity,
+ * direction, and orientation); records use as many values as the property
+ * takes. Every record is checked before any are applied, so an invalid
+ * source ID, property, or value generates an error and leaves all sources
+ * unchanged.
+ */
+#ifndef AL_SOFT_source_batch
+#define AL_SOFT_source_batch
+typedef struct ALsourcepropSOFT {
+    ALuint source;
+    ALenum param;
+    ALfloat values[6];
+} ALsourcepropSOFT;
+typedef void (AL_APIENTRY*LPALSOURCEPROPSFVSOFT)(ALsizei count, const ALsourcepropSOFT *props);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alSourcePropsfvSOFT(ALsizei count, const ALsourcepropSOFT *props);
+#endif
+#endif
+
+#ifndef AL_SOFT_event_batch
+#define AL_SOFT_event_batch
+typedef struct ALeventSOFT {
+    ALenum eventType;
+    ALuint object;
+    ALuint param;
+    ALsizei length;
+    const ALchar *message;
+} ALeventSOFT;
+typedef void (AL_APIENTRY*ALEVENTBATCHPROCSOFT)(ALsizei count, const ALeventSOFT *events,
+    void *userParam);
+typedef void (AL_APIENTRY*LPALEVENTBATCHCALLBACKSOFT)(ALEVENTBATCHPROCSOFT callback, void *userParam);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alEventBatchCallbackSOFT(ALEVENTBATCHPROCSOFT callback, void *userParam);
+#endif
+#endif
+
+#ifndef ALC_SOFT_mixer_timing
+#define ALC_SOFT_mixer_timing
+#define ALC_MIX_TIMING_SOFT                      0x19D0
+#define ALC_MIX_UPDATE_COUNT_SOFT                0x19D1
+#define ALC_MIX_SAMPLE_COUNT_SOFT                0x19D2
+#define ALC_MIX_TIME_TOTAL_SOFT                  0x19D3
+#define ALC_MIX_TIME_MAX_SOFT                    0x19D4
+#define ALC_MIX_TIME_PARAMS_SOFT                 0x19D5
+#define ALC_MIX_TIME_VOICES_SOFT                 0x19D6
+#define ALC_MIX_TIME_EFFECTS_SOFT                0x19D7
+#define ALC_MIX_TIME_POSTPROCESS_SOFT            0x19D8
+#define ALC_MIX_TIME_LIMITER_SOFT                0x19D9
+#define ALC_MIX_TIME_DISTANCE_COMP_SOFT          0x19DA
+#define ALC_MIX_TIME_DITHER_SOFT                 0x19DB
+#define ALC_MIX_MIXED_VOICES_SOFT                0x19DC
+#define ALC_MIX_VIRTUAL_VOICES_SOFT              0x19DD
+#define ALC_MIX_MAX_MIXED_VOICES_SOFT            0x19DE
+#endif
+
 
 /* Non-standard export. Not part of any extension. */
 AL_API const ALchar* AL_APIENTRY alsoft_get_version(void);
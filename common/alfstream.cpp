@@ -21,6 +21,19 @@ void ifstream::open(const char *filename, std::ios_base::openmode mode)
 
 ifstream::~ifstream() = default;
 
+
+ofstream::ofstream(const char *filename, std::ios_base::openmode mode)
+  : std::ofstream{utf8_to_wstr(filename).c_str(), mode}
+{ }
+
+void ofstream::open(const char *filename, std::ios_base::openmode mode)
+{
+    std::wstring wstr{utf8_to_wstr(filename)};
+    std::ofstream::open(wstr.c_str(), mode);
+}
+
+ofstream::~ofstream() = default;
+
 } // namespace al
 
 #endif
@@ -28,6 +28,25 @@ public:
     ~ifstream() override;
 };
 
+// Inherit from std::ofstream to accept UTF-8 filenames
+class ofstream final : public std::ofstream {
+public:
+    explicit ofstream(const char *filename, std::ios_base::openmode mode=std::ios_base::out);
+    explicit ofstream(const std::string &filename, std::ios_base::openmode mode=std::ios_base::out)
+        : ofstream{filename.c_str(), mode} { }
+
+    explicit ofstream(const wchar_t *filename, std::ios_base::openmode mode=std::ios_base::out)
+        : std::ofstream{filename, mode} { }
+    explicit ofstream(const std::wstring &filename, std::ios_base::openmode mode=std::ios_base::out)
+        : ofstream{filename.c_str(), mode} { }
+
+    void open(const char *filename, std::ios_base::openmode mode=std::ios_base::out);
+    void open(const std::string &filename, std::ios_base::openmode mode=std::ios_base::out)
+    { open(filename.c_str(), mode); }
+
+    ~ofstream() override;
+};
+
 } // namespace al
 
 #else /* _WIN32 */
@@ -37,6 +56,7 @@ public:
 namespace al {
 
 using ifstream = std::ifstream;
+using ofstream = std::ofstream;
 
 } // namespace al
 
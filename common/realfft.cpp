@@ -0,0 +1,224 @@
+
+#include "config.h"
+
+#include "realfft.h"
+
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "albit.h"
+#include "alnumbers.h"
+#include "opthelpers.h"
+
+
+RealFFT::RealFFT(size_t fftsize) : mSize{fftsize}
+{
+    assert(fftsize >= 8 && al::popcount(fftsize) == 1);
+
+    const size_t half{fftsize / 2};
+    const auto log2_half = static_cast<unsigned int>(al::countr_zero(half));
+
+    mBitReverse.resize(half);
+    for(size_t idx{0};idx < half;++idx)
+    {
+        unsigned int revidx{0u};
+        size_t imask{idx};
+        for(unsigned int i{0};i < log2_half;++i)
+        {
+            revidx = (revidx<<1) | static_cast<unsigned int>(imask&1);
+            imask >>= 1;
+        }
+        mBitReverse[idx] = revidx;
+    }
+
+    mTwiddleRe.resize(half);
+    mTwiddleIm.resize(half);
+    for(size_t h{1};h < half;h <<= 1)
+    {
+        for(size_t j{0};j < h;++j)
+        {
+            const double arg{al::numbers::pi * static_cast<double>(j) / static_cast<double>(h)};
+            mTwiddleRe[h+j] = static_cast<float>(std::cos(arg));
+            mTwiddleIm[h+j] = static_cast<float>(-std::sin(arg));
+        }
+    }
+
+    mSplitRe.resize(half/2 + 1);
+    mSplitIm.resize(half/2 + 1);
+    for(size_t k{0};k <= half/2;++k)
+    {
+        const double arg{2.0 * al::numbers::pi * static_cast<double>(k) /
+            static_cast<double>(fftsize)};
+        mSplitRe[k] = static_cast<float>(std::cos(arg));
+        mSplitIm[k] = static_cast<float>(-std::sin(arg));
+    }
+}
+
+RealFFT::~RealFFT() = default;
+
+
+/* Iterative decimation-in-time FFT over the bit-reversed complex input. The
+ * first two passes are combined as a twiddle-free radix-4 pass, and the rest
+ * run the butterflies 4 at a time.
+ */
+template<bool Inverse>
+void RealFFT::complexFft(float *RESTRICT re, float *RESTRICT im) const noexcept
+{
+    const size_t half{mSize / 2};
+
+    for(size_t n{0};n < half;n += 4)
+    {
+        const float b0r{re[n+0] + re[n+1]}, b0i{im[n+0] + im[n+1]};
+        const float b1r{re[n+0] - re[n+1]}, b1i{im[n+0] - im[n+1]};
+        const float b2r{re[n+2] + re[n+3]}, b2i{im[n+2] + im[n+3]};
+        const float b3r{re[n+2] - re[n+3]}, b3i{im[n+2] - im[n+3]};
+        /* Multiply b3 by -i (or i for the inverse). */
+        const float tr{Inverse ? -b3i : b3i}, ti{Inverse ? b3r : -b3r};
+
+        re[n+0] = b0r + b2r; im[n+0] = b0i + b2i;
+        re[n+2] = b0r - b2r; im[n+2] = b0i - b2i;
+        re[n+1] = b1r + tr;  im[n+1] = b1i + ti;
+        re[n+3] = b1r - tr;  im[n+3] = b1i - ti;
+    }
+
+    for(size_t h{4};h < half;h <<= 1)
+    {
+        const float *RESTRICT twr{al::assume_aligned<16>(&mTwiddleRe[h])};
+        const float *RESTRICT twi{al::assume_aligned<16>(&mTwiddleIm[h])};
+        for(size_t k{0};k < half;k += h*2)
+        {
+            float *RESTRICT re0{re + k}, *RESTRICT im0{im + k};
+            float *RESTRICT re1{re0 + h}, *RESTRICT im1{im0 + h};
+#ifdef HAVE_SSE_INTRINSICS
+            for(size_t j{0};j < h;j += 4)
+            {
+                const __m128 wr{_mm_load_ps(&twr[j])}, wi{_mm_load_ps(&twi[j])};
+                const __m128 br{_mm_load_ps(&re1[j])}, bi{_mm_load_ps(&im1[j])};
+                const __m128 tr{Inverse ?
+                    _mm_add_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi)) :
+                    _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi))};
+                const __m128 ti{Inverse ?
+                    _mm_sub_ps(_mm_mul_ps(bi, wr), _mm_mul_ps(br, wi)) :
+                    _mm_add_ps(_mm_mul_ps(bi, wr), _mm_mul_ps(br, wi))};
+                const __m128 ar{_mm_load_ps(&re0[j])}, ai{_mm_load_ps(&im0[j])};
+                _mm_store_ps(&re1[j], _mm_sub_ps(ar, tr));
+                _mm_store_ps(&im1[j], _mm_sub_ps(ai, ti));
+                _mm_store_ps(&re0[j], _mm_add_ps(ar, tr));
+                _mm_store_ps(&im0[j], _mm_add_ps(ai, ti));
+            }
+#elif defined(HAVE_NEON)
+            for(size_t j{0};j < h;j += 4)
+            {
+                const float32x4_t wr{vld1q_f32(&twr[j])}, wi{vld1q_f32(&twi[j])};
+                const float32x4_t br{vld1q_f32(&re1[j])}, bi{vld1q_f32(&im1[j])};
+                const float32x4_t tr{Inverse ? vmlaq_f32(vmulq_f32(br, wr), bi, wi) :
+                    vmlsq_f32(vmulq_f32(br, wr), bi, wi)};
+                const float32x4_t ti{Inverse ? vmlsq_f32(vmulq_f32(bi, wr), br, wi) :
+                    vmlaq_f32(vmulq_f32(bi, wr), br, wi)};
+                const float32x4_t ar{vld1q_f32(&re0[j])}, ai{vld1q_f32(&im0[j])};
+                vst1q_f32(&re1[j], vsubq_f32(ar, tr));
+                vst1q_f32(&im1[j], vsubq_f32(ai, ti));
+                vst1q_f32(&re0[j], vaddq_f32(ar, tr));
+                vst1q_f32(&im0[j], vaddq_f32(ai, ti));
+            }
+#else
+            for(size_t j{0};j < h;++j)
+            {
+                const float wr{twr[j]}, wi{Inverse ? -twi[j] : twi[j]};
+                const float tr{re1[j]*wr - im1[j]*wi};
+                const float ti{im1[j]*wr + re1[j]*wi};
+                re1[j] = re0[j] - tr; im1[j] = im0[j] - ti;
+                re0[j] += tr; im0[j] += ti;
+            }
+#endif
+        }
+    }
+}
+
+void RealFFT::forward(const float *input, float *re, float *im) const noexcept
+{
+    const size_t half{mSize / 2};
+
+    /* Treat the even and odd samples as the real and imaginary parts of a
+     * half-size complex signal.
+     */
+    for(size_t n{0};n < half;++n)
+    {
+        const unsigned int revidx{mBitReverse[n]};
+        re[revidx] = input[n*2 + 0];
+        im[revidx] = input[n*2 + 1];
+    }
+    complexFft<false>(re, im);
+
+    /* Separate the even and odd samples' responses, and combine them into the
+     * real signal's response. The DC and Nyquist bins are purely real.
+     */
+    const float z0r{re[0]}, z0i{im[0]};
+    re[0] = z0r + z0i;
+    im[0] = z0r - z0i;
+    for(size_t k{1};k <= half/2;++k)
+    {
+        const size_t j{half - k};
+        const float ar{re[k]}, ai{im[k]};
+        const float br{re[j]}, bi{-im[j]};
+
+        const float er{(ar+br) * 0.5f}, ei{(ai+bi) * 0.5f};
+        /* o = -i * (a-b)/2 */
+        const float orl{(ai-bi) * 0.5f}, oim{(br-ar) * 0.5f};
+
+        const float wr{mSplitRe[k]}, wi{mSplitIm[k]};
+        const float tr{orl*wr - oim*wi}, ti{orl*wi + oim*wr};
+
+        re[k] = er + tr; im[k] = ei + ti;
+        re[j] = er - tr; im[j] = ti - ei;
+    }
+}
+
+void RealFFT::inverse(float *re, float *im, float *output) const noexcept
+{
+    const size_t half{mSize / 2};
+
+    /* Rebuild the half-size complex response from the real signal's. */
+    const float x0r{re[0]}, xhr{im[0]};
+    re[0] = x0r + xhr;
+    im[0] = x0r - xhr;
+    for(size_t k{1};k <= half/2;++k)
+    {
+        const size_t j{half - k};
+        const float ar{re[k]}, ai{im[k]};
+        const float br{re[j]}, bi{-im[j]};
+
+        const float er{ar + br}, ei{ai + bi};
+        const float dr{ar - br}, di{ai - bi};
+
+        const float wr{mSplitRe[k]}, wi{-mSplitIm[k]};
+        const float orl{dr*wr - di*wi}, oim{dr*wi + di*wr};
+
+        re[k] = er - oim; im[k] = ei + orl;
+        re[j] = er + oim; im[j] = orl - ei;
+    }
+
+    for(size_t n{0};n < half;++n)
+    {
+        const unsigned int revidx{mBitReverse[n]};
+        if(n < revidx)
+        {
+            std::swap(re[n], re[revidx]);
+            std::swap(im[n], im[revidx]);
+        }
+    }
+    complexFft<true>(re, im);
+
+    for(size_t n{0};n < half;++n)
+    {
+        output[n*2 + 0] = re[n];
+        output[n*2 + 1] = im[n];
+    }
+}
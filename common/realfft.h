@@ -0,0 +1,59 @@
+#ifndef REALFFT_H
+#define REALFFT_H
+
+#include <stddef.h>
+
+#include "vector.h"
+
+
+/* A single-precision FFT for real signals, with precomputed bit-reversal and
+ * twiddle tables. The real signal of N samples is transformed as an N/2-point
+ * complex FFT, with a final pass to separate the even and odd samples' parts.
+ *
+ * The frequency-domain response is stored split, as separate arrays of N/2
+ * real and imaginary components. Since the DC and Nyquist bins are always
+ * real, the Nyquist bin's real component is packed in as the imaginary
+ * component of the DC bin. This keeps bins contiguous and the arrays a
+ * multiple of 4 for SIMD processing.
+ *
+ * The same RealFFT may be used by multiple threads at once.
+ */
+class RealFFT {
+    size_t mSize{0u};
+    al::vector<unsigned int> mBitReverse;
+    /* Twiddle factors for the complex FFT passes, with the factors for the
+     * pass of butterfly span h stored at index h (so they're 16-byte aligned
+     * when h >= 4).
+     */
+    al::vector<float,16> mTwiddleRe, mTwiddleIm;
+    /* Twiddle factors for separating the real FFT's even and odd parts. */
+    al::vector<float,16> mSplitRe, mSplitIm;
+
+    template<bool Inverse>
+    void complexFft(float *re, float *im) const noexcept;
+
+public:
+    /** Creates an FFT of fftsize real samples, which must be a power of 2 that's
+     * at least 8.
+     */
+    explicit RealFFT(size_t fftsize);
+    ~RealFFT();
+
+    size_t size() const noexcept { return mSize; }
+
+    /**
+     * Calculates the frequency-domain response of the size() samples in input,
+     * writing size()/2 components to each of re and im. The output must be
+     * 16-byte aligned.
+     */
+    void forward(const float *input, float *re, float *im) const noexcept;
+
+    /**
+     * Calculates the size() samples of the time-domain signal for the given
+     * frequency-domain response, scaled by size(). The response in re and im
+     * is used as scratch space, and must be 16-byte aligned.
+     */
+    void inverse(float *re, float *im, float *output) const noexcept;
+};
+
+#endif /* REALFFT_H */
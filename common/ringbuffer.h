@@ -99,6 +99,8 @@ public:
     { mWritePtr.fetch_add(cnt, std::memory_order_acq_rel); }
 
     size_t getElemSize() const noexcept { return mElemSize; }
+    /** Return the maximum number of elements the ringbuffer can hold. */
+    size_t getCapacity() const noexcept { return mWriteSize; }
 
     /**
      * Create a new ringbuffer to hold at least `sz' elements of `elem_sz'
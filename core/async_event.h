@@ -1,9 +1,12 @@
 #ifndef CORE_EVENT_H
 #define CORE_EVENT_H
 
+#include <stddef.h>
+
 #include "almalloc.h"
 
 struct EffectState;
+struct RingBuffer;
 
 using uint = unsigned int;
 
@@ -20,6 +23,7 @@ struct AsyncEvent {
 
         /* Internal events. */
         ReleaseEffectState = 65536,
+        SwitchEventRing,
     };
 
     enum class SrcState {
@@ -44,6 +48,7 @@ struct AsyncEvent {
             char msg[244];
         } disconnect;
         EffectState *mEffectState;
+        RingBuffer *mRing;
     } u{};
 
     AsyncEvent() noexcept = default;
@@ -52,4 +57,11 @@ struct AsyncEvent {
     DISABLE_ALLOC()
 };
 
+/* Returns the number of events an async event ring should hold for the given
+ * number of sources. Each source can complete buffers and change state in the
+ * same update, so this makes room for both from every source at once.
+ */
+constexpr size_t EventRingSize(const size_t numSources) noexcept
+{ return (numSources*2 + 64 > 511) ? numSources*2 + 64 : 511; }
+
 #endif
@@ -116,7 +116,12 @@ void ContextBase::allocVoices(size_t addcount)
     const size_t totalcount{(mVoiceClusters.size()+addcount) * clustersize};
     TRACE("Increasing allocated voices to %zu\n", totalcount);
 
-    auto newarray = VoiceArray::Create(totalcount);
+    /* Allocate space for twice as many pointers, so the mixer has scratch
+     * space to rank the voices when limiting them.
+     */
+    void *ptr{al_calloc(alignof(VoiceArray), VoiceArray::Sizeof(totalcount*2))};
+    std::unique_ptr<VoiceArray> newarray{al::construct_at(static_cast<VoiceArray*>(ptr),
+        totalcount)};
     while(addcount)
     {
         mVoiceClusters.emplace_back(std::make_unique<Voice[]>(clustersize));
@@ -128,6 +128,15 @@ struct ContextBase {
             mActiveVoiceCount.load(std::memory_order_acquire)};
     }
 
+    /* The number of playing voices that were mixed, and that were left
+     * virtual for being inaudible, in the last update.
+     */
+    std::atomic<uint> mMixedVoiceCount{0u};
+    std::atomic<uint> mVirtualVoiceCount{0u};
+
+    /* The maximum number of playing voices to mix, or 0 for no limit. */
+    uint mVoiceLimit{0u};
+
 
     using EffectSlotArray = al::FlexArray<EffectSlot*>;
     std::atomic<EffectSlotArray*> mActiveAuxSlots{nullptr};
@@ -136,6 +145,8 @@ struct ContextBase {
     al::semaphore mEventSem;
     std::unique_ptr<RingBuffer> mAsyncEvents;
     std::atomic<uint> mEnabledEvts{0u};
+    /* Events that couldn't be sent because the event ring was full. */
+    std::atomic<uint> mEventsDropped{0u};
 
     /* Asynchronous voice change actions are processed as a linked list of
      * VoiceChange objects by the mixer, which is atomically appended to.
@@ -35,6 +35,18 @@ inline std::array<reg_type,4> get_cpuid(unsigned int f)
     __get_cpuid(f, &ret[0], &ret[1], &ret[2], &ret[3]);
     return ret;
 }
+inline std::array<reg_type,4> get_cpuid_count(unsigned int f, unsigned int subf)
+{
+    std::array<reg_type,4> ret{};
+    __cpuid_count(f, subf, ret[0], ret[1], ret[2], ret[3]);
+    return ret;
+}
+inline unsigned long long get_xcr0()
+{
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx)<<32) | eax;
+}
 #define CAN_GET_CPUID
 #elif defined(HAVE_CPUID_INTRINSIC) \
     && (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
@@ -45,6 +57,14 @@ inline std::array<reg_type,4> get_cpuid(unsigned int f)
     (__cpuid)(ret.data(), f);
     return ret;
 }
+inline std::array<reg_type,4> get_cpuid_count(unsigned int f, unsigned int subf)
+{
+    std::array<reg_type,4> ret{};
+    (__cpuidex)(ret.data(), static_cast<int>(f), static_cast<int>(subf));
+    return ret;
+}
+inline unsigned long long get_xcr0()
+{ return _xgetbv(0); }
 #define CAN_GET_CPUID
 #endif
 
@@ -105,11 +125,30 @@ al::optional<CPUInfo> GetCPUInfo()
             ret.mCaps |= CPU_CAP_SSE3;
         if((ret.mCaps&CPU_CAP_SSE3) && (cpuregs[2]&(1<<19)))
             ret.mCaps |= CPU_CAP_SSE4_1;
+
+        /* AVX needs the OS to support saving the full YMM registers, as
+         * indicated by the OSXSAVE bit and XCR0.
+         */
+        if((ret.mCaps&CPU_CAP_SSE4_1) && (cpuregs[2]&(1<<27)) && (cpuregs[2]&(1<<28))
+            && (get_xcr0()&0x6) == 0x6)
+        {
+            if((cpuregs[2]&(1<<12)))
+                ret.mCaps |= CPU_CAP_FMA;
+            if(maxfunc >= 7)
+            {
+                const auto extregs = get_cpuid_count(7, 0);
+                if((extregs[1]&(1<<5)))
+                    ret.mCaps |= CPU_CAP_AVX2;
+            }
+        }
     }
 
 #else
 
     /* Assume support for whatever's supported if we can't check for it */
+#if defined(HAVE_AVX2) && defined(__AVX2__) && defined(__FMA__)
+    ret.mCaps |= CPU_CAP_AVX2 | CPU_CAP_FMA;
+#endif
 #if defined(HAVE_SSE4_1)
 #warning "Assuming SSE 4.1 run-time support!"
     ret.mCaps |= CPU_CAP_SSE | CPU_CAP_SSE2 | CPU_CAP_SSE3 | CPU_CAP_SSE4_1;
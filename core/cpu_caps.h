@@ -13,6 +13,8 @@ enum {
     CPU_CAP_SSE3   = 1<<2,
     CPU_CAP_SSE4_1 = 1<<3,
     CPU_CAP_NEON   = 1<<4,
+    CPU_CAP_AVX2   = 1<<5,
+    CPU_CAP_FMA    = 1<<6,
 };
 
 struct CPUInfo {
@@ -1,12 +1,15 @@
 
 #include "config.h"
 
+#include <thread>
+
 #include "bformatdec.h"
 #include "bs2b.h"
 #include "device.h"
 #include "front_stablizer.h"
 #include "hrtf.h"
 #include "mastering.h"
+#include "mixer_pool.h"
 
 
 al::FlexArray<ContextBase*> DeviceBase::sEmptyContextArray{0u};
@@ -21,3 +24,41 @@ DeviceBase::~DeviceBase()
     auto *oldarray = mContexts.exchange(nullptr, std::memory_order_relaxed);
     if(oldarray != &sEmptyContextArray) delete oldarray;
 }
+
+
+uint DeviceBase::waitForMixSlow() const noexcept
+{
+    /* Most waits are short, so spin a bit first, then give up the rest of the
+     * time slice a few times. If the mix still isn't done, it's probably a
+     * long one, so block until the mixer says it's finished.
+     */
+    constexpr uint SpinCount{1024u};
+    constexpr uint YieldCount{16u};
+
+    uint refcount{};
+    for(uint i{0u};i < SpinCount;++i)
+    {
+        refcount = MixCount.load(std::memory_order_acquire);
+        if(!(refcount&1)) return refcount;
+    }
+    for(uint i{0u};i < YieldCount;++i)
+    {
+        std::this_thread::yield();
+        refcount = MixCount.load(std::memory_order_acquire);
+        if(!(refcount&1)) return refcount;
+    }
+
+    std::unique_lock<std::mutex> waitlock{mMixWaitLock};
+    mMixWaiters.fetch_add(1u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while((refcount=MixCount.load(std::memory_order_acquire))&1)
+        mMixWaitCond.wait(waitlock);
+    mMixWaiters.fetch_sub(1u, std::memory_order_relaxed);
+    return refcount;
+}
+
+void DeviceBase::wakeMixWaiters() noexcept
+{
+    std::lock_guard<std::mutex> _{mMixWaitLock};
+    mMixWaitCond.notify_all();
+}
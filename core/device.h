@@ -2,11 +2,14 @@
 #define CORE_DEVICE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <bitset>
 #include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -31,6 +34,8 @@ struct Compressor;
 struct ContextBase;
 struct DirectHrtfState;
 struct HrtfStore;
+class MixerPool;
+struct RingBuffer;
 
 using uint = unsigned int;
 
@@ -136,7 +141,103 @@ enum {
     DeviceFlagsCount
 };
 
-struct DeviceBase {
+/* Redirects mixing output from a target buffer to a separate set of lines.
+ * Used by mixer worker threads to mix into private storage, which gets added
+ * to the real target once all workers are done.
+ */
+struct MixTargetRemap {
+    FloatBufferLine *mBase;
+    size_t mCount;
+    FloatBufferLine *mTarget;
+    bool mUsed;
+};
+
+/* Temp storage used for mixer processing. The device has its own, and each
+ * mixer worker thread has another.
+ */
+struct MixerScratch {
+    static constexpr size_t MixerLineSize{BufferLineSize + MaxResamplerPadding +
+        DecoderBase::sMaxDelay};
+    static constexpr size_t MixerChannelsMax{16};
+    using MixerBufferLine = std::array<float,MixerLineSize>;
+    alignas(16) std::array<MixerBufferLine,MixerChannelsMax> mSampleData;
+
+    alignas(16) float ResampledData[BufferLineSize];
+    alignas(16) float FilteredData[BufferLineSize];
+    union {
+        alignas(16) float HrtfSourceData[BufferLineSize + HrtfHistoryLength];
+        alignas(16) float NfcSampleData[BufferLineSize];
+    };
+
+    /* Persistent storage for HRTF mixing. */
+    alignas(16) float2 HrtfAccumData[BufferLineSize + HrirLength];
+
+    /* Output remapping and event storage, only used for worker threads. The
+     * main mixer mixes directly to the target buffers and sends events to the
+     * context.
+     */
+    al::span<MixTargetRemap> mTargetRemaps;
+    RingBuffer *mEventRing{nullptr};
+    uint mRemapSamples{0u};
+    bool mHrtfAccumUsed{false};
+
+    al::span<FloatBufferLine> getTarget(const al::span<FloatBufferLine> target) noexcept
+    {
+        for(MixTargetRemap &remap : mTargetRemaps)
+        {
+            const size_t offset{static_cast<size_t>(target.data() - remap.mBase)};
+            if(offset >= remap.mCount)
+                continue;
+            if(!remap.mUsed)
+            {
+                for(size_t i{0};i < remap.mCount;++i)
+                    std::fill_n(remap.mTarget[i].begin(), mRemapSamples, 0.0f);
+                remap.mUsed = true;
+            }
+            return {remap.mTarget + offset, target.size()};
+        }
+        /* A worker can't safely write to a buffer it has no private copy of. */
+        return mTargetRemaps.empty() ? target : al::span<FloatBufferLine>{};
+    }
+};
+
+/* Stages of the device mix that are timed when mixer timing is enabled. */
+enum class MixStage : unsigned char {
+    Params,
+    Voices,
+    Effects,
+    PostProcess,
+    Limiter,
+    DistanceComp,
+    Dither,
+
+    Count
+};
+constexpr size_t MixStageCount{static_cast<size_t>(MixStage::Count)};
+
+/* Mixer timing counters. Only the mixer thread writes them, so they can be
+ * read at any time without locking, though not as a consistent set.
+ */
+struct MixTimings {
+    std::atomic<uint64_t> Updates{0u};
+    std::atomic<uint64_t> Samples{0u};
+
+    /* Accumulated nanoseconds spent in each stage and in whole updates, and
+     * the longest single update.
+     */
+    std::array<std::atomic<uint64_t>,MixStageCount> StageTime{};
+    std::atomic<uint64_t> TotalTime{0u};
+    std::atomic<uint64_t> MaxUpdateTime{0u};
+
+    /* Voices mixed and left virtual in the last update, for all contexts, and
+     * the most mixed in any one update.
+     */
+    std::atomic<uint> MixedVoices{0u};
+    std::atomic<uint> VirtualVoices{0u};
+    std::atomic<uint> MaxMixedVoices{0u};
+};
+
+struct DeviceBase : public MixerScratch {
     /* To avoid extraneous allocations, a 0-sized FlexArray<ContextBase*> is
      * defined globally as a sharable object.
      */
@@ -187,23 +288,6 @@ struct DeviceBase {
 
     AmbiRotateMatrix mAmbiRotateMatrix{};
 
-    /* Temp storage used for mixer processing. */
-    static constexpr size_t MixerLineSize{BufferLineSize + MaxResamplerPadding +
-        DecoderBase::sMaxDelay};
-    static constexpr size_t MixerChannelsMax{16};
-    using MixerBufferLine = std::array<float,MixerLineSize>;
-    alignas(16) std::array<MixerBufferLine,MixerChannelsMax> mSampleData;
-
-    alignas(16) float ResampledData[BufferLineSize];
-    alignas(16) float FilteredData[BufferLineSize];
-    union {
-        alignas(16) float HrtfSourceData[BufferLineSize + HrtfHistoryLength];
-        alignas(16) float NfcSampleData[BufferLineSize];
-    };
-
-    /* Persistent storage for HRTF mixing. */
-    alignas(16) float2 HrtfAccumData[BufferLineSize + HrirLength];
-
     /* Mixing buffer used by the Dry mix and Real output. */
     al::vector<FloatBufferLine, 16> MixBuffer;
 
@@ -235,6 +319,9 @@ struct DeviceBase {
 
     std::unique_ptr<Compressor> Limiter;
 
+    /* Worker threads for mixing voices in parallel with the mixer thread. */
+    std::unique_ptr<MixerPool> mMixerPool;
+
     /* Delay buffers used to compensate for speaker distances. */
     std::unique_ptr<DistanceComp> ChannelDelays;
 
@@ -242,6 +329,10 @@ struct DeviceBase {
     float DitherDepth{0.0f};
     uint DitherSeed{0u};
 
+    /* Mixer timing, if enabled. */
+    bool mTimeMixer{false};
+    MixTimings mMixTimes;
+
     /* Running count of the mixer invocations, in 31.1 fixed point. This
      * actually increments *twice* when mixing, first at the start and then at
      * the end, so the bottom bit indicates if the device is currently mixing
@@ -249,6 +340,13 @@ struct DeviceBase {
      */
     RefCount MixCount{0u};
 
+    /* Threads blocked in waitForMix, and the condition the mixer signals them
+     * with at the end of a mix.
+     */
+    mutable std::mutex mMixWaitLock;
+    mutable std::condition_variable mMixWaitCond;
+    mutable std::atomic<uint> mMixWaiters{0u};
+
     // Contexts created on this device
     std::atomic<al::FlexArray<ContextBase*>*> mContexts{nullptr};
 
@@ -262,13 +360,31 @@ struct DeviceBase {
     uint channelsFromFmt() const noexcept { return ChannelsFromDevFmt(FmtChans, mAmbiOrder); }
     uint frameSizeFromFmt() const noexcept { return bytesFromFmt() * channelsFromFmt(); }
 
+    /**
+     * Waits for any current mix to finish, returning the mix count. This spins
+     * briefly, then yields, then blocks until the mixer signals the end of the
+     * mix.
+     */
     uint waitForMix() const noexcept
     {
-        uint refcount;
-        while((refcount=MixCount.load(std::memory_order_acquire))&1) {
-        }
-        return refcount;
+        const uint refcount{MixCount.load(std::memory_order_acquire)};
+        if(likely(!(refcount&1))) return refcount;
+        return waitForMixSlow();
+    }
+    uint waitForMixSlow() const noexcept;
+
+    /**
+     * Increments the mix count at the end of a mix (or other update that
+     * waitForMix waits on), and wakes any blocked waiters.
+     */
+    void finishMix() noexcept
+    {
+        IncrementRef(MixCount);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(unlikely(mMixWaiters.load(std::memory_order_relaxed) != 0))
+            wakeMixWaiters();
     }
+    void wakeMixWaiters() noexcept;
 
     void ProcessHrtf(const size_t SamplesToDo);
     void ProcessAmbiDec(const size_t SamplesToDo);
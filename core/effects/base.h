@@ -1,6 +1,8 @@
 #ifndef CORE_EFFECTS_BASE_H
 #define CORE_EFFECTS_BASE_H
 
+#include <cmath>
+#include <limits>
 #include <stddef.h>
 
 #include "albyte.h"
@@ -21,6 +23,11 @@ struct RealMixParams;
 /** Target gain for the reverb decay feedback reaching the decay time. */
 constexpr float ReverbDecayGain{0.001f}; /* -60 dB */
 
+/** Output level an effect's tail is considered silent at, allowing for
+ * input that's somewhat above full scale.
+ */
+constexpr float EffectTailSilenceGain{0.000001f}; /* -120 dB */
+
 constexpr float ReverbMaxReflectionsDelay{0.3f};
 constexpr float ReverbMaxLateReverbDelay{0.1f};
 
@@ -177,6 +184,22 @@ struct EffectTarget {
     RealMixParams *RealOut;
 };
 
+/* Calculates the number of samples for a signal circulating through a
+ * feedback delay line of the given length to decay to silence, or the maximum
+ * if it never does.
+ */
+inline unsigned int CalcFeedbackTailLength(const size_t delay, const float feedback)
+{
+    constexpr unsigned int NoTail{std::numeric_limits<unsigned int>::max()};
+    const float fb{std::abs(feedback)};
+    if(!(fb < 1.0f)) return NoTail;
+
+    const float repeats{(fb > EffectTailSilenceGain)
+        ? std::ceil(std::log(EffectTailSilenceGain) / std::log(fb)) : 0.0f};
+    const double length{static_cast<double>(delay) * (repeats+1.0)};
+    return (length < NoTail) ? static_cast<unsigned int>(length) : NoTail;
+}
+
 struct EffectState : public al::intrusive_ref<EffectState> {
     struct Buffer {
         const BufferStorage *storage;
@@ -185,6 +208,13 @@ struct EffectState : public al::intrusive_ref<EffectState> {
 
     al::span<FloatBufferLine> mOutTarget;
 
+    /* The number of samples the effect may keep producing output for after
+     * its input goes silent. Once its input has been silent for this long, the
+     * mixer can stop processing it until it gets input again. Effects that
+     * don't set this are always processed.
+     */
+    unsigned int mTailLength{std::numeric_limits<unsigned int>::max()};
+
 
     virtual ~EffectState() = default;
 
@@ -3,10 +3,13 @@
 
 #include "effectslot.h"
 
+#include <algorithm>
+#include <cmath>
 #include <stddef.h>
 
 #include "almalloc.h"
 #include "context.h"
+#include "mixer/defs.h"
 
 
 EffectSlotArray *EffectSlot::CreatePtrArray(size_t count) noexcept
@@ -17,3 +20,24 @@ EffectSlotArray *EffectSlot::CreatePtrArray(size_t count) noexcept
     void *ptr{al_calloc(alignof(EffectSlotArray), EffectSlotArray::Sizeof(count*2))};
     return al::construct_at(static_cast<EffectSlotArray*>(ptr), count);
 }
+
+bool EffectSlot::needsProcessing(const size_t samplesToDo) noexcept
+{
+    auto is_audible = [](const float sample) noexcept -> bool
+    { return std::abs(sample) > GainSilenceThreshold; };
+    auto has_input = [samplesToDo,is_audible](const FloatBufferLine &buffer) noexcept -> bool
+    { return std::any_of(buffer.cbegin(), buffer.cbegin()+samplesToDo, is_audible); };
+
+    if(std::any_of(Wet.Buffer.cbegin(), Wet.Buffer.cend(), has_input))
+    {
+        mSilentSamples = 0;
+        return true;
+    }
+
+    /* With no input, keep processing until the effect's tail has played out. */
+    const uint tail{mEffectState->mTailLength};
+    if(mSilentSamples >= tail)
+        return false;
+    mSilentSamples += static_cast<uint>(std::min<size_t>(samplesToDo, tail-mSilentSamples));
+    return true;
+}
@@ -65,6 +65,14 @@ struct EffectSlot {
     float Gain{1.0f};
     bool  AuxSendAuto{true};
     EffectSlot *Target{nullptr};
+    /* The number of slots in the chain between this slot and the output.
+     * Slots at the same level don't feed into each other.
+     */
+    uint mLevel{0u};
+    /* The number of samples since the slot last had input, to let the effect
+     * sleep once its tail has decayed.
+     */
+    uint mSilentSamples{0u};
 
     EffectSlotType EffectType{EffectSlotType::None};
     EffectProps mEffectProps{};
@@ -81,6 +89,12 @@ struct EffectSlot {
     al::vector<FloatBufferLine,16> mWetBuffer;
 
 
+    /**
+     * Checks if the slot's effect needs to be processed for this update, given
+     * whether it has any input and how long it's been since it last did.
+     */
+    bool needsProcessing(const size_t samplesToDo) noexcept;
+
     static EffectSlotArray *CreatePtrArray(size_t count) noexcept;
 
     DEF_NEWDEL(EffectSlot)
@@ -35,6 +35,8 @@ bool AllowRTTimeLimit{true};
 #ifdef _WIN32
 
 #include <shlobj.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 const PathNamePair &GetProcBinary()
 {
@@ -170,6 +172,93 @@ al::vector<std::string> SearchDataFiles(const char *ext, const char *subdir)
     return results;
 }
 
+al::optional<std::string> GetCachePath(const char *subdir)
+{
+    auto is_slash = [](int c) noexcept -> int { return (c == '\\' || c == '/'); };
+
+    std::string path;
+    if((isalpha(subdir[0]) && subdir[1] == ':' && is_slash(subdir[2]))
+        || (subdir[0] == '\\' && subdir[1] == '\\' && subdir[2] == '?' && subdir[3] == '\\'))
+        path = subdir;
+    else
+    {
+        WCHAR buffer[MAX_PATH];
+        if(SHGetSpecialFolderPathW(nullptr, buffer, CSIDL_LOCAL_APPDATA, FALSE) == FALSE)
+            return al::nullopt;
+
+        path = wstr_to_utf8(buffer);
+        if(!is_slash(path.back()))
+            path += '\\';
+        path += subdir;
+    }
+    std::replace(path.begin(), path.end(), '/', '\\');
+    while(path.size() > 1 && is_slash(path.back()))
+        path.pop_back();
+
+    const int err{SHCreateDirectoryExW(nullptr, utf8_to_wstr(path.c_str()).c_str(), nullptr)};
+    if(err != ERROR_SUCCESS && err != ERROR_ALREADY_EXISTS && err != ERROR_FILE_EXISTS)
+    {
+        WARN("Failed to create cache directory %s: error %d\n", path.c_str(), err);
+        return al::nullopt;
+    }
+    return al::make_optional(std::move(path));
+}
+
+bool RenameFile(const char *oldname, const char *newname)
+{
+    return MoveFileExW(utf8_to_wstr(oldname).c_str(), utf8_to_wstr(newname).c_str(),
+        MOVEFILE_REPLACE_EXISTING) != FALSE;
+}
+
+bool MappedFile::open(const char *fname)
+{
+    HANDLE file{CreateFileW(utf8_to_wstr(fname).c_str(), GENERIC_READ, FILE_SHARE_READ|
+        FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)};
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fsize{};
+    if(!GetFileSizeEx(file, &fsize) || fsize.QuadPart <= 0
+        || static_cast<ULONGLONG>(fsize.QuadPart) > std::numeric_limits<size_t>::max())
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    /* The view keeps the mapping and file open, so the handles can be closed
+     * once it's made.
+     */
+    HANDLE mapping{CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    CloseHandle(file);
+    if(!mapping)
+        return false;
+    void *ptr{MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)};
+    CloseHandle(mapping);
+    if(!ptr)
+        return false;
+
+    if(mData)
+        UnmapViewOfFile(mData);
+    mData = ptr;
+    mSize = static_cast<size_t>(fsize.QuadPart);
+    return true;
+}
+
+MappedFile::~MappedFile()
+{
+    if(mData)
+        UnmapViewOfFile(mData);
+}
+
+al::optional<FileStamp> GetFileStamp(const char *fname)
+{
+    struct _stat64 st{};
+    if(_wstat64(utf8_to_wstr(fname).c_str(), &st) != 0)
+        return al::nullopt;
+    return al::make_optional(FileStamp{static_cast<uint64_t>(st.st_mtime),
+        static_cast<uint64_t>(st.st_size)});
+}
+
 void SetRTPriority(void)
 {
     if(RTPrioLevel > 0)
@@ -182,8 +271,11 @@ void SetRTPriority(void)
 #else
 
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <fcntl.h>
 #ifdef __FreeBSD__
 #include <sys/sysctl.h>
 #endif
@@ -425,6 +517,91 @@ al::vector<std::string> SearchDataFiles(const char *ext, const char *subdir)
     return results;
 }
 
+al::optional<std::string> GetCachePath(const char *subdir)
+{
+    std::string path;
+    if(subdir[0] == '/')
+        path = subdir;
+    else
+    {
+        if(auto cachepath = al::getenv("XDG_CACHE_HOME"))
+            path = std::move(*cachepath);
+        else if(auto homepath = al::getenv("HOME"))
+        {
+            path = std::move(*homepath);
+            if(!path.empty() && path.back() == '/')
+                path.pop_back();
+            path += "/.cache";
+        }
+        else
+            return al::nullopt;
+
+        if(path.empty() || path.back() != '/')
+            path += '/';
+        path += subdir;
+    }
+    while(path.size() > 1 && path.back() == '/')
+        path.pop_back();
+
+    /* Create each missing directory along the path. */
+    size_t pos{path.find('/', 1)};
+    while(true)
+    {
+        const std::string dir{path.substr(0, pos)};
+        if(mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            WARN("Failed to create cache directory %s: %s\n", dir.c_str(), strerror(errno));
+            return al::nullopt;
+        }
+        if(pos == std::string::npos)
+            break;
+        pos = path.find('/', pos+1);
+    }
+    return al::make_optional(std::move(path));
+}
+
+bool RenameFile(const char *oldname, const char *newname)
+{ return rename(oldname, newname) == 0; }
+
+bool MappedFile::open(const char *fname)
+{
+    const int fd{::open(fname, O_RDONLY)};
+    if(fd < 0)
+        return false;
+
+    /* The mapping keeps the file open, so the descriptor can be closed once
+     * it's made.
+     */
+    struct stat st{};
+    void *ptr{MAP_FAILED};
+    if(fstat(fd, &st) == 0 && st.st_size > 0)
+        ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(ptr == MAP_FAILED)
+        return false;
+
+    if(mData)
+        munmap(const_cast<void*>(mData), mSize);
+    mData = ptr;
+    mSize = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+MappedFile::~MappedFile()
+{
+    if(mData)
+        munmap(const_cast<void*>(mData), mSize);
+}
+
+al::optional<FileStamp> GetFileStamp(const char *fname)
+{
+    struct stat st{};
+    if(stat(fname, &st) != 0)
+        return al::nullopt;
+    return al::make_optional(FileStamp{static_cast<uint64_t>(st.st_mtime),
+        static_cast<uint64_t>(st.st_size)});
+}
+
 namespace {
 
 bool SetRTPriorityPthread(int prio)
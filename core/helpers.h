@@ -1,8 +1,10 @@
 #ifndef CORE_HELPERS_H
 #define CORE_HELPERS_H
 
+#include <cstdint>
 #include <string>
 
+#include "aloptional.h"
 #include "vector.h"
 
 
@@ -15,4 +17,39 @@ void SetRTPriority(void);
 
 al::vector<std::string> SearchDataFiles(const char *match, const char *subdir);
 
+/**
+ * Gets the path to a directory for cached data, creating it if necessary. A
+ * relative subdir is placed in the user's cache directory.
+ */
+al::optional<std::string> GetCachePath(const char *subdir);
+
+/* The modification time and size of a file, for detecting changes to it. */
+struct FileStamp { uint64_t mtime, size; };
+al::optional<FileStamp> GetFileStamp(const char *fname);
+
+/* Renames a file, replacing any existing file with the new name. */
+bool RenameFile(const char *oldname, const char *newname);
+
+/**
+ * A read-only memory mapping of a file. The mapped pages are shared with other
+ * processes mapping the same file.
+ */
+class MappedFile {
+    const void *mData{nullptr};
+    size_t mSize{0u};
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    ~MappedFile();
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /** Maps the whole of the given file. Returns false on failure. */
+    bool open(const char *fname);
+
+    const char *data() const noexcept { return static_cast<const char*>(mData); }
+    size_t size() const noexcept { return mSize; }
+};
+
 #endif /* CORE_HELPERS_H */
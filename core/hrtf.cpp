@@ -7,6 +7,8 @@
 #include <array>
 #include <cassert>
 #include <cctype>
+#include <chrono>
+#include <cinttypes>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -51,7 +53,13 @@ HrtfEntry::~HrtfEntry() = default;
 struct LoadedHrtf {
     std::string mFilename;
     std::unique_ptr<HrtfStore> mEntry;
+
+    LoadedHrtf(LoadedHrtf&&) = default;
+    LoadedHrtf& operator=(LoadedHrtf&&) = default;
+    /* GCC warns when it tries to inline this. */
+    ~LoadedHrtf();
 };
+LoadedHrtf::~LoadedHrtf() = default;
 
 /* Data set limits must be the same as or more flexible than those defined in
  * the makemhr utility.
@@ -1204,9 +1212,229 @@ al::span<const char> GetResource(int name)
 }
 #endif
 
+/* Loaded data sets are cached on disk after being resampled, so later loads
+ * for the same sample rate can skip parsing and resampling. The cache files
+ * store the HrtfStore's data in native byte order and layout, and are keyed by
+ * the source file's name, modification time and size. The version must be
+ * increased when the layout or processing of the stored data changes.
+ */
+constexpr char HrtfCacheMarker[8]{'A','L','H','R','T','F','C','F'};
+constexpr uint32_t HrtfCacheVersion{1};
+constexpr uint32_t HrtfCacheByteOrder{0x01020304};
+
+struct HrtfCacheHeader {
+    char mMagic[8];
+    uint32_t mVersion;
+    uint32_t mByteOrder;
+    uint32_t mHrirLength;
+    uint32_t mNameLength;
+    uint64_t mSrcTime;
+    uint64_t mSrcSize;
+    uint32_t mSampleRate;
+    uint32_t mIrSize;
+    uint32_t mFdCount;
+    uint32_t mEvCount;
+    uint32_t mIrCount;
+    uint32_t mReserved;
+};
+
+/* The offsets of the data in a cache file. The source filename follows the
+ * header, then the field infos, elevation infos, coefficients, and delays. The
+ * coefficients are 16-byte aligned for SIMD use.
+ */
+struct HrtfCacheLayout {
+    size_t mFields, mElevs, mCoeffs, mDelays, mTotal;
+
+    HrtfCacheLayout(size_t namelen, size_t fdcount, size_t evcount, size_t ircount) noexcept
+    {
+        mFields = RoundUp(sizeof(HrtfCacheHeader) + namelen, alignof(HrtfStore::Field));
+        mElevs = RoundUp(mFields + sizeof(HrtfStore::Field)*fdcount,
+            alignof(HrtfStore::Elevation));
+        mCoeffs = RoundUp(mElevs + sizeof(HrtfStore::Elevation)*evcount, 16);
+        mDelays = mCoeffs + sizeof(HrirArray)*ircount;
+        mTotal = mDelays + sizeof(ubyte2)*ircount;
+    }
+};
+
+uint64_t HashBytes(const char *data, size_t len) noexcept
+{
+    /* 64-bit FNV-1a */
+    uint64_t hash{0xcbf29ce484222325u};
+    for(size_t i{0};i < len;++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3u;
+    }
+    return hash;
+}
+
+std::string GetHrtfCacheName(const std::string &fname, const uint devrate)
+{
+    al::optional<std::string> path{GetCachePath(HrtfCachePath.c_str())};
+    if(!path) return std::string{};
+
+    char name[64];
+    snprintf(name, sizeof(name), "%016" PRIx64 "-%u.bin", HashBytes(fname.data(), fname.size()),
+        devrate);
+    std::string &ret = *path;
+#ifdef _WIN32
+    ret += '\\';
+#else
+    ret += '/';
+#endif
+    ret += name;
+    return ret;
+}
+
+std::unique_ptr<HrtfStore> LoadHrtfCache(const std::string &cachename, const std::string &fname,
+    const FileStamp &stamp, const uint devrate)
+{
+    auto mapping = std::make_unique<MappedFile>();
+    if(!mapping->open(cachename.c_str()))
+        return nullptr;
+
+    HrtfCacheHeader header{};
+    if(mapping->size() >= sizeof(header))
+        std::memcpy(&header, mapping->data(), sizeof(header));
+    if(memcmp(header.mMagic, HrtfCacheMarker, sizeof(HrtfCacheMarker)) != 0
+        || header.mVersion != HrtfCacheVersion || header.mByteOrder != HrtfCacheByteOrder
+        || header.mHrirLength != HrirLength)
+    {
+        TRACE("Ignoring incompatible HRTF cache %s\n", cachename.c_str());
+        return nullptr;
+    }
+    if(header.mNameLength != fname.size() || header.mSrcTime != stamp.mtime
+        || header.mSrcSize != stamp.size || header.mSampleRate != devrate)
+    {
+        TRACE("Ignoring stale HRTF cache %s\n", cachename.c_str());
+        return nullptr;
+    }
+    if(mapping->size() < sizeof(header)+fname.size()
+        || fname.compare(0, fname.size(), mapping->data()+sizeof(header), fname.size()) != 0)
+    {
+        TRACE("Ignoring mismatched HRTF cache %s\n", cachename.c_str());
+        return nullptr;
+    }
+
+    const HrtfCacheLayout layout{fname.size(), header.mFdCount, header.mEvCount, header.mIrCount};
+    if(header.mFdCount < MinFdCount || header.mFdCount > MaxFdCount
+        || header.mEvCount < MinEvCount || header.mEvCount > MaxEvCount*MaxFdCount
+        || header.mIrCount == 0 || header.mIrSize == 0 || header.mIrSize > HrirLength
+        || mapping->size() < layout.mTotal)
+    {
+        WARN("Invalid HRTF cache %s\n", cachename.c_str());
+        return nullptr;
+    }
+
+    /* The data is used directly from the mapping, which is page-aligned, so
+     * the offsets ensure the proper alignment.
+     */
+    const char *base{mapping->data()};
+    const al::span<const HrtfStore::Field> fields{
+        reinterpret_cast<const HrtfStore::Field*>(base + layout.mFields), header.mFdCount};
+    const al::span<const HrtfStore::Elevation> elevs{
+        reinterpret_cast<const HrtfStore::Elevation*>(base + layout.mElevs), header.mEvCount};
+    const al::span<const ubyte2> delays{reinterpret_cast<const ubyte2*>(base + layout.mDelays),
+        header.mIrCount};
+
+    /* Make sure the elevations and IRs stay within the stored counts. */
+    size_t evtotal{0};
+    for(const auto &field : fields)
+        evtotal += field.evCount;
+    bool badir{evtotal != elevs.size()};
+    for(const auto &elev : elevs)
+        badir = badir || elev.azCount == 0 || size_t{elev.irOffset}+elev.azCount > delays.size();
+    for(const auto &delay : delays)
+        badir = badir || delay[0] > MaxHrirDelay*HrirDelayFracOne
+            || delay[1] > MaxHrirDelay*HrirDelayFracOne;
+    if(badir || size_t{elevs.back().irOffset}+elevs.back().azCount != delays.size())
+    {
+        WARN("Invalid HRTF cache %s\n", cachename.c_str());
+        return nullptr;
+    }
+
+    void *ptr{al_calloc(alignof(HrtfStore), sizeof(HrtfStore))};
+    if(!ptr)
+    {
+        ERR("Out of memory allocating storage for %s.\n", cachename.c_str());
+        return nullptr;
+    }
+    std::unique_ptr<HrtfStore> Hrtf{al::construct_at(static_cast<HrtfStore*>(ptr))};
+    InitRef(Hrtf->mRef, 1u);
+    Hrtf->sampleRate = devrate;
+    Hrtf->irSize = header.mIrSize;
+    Hrtf->fdCount = header.mFdCount;
+    Hrtf->field = fields.data();
+    Hrtf->elev = elevs.data();
+    Hrtf->coeffs = reinterpret_cast<const HrirArray*>(base + layout.mCoeffs);
+    Hrtf->delays = delays.data();
+    Hrtf->mMapping = std::move(mapping);
+
+    return Hrtf;
+}
+
+bool StoreHrtfCache(const std::string &cachename, const std::string &fname,
+    const FileStamp &stamp, const HrtfStore *hrtf)
+{
+    const size_t evCount{std::accumulate(hrtf->field, hrtf->field+hrtf->fdCount, size_t{0},
+        [](const size_t curval, const HrtfStore::Field &field) noexcept -> size_t
+        { return curval + field.evCount; })};
+    const size_t irCount{size_t{hrtf->elev[evCount-1].irOffset} + hrtf->elev[evCount-1].azCount};
+
+    HrtfCacheHeader header{};
+    std::copy(std::begin(HrtfCacheMarker), std::end(HrtfCacheMarker), header.mMagic);
+    header.mVersion = HrtfCacheVersion;
+    header.mByteOrder = HrtfCacheByteOrder;
+    header.mHrirLength = HrirLength;
+    header.mNameLength = static_cast<uint32_t>(fname.size());
+    header.mSrcTime = stamp.mtime;
+    header.mSrcSize = stamp.size;
+    header.mSampleRate = hrtf->sampleRate;
+    header.mIrSize = hrtf->irSize;
+    header.mFdCount = hrtf->fdCount;
+    header.mEvCount = static_cast<uint32_t>(evCount);
+    header.mIrCount = static_cast<uint32_t>(irCount);
+
+    const HrtfCacheLayout layout{fname.size(), hrtf->fdCount, evCount, irCount};
+    auto data = al::vector<char>(layout.mTotal, '\0');
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data()+sizeof(header), fname.data(), fname.size());
+    std::memcpy(data.data()+layout.mFields, hrtf->field, sizeof(hrtf->field[0])*hrtf->fdCount);
+    std::memcpy(data.data()+layout.mElevs, hrtf->elev, sizeof(hrtf->elev[0])*evCount);
+    std::memcpy(data.data()+layout.mCoeffs, hrtf->coeffs, sizeof(hrtf->coeffs[0])*irCount);
+    std::memcpy(data.data()+layout.mDelays, hrtf->delays, sizeof(hrtf->delays[0])*irCount);
+
+    /* Write to a temporary file first, so other processes never see a partial
+     * cache file.
+     */
+    const std::string tmpname{cachename + '.' +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp"};
+    {
+        al::ofstream file{tmpname.c_str(), std::ios::binary|std::ios::trunc};
+        if(!file.is_open() || !file.write(data.data(), static_cast<std::streamsize>(data.size()))
+            || !file.flush())
+        {
+            WARN("Failed to write HRTF cache %s\n", tmpname.c_str());
+            file.close();
+            std::remove(tmpname.c_str());
+            return false;
+        }
+    }
+    if(!RenameFile(tmpname.c_str(), cachename.c_str()))
+    {
+        WARN("Failed to rename HRTF cache %s\n", tmpname.c_str());
+        std::remove(tmpname.c_str());
+        return false;
+    }
+    TRACE("Stored HRTF cache %s\n", cachename.c_str());
+    return true;
+}
+
 } // namespace
 
 
+std::string HrtfCachePath{"openal/hrtf"};
+
 al::vector<std::string> EnumerateHrtf(al::optional<std::string> pathopt)
 {
     std::lock_guard<std::mutex> _{EnumeratedHrtfLock};
@@ -1288,18 +1516,44 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         ++handle;
     }
 
-    std::unique_ptr<std::istream> stream;
+    /* Built-in resources are identified by a hash of their data, instead of a
+     * modification time.
+     */
+    al::optional<FileStamp> stamp;
+    al::span<const char> res;
     int residx{};
     char ch{};
     if(sscanf(fname.c_str(), "!%d%c", &residx, &ch) == 2 && ch == '_')
     {
-        TRACE("Loading %s...\n", fname.c_str());
-        al::span<const char> res{GetResource(residx)};
+        res = GetResource(residx);
         if(res.empty())
         {
             ERR("Could not get resource %u, %s\n", residx, name.c_str());
             return nullptr;
         }
+        stamp = FileStamp{HashBytes(res.data(), res.size()), res.size()};
+    }
+    else
+        stamp = GetFileStamp(fname.c_str());
+
+    const std::string cachename{(stamp && !HrtfCachePath.empty()) ?
+        GetHrtfCacheName(fname, devrate) : std::string{}};
+    if(!cachename.empty())
+    {
+        if(std::unique_ptr<HrtfStore> cached{LoadHrtfCache(cachename, fname, *stamp, devrate)})
+        {
+            TRACE("Loaded HRTF %s from cache %s for sample rate %uhz, %u-sample filter\n",
+                name.c_str(), cachename.c_str(), cached->sampleRate, cached->irSize);
+            handle = LoadedHrtfs.emplace(handle, LoadedHrtf{fname, std::move(cached)});
+
+            return HrtfStorePtr{handle->mEntry.get()};
+        }
+    }
+
+    std::unique_ptr<std::istream> stream;
+    if(!res.empty())
+    {
+        TRACE("Loading %s...\n", fname.c_str());
         stream = std::make_unique<idstream>(res.begin(), res.end());
     }
     else
@@ -1421,12 +1675,22 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
 
     TRACE("Loaded HRTF %s for sample rate %uhz, %u-sample filter\n", name.c_str(),
         hrtf->sampleRate, hrtf->irSize);
+    /* Switch to the newly stored cache, so the data is shared with other
+     * processes that load it.
+     */
+    if(!cachename.empty() && StoreHrtfCache(cachename, fname, *stamp, hrtf.get()))
+    {
+        if(std::unique_ptr<HrtfStore> mapped{LoadHrtfCache(cachename, fname, *stamp, devrate)})
+            hrtf = std::move(mapped);
+    }
     handle = LoadedHrtfs.emplace(handle, LoadedHrtf{fname, std::move(hrtf)});
 
     return HrtfStorePtr{handle->mEntry.get()};
 }
 
 
+HrtfStore::~HrtfStore() = default;
+
 void HrtfStore::add_ref()
 {
     auto ref = IncrementRef(mRef);
@@ -17,6 +17,8 @@
 #include "vector.h"
 
 
+class MappedFile;
+
 struct HrtfStore {
     RefCount mRef;
 
@@ -37,10 +39,15 @@ struct HrtfStore {
         ushort azCount;
         ushort irOffset;
     };
-    Elevation *elev;
+    const Elevation *elev;
     const HrirArray *coeffs;
     const ubyte2 *delays;
 
+    /* The file mapping holding the data, when loaded from a cache file. */
+    std::unique_ptr<MappedFile> mMapping;
+
+    ~HrtfStore();
+
     void add_ref();
     void release();
 
@@ -81,6 +88,11 @@ struct DirectHrtfState {
 };
 
 
+/* The directory to cache resampled data sets in, relative to the user's cache
+ * directory if not absolute. Caching is disabled if empty.
+ */
+extern std::string HrtfCachePath;
+
 al::vector<std::string> EnumerateHrtf(al::optional<std::string> pathopt);
 HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate);
 
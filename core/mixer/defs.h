@@ -6,6 +6,7 @@
 
 #include "alspan.h"
 #include "core/bufferline.h"
+#include "core/devformat.h"
 #include "core/resampler_limits.h"
 
 struct HrtfChannelState;
@@ -16,7 +17,7 @@ using uint = unsigned int;
 using float2 = std::array<float,2>;
 
 
-constexpr int MixerFracBits{12};
+constexpr int MixerFracBits{16};
 constexpr int MixerFracOne{1 << MixerFracBits};
 constexpr int MixerFracMask{MixerFracOne - 1};
 
@@ -79,6 +80,19 @@ void MixDirectHrtf_(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOu
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
     float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize);
 
+/* Interleaves todo frames of the input lines, starting at InPos, into dst with
+ * FrameStep samples per frame. Output channels without an input are silenced.
+ */
+template<typename InstTag>
+void Interleave_(const al::span<const FloatBufferLine> InBuffer, const size_t InPos,
+    float *RESTRICT dst, const size_t FrameStep, const size_t todo);
+/* Converts count contiguous samples to the given device sample type,
+ * saturating integer output.
+ */
+template<typename InstTag>
+void ConvertSamples_(const float *RESTRICT src, void *dst, const DevFmtType type,
+    const size_t count);
+
 /* Vectorized resampler helpers */
 template<size_t N>
 inline void InitPosArrays(uint frac, uint increment, uint (&frac_arr)[N], uint (&pos_arr)[N])
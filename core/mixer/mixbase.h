@@ -0,0 +1,108 @@
+#ifndef CORE_MIXER_MIXBASE_H
+#define CORE_MIXER_MIXBASE_H
+
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "almalloc.h"
+#include "alnumeric.h"
+#include "alspan.h"
+#include "core/bufferline.h"
+#include "defs.h"
+#include "opthelpers.h"
+
+
+/* Adds src*(gain + step*i) to dst for each sample i in [pos, end). */
+using MixRampT = void(&)(const float *RESTRICT src, float *RESTRICT dst, size_t pos,
+    const size_t end, const float gain, const float step);
+/* Adds src*gain to dst for each sample in [pos, end). */
+using MixConstT = void(&)(const float *RESTRICT src, float *RESTRICT dst, size_t pos,
+    const size_t end, const float gain);
+
+/* The number of samples mixed to each output channel at a time. The input
+ * block stays in cache while it's being applied to all the outputs.
+ */
+constexpr size_t MixBlockSize{256};
+
+struct MixChannel {
+    float *dst;
+    float gain;
+    float step;
+    float target;
+};
+
+template<MixRampT MixRamp, MixConstT MixConst>
+void MixBlocks(const al::span<const float> InSamples, const al::span<MixChannel> chans,
+    const size_t fade_len)
+{
+    const float *RESTRICT src{al::assume_aligned<16>(InSamples.data())};
+    for(size_t base{0};base < InSamples.size();base += MixBlockSize)
+    {
+        const size_t end{minz(base+MixBlockSize, InSamples.size())};
+        for(MixChannel &chan : chans)
+        {
+            size_t pos{base};
+            if(chan.step != 0.0f && pos < fade_len)
+            {
+                const size_t rampend{minz(end, fade_len)};
+                MixRamp(src, chan.dst, pos, rampend, chan.gain, chan.step);
+                pos = rampend;
+            }
+            /* Once the fade is done, the rest is mixed with the target gain,
+             * if it's not silent.
+             */
+            if(pos < end && std::abs(chan.target) > GainSilenceThreshold)
+                MixConst(src, chan.dst, pos, end, chan.target);
+        }
+    }
+}
+
+/* Mixes the input samples to all the output channels. The channel gains are
+ * set up first so silent channels can be skipped entirely, then each block of
+ * input is mixed to all the non-silent outputs before moving to the next.
+ */
+template<MixRampT MixRamp, MixConstT MixConst>
+void MixBase(const al::span<const float> InSamples, const al::span<FloatBufferLine> OutBuffer,
+    float *CurrentGains, const float *TargetGains, const size_t Counter, const size_t OutPos)
+{
+    constexpr size_t MaxChans{16};
+
+    const float delta{(Counter > 0) ? 1.0f / static_cast<float>(Counter) : 0.0f};
+    const size_t fade_len{minz(Counter, InSamples.size())};
+
+    std::array<MixChannel,MaxChans> chans;
+    size_t numchans{0};
+    for(FloatBufferLine &output : OutBuffer)
+    {
+        MixChannel chan{output.data()+OutPos, *CurrentGains, 0.0f, *TargetGains};
+        chan.step = (chan.target-chan.gain) * delta;
+
+        float endgain{chan.target};
+        if(!(std::abs(chan.step) > std::numeric_limits<float>::epsilon()))
+        {
+            chan.gain = chan.target;
+            chan.step = 0.0f;
+        }
+        else if(fade_len != Counter)
+            endgain = chan.gain + chan.step*static_cast<float>(fade_len);
+        *(CurrentGains++) = endgain;
+        ++TargetGains;
+
+        /* Skip the channel if it stays silent throughout. */
+        if(!(std::abs(chan.gain) > GainSilenceThreshold)
+            && !(std::abs(endgain) > GainSilenceThreshold))
+            continue;
+
+        chans[numchans] = chan;
+        if(++numchans == MaxChans)
+        {
+            MixBlocks<MixRamp,MixConst>(InSamples, chans, fade_len);
+            numchans = 0;
+        }
+    }
+    if(numchans > 0)
+        MixBlocks<MixRamp,MixConst>(InSamples, {chans.data(), numchans}, fade_len);
+}
+
+#endif /* CORE_MIXER_MIXBASE_H */
@@ -0,0 +1,451 @@
+#include "config.h"
+
+#include <immintrin.h>
+
+#include <cmath>
+#include <limits>
+#include <stdint.h>
+#include <type_traits>
+
+#include "almalloc.h"
+#include "alnumeric.h"
+#include "core/bsinc_defs.h"
+#include "defs.h"
+#include "hrtfdefs.h"
+#include "opthelpers.h"
+
+struct AVX2Tag;
+struct LerpTag;
+struct CubicTag;
+struct BSincTag;
+struct FastBSincTag;
+
+
+/* NOTE: The HRTF mixer templates need to be included after setting the target
+ * so their instantiations here can inline the AVX2 coefficient function.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && !(defined(__AVX2__) && defined(__FMA__))
+#pragma GCC target("avx2,fma")
+#elif defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to=function)
+#endif
+
+#include "hrtfbase.h"
+#include "mixbase.h"
+#include "writebase.h"
+
+namespace {
+
+constexpr uint FracPhaseBitDiff{MixerFracBits - BSincPhaseBits};
+constexpr uint FracPhaseDiffOne{1 << FracPhaseBitDiff};
+
+inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const ConstHrirSpan Coeffs,
+    const float left, const float right)
+{
+    const __m256 lrlr{_mm256_setr_ps(left, right, left, right, left, right, left, right)};
+
+    ASSUME(IrSize >= MinIrLength);
+    /* The values alternate between 8- and 16-byte alignment, so just use
+     * unaligned loads and stores. Four stereo pairs are handled at a time.
+     */
+    size_t i{0};
+    for(size_t todo{IrSize >> 2};todo;--todo)
+    {
+        const __m256 coeffs{_mm256_loadu_ps(&Coeffs[i][0])};
+        __m256 vals{_mm256_loadu_ps(&Values[i][0])};
+        vals = _mm256_fmadd_ps(lrlr, coeffs, vals);
+        _mm256_storeu_ps(&Values[i][0], vals);
+        i += 4;
+    }
+    for(;i < IrSize;++i)
+    {
+        Values[i][0] += Coeffs[i][0] * left;
+        Values[i][1] += Coeffs[i][1] * right;
+    }
+}
+
+inline float hsum(const __m256 r8, __m128 r4)
+{
+    r4 = _mm_add_ps(r4, _mm_add_ps(_mm256_castps256_ps128(r8), _mm256_extractf128_ps(r8, 1)));
+    r4 = _mm_add_ps(r4, _mm_shuffle_ps(r4, r4, _MM_SHUFFLE(0, 1, 2, 3)));
+    r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
+    return _mm_cvtss_f32(r4);
+}
+
+inline void MixRamp(const float *RESTRICT src, float *RESTRICT dst, size_t pos, const size_t end,
+    const float gain, const float step)
+{
+    if(size_t todo{(end-pos) >> 3})
+    {
+        const __m256 eight8{_mm256_set1_ps(8.0f)};
+        const __m256 step8{_mm256_set1_ps(step)};
+        const __m256 gain8{_mm256_set1_ps(gain)};
+        __m256 step_count8{_mm256_add_ps(
+            _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f),
+            _mm256_set1_ps(static_cast<float>(pos)))};
+        do {
+            const __m256 val8{_mm256_loadu_ps(&src[pos])};
+            __m256 dry8{_mm256_loadu_ps(&dst[pos])};
+
+            /* dry += val * (gain + step*step_count) */
+            dry8 = _mm256_fmadd_ps(val8, _mm256_fmadd_ps(step8, step_count8, gain8), dry8);
+
+            _mm256_storeu_ps(&dst[pos], dry8);
+            step_count8 = _mm256_add_ps(step_count8, eight8);
+            pos += 8;
+        } while(--todo);
+    }
+    for(;pos < end;++pos)
+        dst[pos] += src[pos] * (gain + step*static_cast<float>(pos));
+}
+
+inline void MixConst(const float *RESTRICT src, float *RESTRICT dst, size_t pos, const size_t end,
+    const float gain)
+{
+    if(size_t todo{(end-pos) >> 3})
+    {
+        const __m256 gain8{_mm256_set1_ps(gain)};
+        do {
+            const __m256 val8{_mm256_loadu_ps(&src[pos])};
+            __m256 dry8{_mm256_loadu_ps(&dst[pos])};
+            dry8 = _mm256_fmadd_ps(val8, gain8, dry8);
+            _mm256_storeu_ps(&dst[pos], dry8);
+            pos += 8;
+        } while(--todo);
+    }
+    for(;pos < end;++pos)
+        dst[pos] += src[pos] * gain;
+}
+
+/* Scales and clamps the samples to the integer range given by the limits, and
+ * converts them to 32-bit integers.
+ */
+inline __m256i ScaleToInt(const __m256 val, const __m256 scale, const __m256 lo, const __m256 hi)
+{ return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(val, scale), lo), hi)); }
+
+template<typename T>
+void ConvertInt32(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{
+    const __m256 scale{_mm256_set1_ps(2147483648.0f)};
+    const __m256 lo{_mm256_set1_ps(-2147483648.0f)}, hi{_mm256_set1_ps(2147483520.0f)};
+    const __m256i bias{_mm256_set1_epi32(std::is_signed<T>::value ? 0 : INT32_MIN)};
+
+    size_t i{0};
+    for(;count-i >= 8;i += 8)
+    {
+        const __m256i val{ScaleToInt(_mm256_loadu_ps(src+i), scale, lo, hi)};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst+i), _mm256_xor_si256(val, bias));
+    }
+    ConvertBase(src+i, dst+i, count-i);
+}
+
+template<typename T>
+void ConvertInt16(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{
+    const __m256 scale{_mm256_set1_ps(32768.0f)};
+    const __m256 lo{_mm256_set1_ps(-32768.0f)}, hi{_mm256_set1_ps(32767.0f)};
+    const __m256i bias{_mm256_set1_epi16(std::is_signed<T>::value ? 0 : INT16_MIN)};
+
+    size_t i{0};
+    for(;count-i >= 16;i += 16)
+    {
+        const __m256i val0{ScaleToInt(_mm256_loadu_ps(src+i), scale, lo, hi)};
+        const __m256i val1{ScaleToInt(_mm256_loadu_ps(src+i+8), scale, lo, hi)};
+        /* Packing works within each 128-bit lane, so the 64-bit quarters need
+         * to be put back in order.
+         */
+        __m256i val{_mm256_packs_epi32(val0, val1)};
+        val = _mm256_permute4x64_epi64(val, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst+i), _mm256_xor_si256(val, bias));
+    }
+    ConvertBase(src+i, dst+i, count-i);
+}
+
+template<typename T>
+void ConvertInt8(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{
+    const __m256 scale{_mm256_set1_ps(128.0f)};
+    const __m256 lo{_mm256_set1_ps(-128.0f)}, hi{_mm256_set1_ps(127.0f)};
+    const __m256i bias{_mm256_set1_epi8(std::is_signed<T>::value ? 0 : INT8_MIN)};
+    const __m256i order{_mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)};
+
+    size_t i{0};
+    for(;count-i >= 32;i += 32)
+    {
+        const __m256i val0{ScaleToInt(_mm256_loadu_ps(src+i), scale, lo, hi)};
+        const __m256i val1{ScaleToInt(_mm256_loadu_ps(src+i+8), scale, lo, hi)};
+        const __m256i val2{ScaleToInt(_mm256_loadu_ps(src+i+16), scale, lo, hi)};
+        const __m256i val3{ScaleToInt(_mm256_loadu_ps(src+i+24), scale, lo, hi)};
+        __m256i val{_mm256_packs_epi16(_mm256_packs_epi32(val0, val1),
+            _mm256_packs_epi32(val2, val3))};
+        val = _mm256_permutevar8x32_epi32(val, order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst+i), _mm256_xor_si256(val, bias));
+    }
+    ConvertBase(src+i, dst+i, count-i);
+}
+
+} // namespace
+
+template<>
+float *Resample_<LerpTag,AVX2Tag>(const InterpState*, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const __m256i increment8{_mm256_set1_epi32(static_cast<int>(increment*8))};
+    const __m256 fracOne8{_mm256_set1_ps(1.0f/MixerFracOne)};
+    const __m256i fracMask8{_mm256_set1_epi32(MixerFracMask)};
+
+    alignas(32) uint pos_[8], frac_[8];
+    InitPosArrays(frac, increment, frac_, pos_);
+    __m256i frac8{_mm256_load_si256(reinterpret_cast<const __m256i*>(frac_))};
+    __m256i pos8{_mm256_load_si256(reinterpret_cast<const __m256i*>(pos_))};
+
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>3};todo;--todo)
+    {
+        const __m256 val1{_mm256_i32gather_ps(src, pos8, 4)};
+        const __m256 val2{_mm256_i32gather_ps(src+1, pos8, 4)};
+
+        /* val1 + (val2-val1)*mu */
+        const __m256 r0{_mm256_sub_ps(val2, val1)};
+        const __m256 mu{_mm256_mul_ps(_mm256_cvtepi32_ps(frac8), fracOne8)};
+        const __m256 out{_mm256_fmadd_ps(mu, r0, val1)};
+
+        _mm256_storeu_ps(dst_iter, out);
+        dst_iter += 8;
+
+        frac8 = _mm256_add_epi32(frac8, increment8);
+        pos8 = _mm256_add_epi32(pos8, _mm256_srli_epi32(frac8, MixerFracBits));
+        frac8 = _mm256_and_si256(frac8, fracMask8);
+    }
+
+    if(size_t todo{dst.size()&7})
+    {
+        src += static_cast<uint>(_mm_cvtsi128_si32(_mm256_castsi256_si128(pos8)));
+        frac = static_cast<uint>(_mm_cvtsi128_si32(_mm256_castsi256_si128(frac8)));
+
+        do {
+            *(dst_iter++) = lerpf(src[0], src[1], static_cast<float>(frac) * (1.0f/MixerFracOne));
+
+            frac += increment;
+            src  += frac>>MixerFracBits;
+            frac &= MixerFracMask;
+        } while(--todo);
+    }
+    return dst.data();
+}
+
+template<>
+float *Resample_<CubicTag,AVX2Tag>(const InterpState*, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const __m256i increment8{_mm256_set1_epi32(static_cast<int>(increment*8))};
+    const __m256 fracOne8{_mm256_set1_ps(1.0f/MixerFracOne)};
+    const __m256i fracMask8{_mm256_set1_epi32(MixerFracMask)};
+
+    alignas(32) uint pos_[8], frac_[8];
+    InitPosArrays(frac, increment, frac_, pos_);
+    __m256i frac8{_mm256_load_si256(reinterpret_cast<const __m256i*>(frac_))};
+    __m256i pos8{_mm256_load_si256(reinterpret_cast<const __m256i*>(pos_))};
+
+    src -= 1;
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>3};todo;--todo)
+    {
+        const __m256 val0{_mm256_i32gather_ps(src  , pos8, 4)};
+        const __m256 val1{_mm256_i32gather_ps(src+1, pos8, 4)};
+        const __m256 val2{_mm256_i32gather_ps(src+2, pos8, 4)};
+        const __m256 val3{_mm256_i32gather_ps(src+3, pos8, 4)};
+
+        const __m256 mu{_mm256_mul_ps(_mm256_cvtepi32_ps(frac8), fracOne8)};
+        const __m256 mu2{_mm256_mul_ps(mu, mu)};
+        const __m256 mu3{_mm256_mul_ps(mu2, mu)};
+
+        /* Catmull-Rom coefficients, the same as cubic(). */
+        const __m256 a0{_mm256_fmadd_ps(_mm256_set1_ps(-0.5f), mu3,
+            _mm256_fmadd_ps(_mm256_set1_ps(-0.5f), mu, mu2))};
+        const __m256 a1{_mm256_fmadd_ps(_mm256_set1_ps(1.5f), mu3,
+            _mm256_fmadd_ps(_mm256_set1_ps(-2.5f), mu2, _mm256_set1_ps(1.0f)))};
+        const __m256 a2{_mm256_fmadd_ps(_mm256_set1_ps(-1.5f), mu3,
+            _mm256_fmadd_ps(_mm256_set1_ps(2.0f), mu2, _mm256_mul_ps(_mm256_set1_ps(0.5f), mu)))};
+        const __m256 a3{_mm256_mul_ps(_mm256_set1_ps(0.5f), _mm256_sub_ps(mu3, mu2))};
+
+        __m256 out{_mm256_mul_ps(val0, a0)};
+        out = _mm256_fmadd_ps(val1, a1, out);
+        out = _mm256_fmadd_ps(val2, a2, out);
+        out = _mm256_fmadd_ps(val3, a3, out);
+
+        _mm256_storeu_ps(dst_iter, out);
+        dst_iter += 8;
+
+        frac8 = _mm256_add_epi32(frac8, increment8);
+        pos8 = _mm256_add_epi32(pos8, _mm256_srli_epi32(frac8, MixerFracBits));
+        frac8 = _mm256_and_si256(frac8, fracMask8);
+    }
+
+    if(size_t todo{dst.size()&7})
+    {
+        src += static_cast<uint>(_mm_cvtsi128_si32(_mm256_castsi256_si128(pos8)));
+        frac = static_cast<uint>(_mm_cvtsi128_si32(_mm256_castsi256_si128(frac8)));
+
+        do {
+            *(dst_iter++) = cubic(src[0], src[1], src[2], src[3],
+                static_cast<float>(frac) * (1.0f/MixerFracOne));
+
+            frac += increment;
+            src  += frac>>MixerFracBits;
+            frac &= MixerFracMask;
+        } while(--todo);
+    }
+    return dst.data();
+}
+
+template<>
+float *Resample_<BSincTag,AVX2Tag>(const InterpState *state, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const float *const filter{state->bsinc.filter};
+    const __m256 sf8{_mm256_set1_ps(state->bsinc.sf)};
+    const size_t m{state->bsinc.m};
+    ASSUME(m > 0);
+
+    src -= state->bsinc.l;
+    for(float &out_sample : dst)
+    {
+        // Calculate the phase index and factor.
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) * (1.0f/FracPhaseDiffOne)};
+
+        // Apply the scale and phase interpolated filter.
+        __m256 r8{_mm256_setzero_ps()};
+        __m128 r4{_mm_setzero_ps()};
+        {
+            const __m256 pf8{_mm256_set1_ps(pf)};
+            const float *RESTRICT fil{filter + m*pi*2};
+            const float *RESTRICT phd{fil + m};
+            const float *RESTRICT scd{fil + BSincPhaseCount*2*m};
+            const float *RESTRICT spd{scd + m};
+            size_t j{0u};
+
+            for(size_t td{m >> 3};td;--td)
+            {
+                /* f = ((fil + sf*scd) + pf*(phd + sf*spd)) */
+                const __m256 f8{_mm256_fmadd_ps(pf8,
+                    _mm256_fmadd_ps(sf8, _mm256_loadu_ps(&spd[j]), _mm256_loadu_ps(&phd[j])),
+                    _mm256_fmadd_ps(sf8, _mm256_loadu_ps(&scd[j]), _mm256_loadu_ps(&fil[j])))};
+                /* r += f*src */
+                r8 = _mm256_fmadd_ps(f8, _mm256_loadu_ps(&src[j]), r8);
+                j += 8;
+            }
+            /* The coefficient count is a multiple of 4, so there may be 4
+             * left over.
+             */
+            if((m&4))
+            {
+                const __m128 sf4{_mm256_castps256_ps128(sf8)};
+                const __m128 pf4{_mm256_castps256_ps128(pf8)};
+                const __m128 f4{_mm_fmadd_ps(pf4,
+                    _mm_fmadd_ps(sf4, _mm_load_ps(&spd[j]), _mm_load_ps(&phd[j])),
+                    _mm_fmadd_ps(sf4, _mm_load_ps(&scd[j]), _mm_load_ps(&fil[j])))};
+                r4 = _mm_mul_ps(f4, _mm_loadu_ps(&src[j]));
+            }
+        }
+        out_sample = hsum(r8, r4);
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+    return dst.data();
+}
+
+template<>
+float *Resample_<FastBSincTag,AVX2Tag>(const InterpState *state, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const float *const filter{state->bsinc.filter};
+    const size_t m{state->bsinc.m};
+    ASSUME(m > 0);
+
+    src -= state->bsinc.l;
+    for(float &out_sample : dst)
+    {
+        // Calculate the phase index and factor.
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) * (1.0f/FracPhaseDiffOne)};
+
+        // Apply the phase interpolated filter.
+        __m256 r8{_mm256_setzero_ps()};
+        __m128 r4{_mm_setzero_ps()};
+        {
+            const __m256 pf8{_mm256_set1_ps(pf)};
+            const float *RESTRICT fil{filter + m*pi*2};
+            const float *RESTRICT phd{fil + m};
+            size_t j{0u};
+
+            for(size_t td{m >> 3};td;--td)
+            {
+                /* f = fil + pf*phd */
+                const __m256 f8{_mm256_fmadd_ps(pf8, _mm256_loadu_ps(&phd[j]),
+                    _mm256_loadu_ps(&fil[j]))};
+                /* r += f*src */
+                r8 = _mm256_fmadd_ps(f8, _mm256_loadu_ps(&src[j]), r8);
+                j += 8;
+            }
+            if((m&4))
+            {
+                const __m128 f4{_mm_fmadd_ps(_mm256_castps256_ps128(pf8), _mm_load_ps(&phd[j]),
+                    _mm_load_ps(&fil[j]))};
+                r4 = _mm_mul_ps(f4, _mm_loadu_ps(&src[j]));
+            }
+        }
+        out_sample = hsum(r8, r4);
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+    return dst.data();
+}
+
+
+template<>
+void MixHrtf_<AVX2Tag>(const float *InSamples, float2 *AccumSamples, const uint IrSize,
+    const MixHrtfFilter *hrtfparams, const size_t BufferSize)
+{ MixHrtfBase<ApplyCoeffs>(InSamples, AccumSamples, IrSize, hrtfparams, BufferSize); }
+
+template<>
+void MixHrtfBlend_<AVX2Tag>(const float *InSamples, float2 *AccumSamples, const uint IrSize,
+    const HrtfFilter *oldparams, const MixHrtfFilter *newparams, const size_t BufferSize)
+{
+    MixHrtfBlendBase<ApplyCoeffs>(InSamples, AccumSamples, IrSize, oldparams, newparams,
+        BufferSize);
+}
+
+template<>
+void MixDirectHrtf_<AVX2Tag>(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
+    const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
+    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize)
+{
+    MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf, ChanState,
+        IrSize, BufferSize);
+}
+
+
+template<>
+void Mix_<AVX2Tag>(const al::span<const float> InSamples, const al::span<FloatBufferLine> OutBuffer,
+    float *CurrentGains, const float *TargetGains, const size_t Counter, const size_t OutPos)
+{ MixBase<MixRamp,MixConst>(InSamples, OutBuffer, CurrentGains, TargetGains, Counter, OutPos); }
+
+
+template<>
+void ConvertSamples_<AVX2Tag>(const float *RESTRICT src, void *dst, const DevFmtType type,
+    const size_t count)
+{
+    ConvertSamplesBase<ConvertInt8<int8_t>,ConvertInt8<uint8_t>,ConvertInt16<int16_t>,
+        ConvertInt16<uint16_t>,ConvertInt32<int32_t>,ConvertInt32<uint32_t>>(src, dst, type,
+        count);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
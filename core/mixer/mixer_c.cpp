@@ -8,6 +8,8 @@
 #include "core/bsinc_tables.h"
 #include "defs.h"
 #include "hrtfbase.h"
+#include "mixbase.h"
+#include "writebase.h"
 
 struct CTag;
 struct CopyTag;
@@ -96,6 +98,20 @@ inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const Cons
     }
 }
 
+inline void MixRamp(const float *RESTRICT src, float *RESTRICT dst, size_t pos, const size_t end,
+    const float gain, const float step)
+{
+    for(;pos < end;++pos)
+        dst[pos] += src[pos] * (gain + step*static_cast<float>(pos));
+}
+
+inline void MixConst(const float *RESTRICT src, float *RESTRICT dst, size_t pos, const size_t end,
+    const float gain)
+{
+    for(;pos < end;++pos)
+        dst[pos] += src[pos] * gain;
+}
+
 } // namespace
 
 template<>
@@ -163,38 +179,18 @@ void MixDirectHrtf_<CTag>(const FloatBufferSpan LeftOut, const FloatBufferSpan R
 template<>
 void Mix_<CTag>(const al::span<const float> InSamples, const al::span<FloatBufferLine> OutBuffer,
     float *CurrentGains, const float *TargetGains, const size_t Counter, const size_t OutPos)
+{ MixBase<MixRamp,MixConst>(InSamples, OutBuffer, CurrentGains, TargetGains, Counter, OutPos); }
+
+
+template<>
+void Interleave_<CTag>(const al::span<const FloatBufferLine> InBuffer, const size_t InPos,
+    float *RESTRICT dst, const size_t FrameStep, const size_t todo)
+{ InterleaveBase(InBuffer, InPos, dst, FrameStep, todo); }
+
+template<>
+void ConvertSamples_<CTag>(const float *RESTRICT src, void *dst, const DevFmtType type,
+    const size_t count)
 {
-    const float delta{(Counter > 0) ? 1.0f / static_cast<float>(Counter) : 0.0f};
-    const auto min_len = minz(Counter, InSamples.size());
-    for(FloatBufferLine &output : OutBuffer)
-    {
-        float *RESTRICT dst{al::assume_aligned<16>(output.data()+OutPos)};
-        float gain{*CurrentGains};
-        const float step{(*TargetGains-gain) * delta};
-
-        size_t pos{0};
-        if(!(std::abs(step) > std::numeric_limits<float>::epsilon()))
-            gain = *TargetGains;
-        else
-        {
-            float step_count{0.0f};
-            for(;pos != min_len;++pos)
-            {
-                dst[pos] += InSamples[pos] * (gain + step*step_count);
-                step_count += 1.0f;
-            }
-            if(pos == Counter)
-                gain = *TargetGains;
-            else
-                gain += step*step_count;
-        }
-        *CurrentGains = gain;
-        ++CurrentGains;
-        ++TargetGains;
-
-        if(!(std::abs(gain) > GainSilenceThreshold))
-            continue;
-        for(;pos != InSamples.size();++pos)
-            dst[pos] += InSamples[pos] * gain;
-    }
+    ConvertSamplesBase<ConvertBase<int8_t>,ConvertBase<uint8_t>,ConvertBase<int16_t>,
+        ConvertBase<uint16_t>,ConvertBase<int32_t>,ConvertBase<uint32_t>>(src, dst, type, count);
 }
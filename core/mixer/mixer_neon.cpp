@@ -4,11 +4,15 @@
 
 #include <cmath>
 #include <limits>
+#include <stdint.h>
+#include <type_traits>
 
 #include "alnumeric.h"
 #include "core/bsinc_defs.h"
 #include "defs.h"
 #include "hrtfbase.h"
+#include "mixbase.h"
+#include "writebase.h"
 
 struct NEONTag;
 struct LerpTag;
@@ -56,6 +60,115 @@ inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const Cons
     }
 }
 
+inline void MixRamp(const float *RESTRICT src, float *RESTRICT dst, size_t pos, const size_t end,
+    const float gain, const float step)
+{
+    if(size_t todo{(end-pos) >> 2})
+    {
+        const float32x4_t four4{vdupq_n_f32(4.0f)};
+        const float32x4_t step4{vdupq_n_f32(step)};
+        const float32x4_t gain4{vdupq_n_f32(gain)};
+        const float fpos{static_cast<float>(pos)};
+        float32x4_t step_count4{set_f4(fpos, fpos+1.0f, fpos+2.0f, fpos+3.0f)};
+        do {
+            const float32x4_t val4 = vld1q_f32(&src[pos]);
+            float32x4_t dry4 = vld1q_f32(&dst[pos]);
+            dry4 = vmlaq_f32(dry4, val4, vmlaq_f32(gain4, step4, step_count4));
+            step_count4 = vaddq_f32(step_count4, four4);
+            vst1q_f32(&dst[pos], dry4);
+            pos += 4;
+        } while(--todo);
+    }
+    for(;pos < end;++pos)
+        dst[pos] += src[pos] * (gain + step*static_cast<float>(pos));
+}
+
+inline void MixConst(const float *RESTRICT src, float *RESTRICT dst, size_t pos, const size_t end,
+    const float gain)
+{
+    for(;pos < end && (pos&3);++pos)
+        dst[pos] += src[pos] * gain;
+    if(size_t todo{(end-pos) >> 2})
+    {
+        const float32x4_t gain4 = vdupq_n_f32(gain);
+        do {
+            const float32x4_t val4 = vld1q_f32(&src[pos]);
+            float32x4_t dry4 = vld1q_f32(&dst[pos]);
+            dry4 = vmlaq_f32(dry4, val4, gain4);
+            vst1q_f32(&dst[pos], dry4);
+            pos += 4;
+        } while(--todo);
+    }
+    for(;pos < end;++pos)
+        dst[pos] += src[pos] * gain;
+}
+
+#ifdef __aarch64__
+/* Scales and clamps the samples to the integer range given by the limits, and
+ * converts them to 32-bit integers, rounding to nearest like SampleConv. This
+ * requires AArch64, as ARMv7 NEON can only truncate.
+ */
+inline int32x4_t ScaleToInt(const float32x4_t val, const float32x4_t scale,
+    const float32x4_t lo, const float32x4_t hi)
+{ return vcvtnq_s32_f32(vminq_f32(vmaxq_f32(vmulq_f32(val, scale), lo), hi)); }
+
+template<typename T>
+void ConvertInt32(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{
+    const float32x4_t scale{vdupq_n_f32(2147483648.0f)};
+    const float32x4_t lo{vdupq_n_f32(-2147483648.0f)}, hi{vdupq_n_f32(2147483520.0f)};
+    const int32x4_t bias{vdupq_n_s32(std::is_signed<T>::value ? 0 : INT32_MIN)};
+
+    size_t i{0};
+    for(;count-i >= 4;i += 4)
+    {
+        const int32x4_t val{ScaleToInt(vld1q_f32(src+i), scale, lo, hi)};
+        vst1q_s32(reinterpret_cast<int32_t*>(dst+i), veorq_s32(val, bias));
+    }
+    ConvertBase(src+i, dst+i, count-i);
+}
+
+template<typename T>
+void ConvertInt16(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{
+    const float32x4_t scale{vdupq_n_f32(32768.0f)};
+    const float32x4_t lo{vdupq_n_f32(-32768.0f)}, hi{vdupq_n_f32(32767.0f)};
+    const int16x8_t bias{vdupq_n_s16(std::is_signed<T>::value ? 0 : INT16_MIN)};
+
+    size_t i{0};
+    for(;count-i >= 8;i += 8)
+    {
+        const int32x4_t val0{ScaleToInt(vld1q_f32(src+i), scale, lo, hi)};
+        const int32x4_t val1{ScaleToInt(vld1q_f32(src+i+4), scale, lo, hi)};
+        const int16x8_t val{vcombine_s16(vqmovn_s32(val0), vqmovn_s32(val1))};
+        vst1q_s16(reinterpret_cast<int16_t*>(dst+i), veorq_s16(val, bias));
+    }
+    ConvertBase(src+i, dst+i, count-i);
+}
+
+template<typename T>
+void ConvertInt8(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{
+    const float32x4_t scale{vdupq_n_f32(128.0f)};
+    const float32x4_t lo{vdupq_n_f32(-128.0f)}, hi{vdupq_n_f32(127.0f)};
+    const int8x16_t bias{vdupq_n_s8(std::is_signed<T>::value ? 0 : INT8_MIN)};
+
+    size_t i{0};
+    for(;count-i >= 16;i += 16)
+    {
+        const int32x4_t val0{ScaleToInt(vld1q_f32(src+i), scale, lo, hi)};
+        const int32x4_t val1{ScaleToInt(vld1q_f32(src+i+4), scale, lo, hi)};
+        const int32x4_t val2{ScaleToInt(vld1q_f32(src+i+8), scale, lo, hi)};
+        const int32x4_t val3{ScaleToInt(vld1q_f32(src+i+12), scale, lo, hi)};
+        const int16x8_t val01{vcombine_s16(vqmovn_s32(val0), vqmovn_s32(val1))};
+        const int16x8_t val23{vcombine_s16(vqmovn_s32(val2), vqmovn_s32(val3))};
+        const int8x16_t val{vcombine_s8(vqmovn_s16(val01), vqmovn_s16(val23))};
+        vst1q_s8(reinterpret_cast<int8_t*>(dst+i), veorq_s8(val, bias));
+    }
+    ConvertBase(src+i, dst+i, count-i);
+}
+#endif /* __aarch64__ */
+
 } // namespace
 
 template<>
@@ -227,81 +340,65 @@ void MixDirectHrtf_<NEONTag>(const FloatBufferSpan LeftOut, const FloatBufferSpa
 template<>
 void Mix_<NEONTag>(const al::span<const float> InSamples, const al::span<FloatBufferLine> OutBuffer,
     float *CurrentGains, const float *TargetGains, const size_t Counter, const size_t OutPos)
+{ MixBase<MixRamp,MixConst>(InSamples, OutBuffer, CurrentGains, TargetGains, Counter, OutPos); }
+
+
+template<>
+void Interleave_<NEONTag>(const al::span<const FloatBufferLine> InBuffer, const size_t InPos,
+    float *RESTRICT dst, const size_t FrameStep, const size_t todo)
 {
-    const float delta{(Counter > 0) ? 1.0f / static_cast<float>(Counter) : 0.0f};
-    const auto min_len = minz(Counter, InSamples.size());
-    const auto aligned_len = minz((min_len+3) & ~size_t{3}, InSamples.size()) - min_len;
+    /* Stereo and quad output can use the interleaving stores, while anything
+     * else (or with extra silent channels) is handled generically.
+     */
+    const size_t numchans{InBuffer.size()};
+    if(numchans != FrameStep || (numchans != 2 && numchans != 4))
+    {
+        InterleaveBase(InBuffer, InPos, dst, FrameStep, todo);
+        return;
+    }
+
+    auto load_line = [InBuffer,InPos](const size_t c, const size_t i) -> float32x4_t
+    { return vld1q_f32(InBuffer[c].data() + InPos + i); };
 
-    for(FloatBufferLine &output : OutBuffer)
+    size_t i{0};
+    if(numchans == 2)
     {
-        float *RESTRICT dst{al::assume_aligned<16>(output.data()+OutPos)};
-        float gain{*CurrentGains};
-        const float step{(*TargetGains-gain) * delta};
-
-        size_t pos{0};
-        if(!(std::abs(step) > std::numeric_limits<float>::epsilon()))
-            gain = *TargetGains;
-        else
+        for(;todo-i >= 4;i += 4)
         {
-            float step_count{0.0f};
-            /* Mix with applying gain steps in aligned multiples of 4. */
-            if(size_t todo{min_len >> 2})
-            {
-                const float32x4_t four4{vdupq_n_f32(4.0f)};
-                const float32x4_t step4{vdupq_n_f32(step)};
-                const float32x4_t gain4{vdupq_n_f32(gain)};
-                float32x4_t step_count4{vdupq_n_f32(0.0f)};
-                step_count4 = vsetq_lane_f32(1.0f, step_count4, 1);
-                step_count4 = vsetq_lane_f32(2.0f, step_count4, 2);
-                step_count4 = vsetq_lane_f32(3.0f, step_count4, 3);
-
-                do {
-                    const float32x4_t val4 = vld1q_f32(&InSamples[pos]);
-                    float32x4_t dry4 = vld1q_f32(&dst[pos]);
-                    dry4 = vmlaq_f32(dry4, val4, vmlaq_f32(gain4, step4, step_count4));
-                    step_count4 = vaddq_f32(step_count4, four4);
-                    vst1q_f32(&dst[pos], dry4);
-                    pos += 4;
-                } while(--todo);
-                /* NOTE: step_count4 now represents the next four counts after
-                 * the last four mixed samples, so the lowest element
-                 * represents the next step count to apply.
-                 */
-                step_count = vgetq_lane_f32(step_count4, 0);
-            }
-            /* Mix with applying left over gain steps that aren't aligned multiples of 4. */
-            for(size_t leftover{min_len&3};leftover;++pos,--leftover)
-            {
-                dst[pos] += InSamples[pos] * (gain + step*step_count);
-                step_count += 1.0f;
-            }
-            if(pos == Counter)
-                gain = *TargetGains;
-            else
-                gain += step*step_count;
-
-            /* Mix until pos is aligned with 4 or the mix is done. */
-            for(size_t leftover{aligned_len&3};leftover;++pos,--leftover)
-                dst[pos] += InSamples[pos] * gain;
+            float32x4x2_t frames;
+            frames.val[0] = load_line(0, i);
+            frames.val[1] = load_line(1, i);
+            vst2q_f32(dst, frames);
+            dst += 8;
         }
-        *CurrentGains = gain;
-        ++CurrentGains;
-        ++TargetGains;
-
-        if(!(std::abs(gain) > GainSilenceThreshold))
-            continue;
-        if(size_t todo{(InSamples.size()-pos) >> 2})
+    }
+    else
+    {
+        for(;todo-i >= 4;i += 4)
         {
-            const float32x4_t gain4 = vdupq_n_f32(gain);
-            do {
-                const float32x4_t val4 = vld1q_f32(&InSamples[pos]);
-                float32x4_t dry4 = vld1q_f32(&dst[pos]);
-                dry4 = vmlaq_f32(dry4, val4, gain4);
-                vst1q_f32(&dst[pos], dry4);
-                pos += 4;
-            } while(--todo);
+            float32x4x4_t frames;
+            frames.val[0] = load_line(0, i);
+            frames.val[1] = load_line(1, i);
+            frames.val[2] = load_line(2, i);
+            frames.val[3] = load_line(3, i);
+            vst4q_f32(dst, frames);
+            dst += 16;
         }
-        for(size_t leftover{(InSamples.size()-pos)&3};leftover;++pos,--leftover)
-            dst[pos] += InSamples[pos] * gain;
     }
+    if(i < todo)
+        InterleaveBase(InBuffer, InPos+i, dst, FrameStep, todo-i);
+}
+
+template<>
+void ConvertSamples_<NEONTag>(const float *RESTRICT src, void *dst, const DevFmtType type,
+    const size_t count)
+{
+#ifdef __aarch64__
+    ConvertSamplesBase<ConvertInt8<int8_t>,ConvertInt8<uint8_t>,ConvertInt16<int16_t>,
+        ConvertInt16<uint16_t>,ConvertInt32<int32_t>,ConvertInt32<uint32_t>>(src, dst, type,
+        count);
+#else
+    ConvertSamplesBase<ConvertBase<int8_t>,ConvertBase<uint8_t>,ConvertBase<int16_t>,
+        ConvertBase<uint16_t>,ConvertBase<int32_t>,ConvertBase<uint32_t>>(src, dst, type, count);
+#endif
 }
@@ -9,6 +9,8 @@
 #include "core/bsinc_defs.h"
 #include "defs.h"
 #include "hrtfbase.h"
+#include "mixbase.h"
+#include "writebase.h"
 
 struct SSETag;
 struct BSincTag;
@@ -73,6 +75,54 @@ inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const Cons
     }
 }
 
+inline void MixRamp(const float *RESTRICT src, float *RESTRICT dst, size_t pos, const size_t end,
+    const float gain, const float step)
+{
+    /* Ramps always start at a block boundary, so pos is aligned with 4. */
+    if(size_t todo{(end-pos) >> 2})
+    {
+        const __m128 four4{_mm_set1_ps(4.0f)};
+        const __m128 step4{_mm_set1_ps(step)};
+        const __m128 gain4{_mm_set1_ps(gain)};
+        __m128 step_count4{_mm_add_ps(_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f),
+            _mm_set1_ps(static_cast<float>(pos)))};
+        do {
+            const __m128 val4{_mm_load_ps(&src[pos])};
+            __m128 dry4{_mm_load_ps(&dst[pos])};
+
+            /* dry += val * (gain + step*step_count) */
+            dry4 = MLA4(dry4, val4, MLA4(gain4, step4, step_count4));
+
+            _mm_store_ps(&dst[pos], dry4);
+            step_count4 = _mm_add_ps(step_count4, four4);
+            pos += 4;
+        } while(--todo);
+    }
+    for(;pos < end;++pos)
+        dst[pos] += src[pos] * (gain + step*static_cast<float>(pos));
+}
+
+inline void MixConst(const float *RESTRICT src, float *RESTRICT dst, size_t pos, const size_t end,
+    const float gain)
+{
+    /* Mix until pos is aligned with 4 or the mix is done. */
+    for(;pos < end && (pos&3);++pos)
+        dst[pos] += src[pos] * gain;
+    if(size_t todo{(end-pos) >> 2})
+    {
+        const __m128 gain4{_mm_set1_ps(gain)};
+        do {
+            const __m128 val4{_mm_load_ps(&src[pos])};
+            __m128 dry4{_mm_load_ps(&dst[pos])};
+            dry4 = _mm_add_ps(dry4, _mm_mul_ps(val4, gain4));
+            _mm_store_ps(&dst[pos], dry4);
+            pos += 4;
+        } while(--todo);
+    }
+    for(;pos < end;++pos)
+        dst[pos] += src[pos] * gain;
+}
+
 } // namespace
 
 template<>
@@ -193,80 +243,92 @@ void MixDirectHrtf_<SSETag>(const FloatBufferSpan LeftOut, const FloatBufferSpan
 template<>
 void Mix_<SSETag>(const al::span<const float> InSamples, const al::span<FloatBufferLine> OutBuffer,
     float *CurrentGains, const float *TargetGains, const size_t Counter, const size_t OutPos)
+{ MixBase<MixRamp,MixConst>(InSamples, OutBuffer, CurrentGains, TargetGains, Counter, OutPos); }
+
+
+template<>
+void Interleave_<SSETag>(const al::span<const FloatBufferLine> InBuffer, const size_t InPos,
+    float *RESTRICT dst, const size_t FrameStep, const size_t todo)
 {
-    const float delta{(Counter > 0) ? 1.0f / static_cast<float>(Counter) : 0.0f};
-    const auto min_len = minz(Counter, InSamples.size());
-    const auto aligned_len = minz((min_len+3) & ~size_t{3}, InSamples.size()) - min_len;
+    /* Common channel counts are transposed 4 frames at a time, while anything
+     * else (or with extra silent channels) is handled generically.
+     */
+    const size_t numchans{InBuffer.size()};
+    if(numchans != FrameStep || (numchans != 2 && numchans != 4 && numchans != 6
+        && numchans != 8))
+    {
+        InterleaveBase(InBuffer, InPos, dst, FrameStep, todo);
+        return;
+    }
+
+    auto load_line = [InBuffer,InPos](const size_t c, const size_t i) -> __m128
+    { return _mm_loadu_ps(InBuffer[c].data() + InPos + i); };
 
-    for(FloatBufferLine &output : OutBuffer)
+    size_t i{0};
+    switch(numchans)
     {
-        float *RESTRICT dst{al::assume_aligned<16>(output.data()+OutPos)};
-        float gain{*CurrentGains};
-        const float step{(*TargetGains-gain) * delta};
-
-        size_t pos{0};
-        if(!(std::abs(step) > std::numeric_limits<float>::epsilon()))
-            gain = *TargetGains;
-        else
+    case 2:
+        for(;todo-i >= 4;i += 4)
         {
-            float step_count{0.0f};
-            /* Mix with applying gain steps in aligned multiples of 4. */
-            if(size_t todo{min_len >> 2})
-            {
-                const __m128 four4{_mm_set1_ps(4.0f)};
-                const __m128 step4{_mm_set1_ps(step)};
-                const __m128 gain4{_mm_set1_ps(gain)};
-                __m128 step_count4{_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)};
-                do {
-                    const __m128 val4{_mm_load_ps(&InSamples[pos])};
-                    __m128 dry4{_mm_load_ps(&dst[pos])};
-
-                    /* dry += val * (gain + step*step_count) */
-                    dry4 = MLA4(dry4, val4, MLA4(gain4, step4, step_count4));
-
-                    _mm_store_ps(&dst[pos], dry4);
-                    step_count4 = _mm_add_ps(step_count4, four4);
-                    pos += 4;
-                } while(--todo);
-                /* NOTE: step_count4 now represents the next four counts after
-                 * the last four mixed samples, so the lowest element
-                 * represents the next step count to apply.
-                 */
-                step_count = _mm_cvtss_f32(step_count4);
-            }
-            /* Mix with applying left over gain steps that aren't aligned multiples of 4. */
-            for(size_t leftover{min_len&3};leftover;++pos,--leftover)
-            {
-                dst[pos] += InSamples[pos] * (gain + step*step_count);
-                step_count += 1.0f;
-            }
-            if(pos == Counter)
-                gain = *TargetGains;
-            else
-                gain += step*step_count;
-
-            /* Mix until pos is aligned with 4 or the mix is done. */
-            for(size_t leftover{aligned_len&3};leftover;++pos,--leftover)
-                dst[pos] += InSamples[pos] * gain;
+            const __m128 c0{load_line(0, i)}, c1{load_line(1, i)};
+            _mm_storeu_ps(dst, _mm_unpacklo_ps(c0, c1));
+            _mm_storeu_ps(dst+4, _mm_unpackhi_ps(c0, c1));
+            dst += 8;
         }
-        *CurrentGains = gain;
-        ++CurrentGains;
-        ++TargetGains;
-
-        if(!(std::abs(gain) > GainSilenceThreshold))
-            continue;
-        if(size_t todo{(InSamples.size()-pos) >> 2})
+        break;
+    case 4:
+        for(;todo-i >= 4;i += 4)
         {
-            const __m128 gain4{_mm_set1_ps(gain)};
-            do {
-                const __m128 val4{_mm_load_ps(&InSamples[pos])};
-                __m128 dry4{_mm_load_ps(&dst[pos])};
-                dry4 = _mm_add_ps(dry4, _mm_mul_ps(val4, gain4));
-                _mm_store_ps(&dst[pos], dry4);
-                pos += 4;
-            } while(--todo);
+            __m128 f0{load_line(0, i)}, f1{load_line(1, i)};
+            __m128 f2{load_line(2, i)}, f3{load_line(3, i)};
+            _MM_TRANSPOSE4_PS(f0, f1, f2, f3);
+            _mm_storeu_ps(dst, f0);
+            _mm_storeu_ps(dst+4, f1);
+            _mm_storeu_ps(dst+8, f2);
+            _mm_storeu_ps(dst+12, f3);
+            dst += 16;
+        }
+        break;
+    case 6:
+        for(;todo-i >= 4;i += 4)
+        {
+            __m128 f0{load_line(0, i)}, f1{load_line(1, i)};
+            __m128 f2{load_line(2, i)}, f3{load_line(3, i)};
+            _MM_TRANSPOSE4_PS(f0, f1, f2, f3);
+            const __m128 c4{load_line(4, i)}, c5{load_line(5, i)};
+            const __m128 p01{_mm_unpacklo_ps(c4, c5)}, p23{_mm_unpackhi_ps(c4, c5)};
+            _mm_storeu_ps(dst, f0);
+            _mm_storel_pi(reinterpret_cast<__m64*>(dst+4), p01);
+            _mm_storeu_ps(dst+6, f1);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(dst+10), p01);
+            _mm_storeu_ps(dst+12, f2);
+            _mm_storel_pi(reinterpret_cast<__m64*>(dst+16), p23);
+            _mm_storeu_ps(dst+18, f3);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(dst+22), p23);
+            dst += 24;
+        }
+        break;
+    case 8:
+        for(;todo-i >= 4;i += 4)
+        {
+            __m128 f0{load_line(0, i)}, f1{load_line(1, i)};
+            __m128 f2{load_line(2, i)}, f3{load_line(3, i)};
+            _MM_TRANSPOSE4_PS(f0, f1, f2, f3);
+            __m128 b0{load_line(4, i)}, b1{load_line(5, i)};
+            __m128 b2{load_line(6, i)}, b3{load_line(7, i)};
+            _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+            _mm_storeu_ps(dst, f0);
+            _mm_storeu_ps(dst+4, b0);
+            _mm_storeu_ps(dst+8, f1);
+            _mm_storeu_ps(dst+12, b1);
+            _mm_storeu_ps(dst+16, f2);
+            _mm_storeu_ps(dst+20, b2);
+            _mm_storeu_ps(dst+24, f3);
+            _mm_storeu_ps(dst+28, b3);
+            dst += 32;
         }
-        for(size_t leftover{(InSamples.size()-pos)&3};leftover;++pos,--leftover)
-            dst[pos] += InSamples[pos] * gain;
+        break;
     }
+    if(i < todo)
+        InterleaveBase(InBuffer, InPos+i, dst, FrameStep, todo-i);
 }
@@ -23,8 +23,12 @@
 #include <xmmintrin.h>
 #include <emmintrin.h>
 
+#include <stdint.h>
+#include <type_traits>
+
 #include "alnumeric.h"
 #include "defs.h"
+#include "writebase.h"
 
 struct SSE2Tag;
 struct LerpTag;
@@ -34,6 +38,73 @@ struct LerpTag;
 #pragma GCC target("sse2")
 #endif
 
+namespace {
+
+/* Scales and clamps the samples to the integer range given by the limits, and
+ * converts them to 32-bit integers. The clamp keeps the packed conversion
+ * matching SampleConv, and the packing below from saturating.
+ */
+inline __m128i ScaleToInt(const __m128 val, const __m128 scale, const __m128 lo, const __m128 hi)
+{ return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(val, scale), lo), hi)); }
+
+template<typename T>
+void ConvertInt32(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{
+    const __m128 scale{_mm_set1_ps(2147483648.0f)};
+    const __m128 lo{_mm_set1_ps(-2147483648.0f)}, hi{_mm_set1_ps(2147483520.0f)};
+    /* Unsigned output flips the sign bit, to offset it by 2^31. */
+    const __m128i bias{_mm_set1_epi32(std::is_signed<T>::value ? 0 : INT32_MIN)};
+
+    size_t i{0};
+    for(;count-i >= 4;i += 4)
+    {
+        const __m128i val{ScaleToInt(_mm_loadu_ps(src+i), scale, lo, hi)};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), _mm_xor_si128(val, bias));
+    }
+    ConvertBase(src+i, dst+i, count-i);
+}
+
+template<typename T>
+void ConvertInt16(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{
+    const __m128 scale{_mm_set1_ps(32768.0f)};
+    const __m128 lo{_mm_set1_ps(-32768.0f)}, hi{_mm_set1_ps(32767.0f)};
+    const __m128i bias{_mm_set1_epi16(std::is_signed<T>::value ? 0 : INT16_MIN)};
+
+    size_t i{0};
+    for(;count-i >= 8;i += 8)
+    {
+        const __m128i val0{ScaleToInt(_mm_loadu_ps(src+i), scale, lo, hi)};
+        const __m128i val1{ScaleToInt(_mm_loadu_ps(src+i+4), scale, lo, hi)};
+        const __m128i val{_mm_packs_epi32(val0, val1)};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), _mm_xor_si128(val, bias));
+    }
+    ConvertBase(src+i, dst+i, count-i);
+}
+
+template<typename T>
+void ConvertInt8(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{
+    const __m128 scale{_mm_set1_ps(128.0f)};
+    const __m128 lo{_mm_set1_ps(-128.0f)}, hi{_mm_set1_ps(127.0f)};
+    const __m128i bias{_mm_set1_epi8(std::is_signed<T>::value ? 0 : INT8_MIN)};
+
+    size_t i{0};
+    for(;count-i >= 16;i += 16)
+    {
+        const __m128i val0{ScaleToInt(_mm_loadu_ps(src+i), scale, lo, hi)};
+        const __m128i val1{ScaleToInt(_mm_loadu_ps(src+i+4), scale, lo, hi)};
+        const __m128i val2{ScaleToInt(_mm_loadu_ps(src+i+8), scale, lo, hi)};
+        const __m128i val3{ScaleToInt(_mm_loadu_ps(src+i+12), scale, lo, hi)};
+        const __m128i val{_mm_packs_epi16(_mm_packs_epi32(val0, val1),
+            _mm_packs_epi32(val2, val3))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), _mm_xor_si128(val, bias));
+    }
+    ConvertBase(src+i, dst+i, count-i);
+}
+
+} // namespace
+
 template<>
 float *Resample_<LerpTag,SSE2Tag>(const InterpState*, float *RESTRICT src, uint frac,
     uint increment, const al::span<float> dst)
@@ -87,3 +158,13 @@ float *Resample_<LerpTag,SSE2Tag>(const InterpState*, float *RESTRICT src, uint
     }
     return dst.data();
 }
+
+
+template<>
+void ConvertSamples_<SSE2Tag>(const float *RESTRICT src, void *dst, const DevFmtType type,
+    const size_t count)
+{
+    ConvertSamplesBase<ConvertInt8<int8_t>,ConvertInt8<uint8_t>,ConvertInt16<int16_t>,
+        ConvertInt16<uint16_t>,ConvertInt32<int32_t>,ConvertInt32<uint32_t>>(src, dst, type,
+        count);
+}
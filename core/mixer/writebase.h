@@ -0,0 +1,108 @@
+#ifndef CORE_MIXER_WRITEBASE_H
+#define CORE_MIXER_WRITEBASE_H
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alnumeric.h"
+#include "alspan.h"
+#include "core/bufferline.h"
+#include "core/devformat.h"
+#include "opthelpers.h"
+
+
+/* Base template left undefined. Should be marked =delete, but Clang 3.8.1
+ * chokes on that given the inline specializations.
+ */
+template<typename T>
+inline T SampleConv(float) noexcept;
+
+template<> inline float SampleConv(float val) noexcept
+{ return val; }
+template<> inline int32_t SampleConv(float val) noexcept
+{
+    /* Floats have a 23-bit mantissa, plus an implied 1 bit and a sign bit.
+     * This means a normalized float has at most 25 bits of signed precision.
+     * When scaling and clamping for a signed 32-bit integer, these following
+     * values are the best a float can give.
+     */
+    return fastf2i(clampf(val*2147483648.0f, -2147483648.0f, 2147483520.0f));
+}
+template<> inline int16_t SampleConv(float val) noexcept
+{ return static_cast<int16_t>(fastf2i(clampf(val*32768.0f, -32768.0f, 32767.0f))); }
+template<> inline int8_t SampleConv(float val) noexcept
+{ return static_cast<int8_t>(fastf2i(clampf(val*128.0f, -128.0f, 127.0f))); }
+
+/* Define unsigned output variations. */
+template<> inline uint32_t SampleConv(float val) noexcept
+{ return static_cast<uint32_t>(SampleConv<int32_t>(val)) + 2147483648u; }
+template<> inline uint16_t SampleConv(float val) noexcept
+{ return static_cast<uint16_t>(SampleConv<int16_t>(val) + 32768); }
+template<> inline uint8_t SampleConv(float val) noexcept
+{ return static_cast<uint8_t>(SampleConv<int8_t>(val) + 128); }
+
+
+/* Interleaves the given frames of the input lines, starting at InPos, with
+ * FrameStep samples per output frame. Output channels beyond the input lines
+ * are silenced.
+ */
+inline void InterleaveBase(const al::span<const FloatBufferLine> InBuffer, const size_t InPos,
+    float *RESTRICT dst, const size_t FrameStep, const size_t todo)
+{
+    ASSUME(FrameStep > 0);
+    ASSUME(todo > 0);
+
+    size_t c{0};
+    for(const FloatBufferLine &inbuf : InBuffer)
+    {
+        const float *RESTRICT src{inbuf.data() + InPos};
+        float *RESTRICT out{dst + c};
+        for(size_t i{0};i < todo;++i)
+        {
+            *out = src[i];
+            out += FrameStep;
+        }
+        ++c;
+    }
+    if(const size_t extra{FrameStep - c})
+    {
+        float *RESTRICT out{dst + c};
+        for(size_t i{0};i < todo;++i)
+        {
+            std::fill_n(out, extra, 0.0f);
+            out += FrameStep;
+        }
+    }
+}
+
+/* Converts count contiguous samples to the output sample type. */
+template<typename T>
+inline void ConvertBase(const float *RESTRICT src, T *RESTRICT dst, const size_t count)
+{ std::transform(src, src+count, dst, SampleConv<T>); }
+
+/* Converts count contiguous samples to the given device sample type, using the
+ * specified conversion functions for each integer type.
+ */
+template<void (&ToInt8)(const float*,int8_t*,const size_t),
+    void (&ToUInt8)(const float*,uint8_t*,const size_t),
+    void (&ToInt16)(const float*,int16_t*,const size_t),
+    void (&ToUInt16)(const float*,uint16_t*,const size_t),
+    void (&ToInt32)(const float*,int32_t*,const size_t),
+    void (&ToUInt32)(const float*,uint32_t*,const size_t)>
+void ConvertSamplesBase(const float *RESTRICT src, void *dst, const DevFmtType type,
+    const size_t count)
+{
+    switch(type)
+    {
+    case DevFmtByte: ToInt8(src, static_cast<int8_t*>(dst), count); break;
+    case DevFmtUByte: ToUInt8(src, static_cast<uint8_t*>(dst), count); break;
+    case DevFmtShort: ToInt16(src, static_cast<int16_t*>(dst), count); break;
+    case DevFmtUShort: ToUInt16(src, static_cast<uint16_t*>(dst), count); break;
+    case DevFmtInt: ToInt32(src, static_cast<int32_t*>(dst), count); break;
+    case DevFmtUInt: ToUInt32(src, static_cast<uint32_t*>(dst), count); break;
+    case DevFmtFloat: std::copy_n(src, count, static_cast<float*>(dst)); break;
+    }
+}
+
+#endif /* CORE_MIXER_WRITEBASE_H */
@@ -0,0 +1,262 @@
+
+#include "config.h"
+
+#include "mixer_pool.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "alnumeric.h"
+#include "async_event.h"
+#include "context.h"
+#include "effectslot.h"
+#include "fpu_ctrl.h"
+#include "helpers.h"
+#include "logging.h"
+#include "mixer.h"
+#include "voice.h"
+
+
+MixerPool::MixerPool(DeviceBase *device, const size_t numworkers, const size_t numevents)
+    : mDevice{device}
+{
+    mWorkers.reserve(numworkers);
+    for(size_t i{0};i < numworkers;++i)
+    {
+        auto worker = std::make_unique<Worker>();
+        std::fill(std::begin(worker->HrtfAccumData), std::end(worker->HrtfAccumData), float2{});
+        worker->mBuffers.resize(device->MixBuffer.size());
+        worker->mRemaps.reserve(16);
+        worker->mEvents = RingBuffer::Create(numevents, sizeof(AsyncEvent), false);
+        worker->mEventRing = worker->mEvents.get();
+        mWorkers.emplace_back(std::move(worker));
+    }
+
+    try {
+        size_t index{0};
+        for(auto &worker : mWorkers)
+            worker->mThread = std::thread{std::mem_fn(&MixerPool::workerProc), this, worker.get(),
+                ++index};
+    }
+    catch(...) {
+        mQuit.store(true, std::memory_order_release);
+        for(auto &worker : mWorkers)
+        {
+            if(worker->mThread.joinable())
+            {
+                worker->mSem.post();
+                worker->mThread.join();
+            }
+        }
+        throw;
+    }
+    TRACE("Started %zu mixer worker thread%s\n", mWorkers.size(),
+        (mWorkers.size()==1) ? "" : "s");
+}
+
+MixerPool::~MixerPool()
+{
+    mQuit.store(true, std::memory_order_release);
+    for(auto &worker : mWorkers)
+    {
+        worker->mSem.post();
+        worker->mThread.join();
+    }
+}
+
+
+void MixerPool::workerProc(Worker *worker, const size_t index)
+{
+    SetRTPriority();
+    althrd_setname(MIXER_WORKER_THREAD_NAME);
+
+    FPUCtl mixer_mode{};
+    const size_t stride{threadCount()};
+    while(true)
+    {
+        worker->mSem.wait();
+        if(unlikely(mQuit.load(std::memory_order_acquire)))
+            break;
+
+        ContextBase *context{mContext};
+        const al::span<Voice*> voices{mVoices};
+        const al::span<EffectSlot*> slots{mSlots};
+        const uint samplesToDo{mSamplesToDo};
+        for(size_t i{index};i < slots.size();i += stride)
+        {
+            if(!slots[i]->needsProcessing(samplesToDo))
+                continue;
+            EffectState *state{slots[i]->mEffectState.get()};
+            const al::span<FloatBufferLine> target{worker->getTarget(state->mOutTarget)};
+            if(!target.empty())
+                state->process(samplesToDo, slots[i]->Wet.Buffer, target);
+        }
+        for(size_t i{index};i < voices.size();i += stride)
+        {
+            Voice *voice{voices[i]};
+            const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+            if(vstate == Voice::Stopped || vstate == Voice::Pending)
+                continue;
+            /* Callback voices are left for the mixer thread, so the app's
+             * callback is only ever called from there.
+             */
+            if(voice->mFlags.test(VoiceIsCallback))
+                continue;
+            voice->mix(vstate, context, *worker, samplesToDo);
+        }
+
+        mDoneSem.post();
+    }
+}
+
+
+void MixerPool::prepareRemaps(Worker *worker, const EffectSlotArray &slots)
+{
+    size_t total{mDevice->MixBuffer.size()};
+    for(const EffectSlot *slot : slots)
+        total += slot->Wet.Buffer.size();
+
+    /* This only needs to grow when more effect slot channels are active than
+     * were previously seen.
+     */
+    if(unlikely(worker->mBuffers.size() < total))
+        worker->mBuffers.resize(total);
+
+    FloatBufferLine *target{worker->mBuffers.data()};
+    auto add_remap = [worker,&target](const al::span<FloatBufferLine> buffer) -> void
+    {
+        if(buffer.empty()) return;
+        worker->mRemaps.emplace_back(MixTargetRemap{buffer.data(), buffer.size(), target, false});
+        target += buffer.size();
+    };
+    worker->mRemaps.clear();
+    add_remap(mDevice->MixBuffer);
+    for(EffectSlot *slot : slots)
+        add_remap(slot->Wet.Buffer);
+
+    worker->mTargetRemaps = {worker->mRemaps.data(), worker->mRemaps.size()};
+    worker->mRemapSamples = mSamplesToDo;
+}
+
+void MixerPool::mergeWorker(Worker *worker)
+{
+    const uint samplesToDo{mSamplesToDo};
+
+    /* Add the worker's mix to the real buffers, using the (SIMD-optimized)
+     * mixer with a constant unity gain.
+     */
+    for(MixTargetRemap &remap : worker->mRemaps)
+    {
+        if(!remap.mUsed)
+            continue;
+        for(size_t i{0};i < remap.mCount;++i)
+        {
+            float gain{1.0f};
+            MixSamples({remap.mTarget[i].data(), samplesToDo}, {remap.mBase+i, 1u}, &gain, &gain,
+                0, 0);
+        }
+    }
+
+    if(worker->mHrtfAccumUsed)
+    {
+        const size_t todo{samplesToDo + HrirLength};
+        auto add_accum = [](const float2 &lhs, const float2 &rhs) noexcept -> float2
+        { return float2{{lhs[0]+rhs[0], lhs[1]+rhs[1]}}; };
+        std::transform(std::begin(mDevice->HrtfAccumData), std::begin(mDevice->HrtfAccumData)+todo,
+            std::begin(worker->HrtfAccumData), std::begin(mDevice->HrtfAccumData), add_accum);
+        std::fill_n(std::begin(worker->HrtfAccumData), todo, float2{});
+        worker->mHrtfAccumUsed = false;
+    }
+
+    /* Pass along any events the voices generated. */
+    RingBuffer *ring{worker->mEvents.get()};
+    if(const size_t count{ring->readSpace()})
+    {
+        RingBuffer *ctxring{mContext->mAsyncEvents.get()};
+        auto evt_vec = ring->getReadVector();
+        size_t written{0};
+        if(evt_vec.first.len > 0)
+            written += ctxring->write(evt_vec.first.buf, evt_vec.first.len);
+        if(evt_vec.second.len > 0)
+            written += ctxring->write(evt_vec.second.buf, evt_vec.second.len);
+        ring->readAdvance(count);
+        if(written < count)
+            mContext->mEventsDropped.fetch_add(static_cast<uint>(count-written),
+                std::memory_order_relaxed);
+    }
+}
+
+
+void MixerPool::mixVoices(ContextBase *context, const al::span<Voice*> voices,
+    const EffectSlotArray &slots, const uint samplesToDo)
+{
+    mContext = context;
+    mVoices = voices;
+    mSlots = {};
+    mSamplesToDo = samplesToDo;
+    for(auto &worker : mWorkers)
+    {
+        prepareRemaps(worker.get(), slots);
+        worker->mSem.post();
+    }
+
+    const size_t stride{threadCount()};
+    for(size_t i{0};i < voices.size();i += stride)
+    {
+        Voice *voice{voices[i]};
+        const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+        if(vstate != Voice::Stopped && vstate != Voice::Pending)
+            voice->mix(vstate, context, *mDevice, samplesToDo);
+    }
+
+    for(size_t i{0};i < mWorkers.size();++i)
+        mDoneSem.wait();
+
+    /* Now that the workers are done, mix the callback voices they skipped. */
+    for(size_t i{0};i < voices.size();++i)
+    {
+        if(!(i%stride))
+            continue;
+        Voice *voice{voices[i]};
+        if(!voice->mFlags.test(VoiceIsCallback))
+            continue;
+        const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+        if(vstate != Voice::Stopped && vstate != Voice::Pending)
+            voice->mix(vstate, context, *mDevice, samplesToDo);
+    }
+
+    for(auto &worker : mWorkers)
+        mergeWorker(worker.get());
+}
+
+void MixerPool::processEffects(ContextBase *context, const al::span<EffectSlot*> slots,
+    const EffectSlotArray &allslots, const uint samplesToDo)
+{
+    mContext = context;
+    mVoices = {};
+    mSlots = slots;
+    mSamplesToDo = samplesToDo;
+
+    /* Only wake the workers that have a slot to process. */
+    const size_t numworkers{minz(mWorkers.size(), slots.size()-1)};
+    for(size_t i{0};i < numworkers;++i)
+    {
+        prepareRemaps(mWorkers[i].get(), allslots);
+        mWorkers[i]->mSem.post();
+    }
+
+    const size_t stride{threadCount()};
+    for(size_t i{0};i < slots.size();i += stride)
+    {
+        if(!slots[i]->needsProcessing(samplesToDo))
+            continue;
+        EffectState *state{slots[i]->mEffectState.get()};
+        state->process(samplesToDo, slots[i]->Wet.Buffer, state->mOutTarget);
+    }
+
+    for(size_t i{0};i < numworkers;++i)
+        mDoneSem.wait();
+    for(size_t i{0};i < numworkers;++i)
+        mergeWorker(mWorkers[i].get());
+}
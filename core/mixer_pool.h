@@ -0,0 +1,108 @@
+#ifndef CORE_MIXER_POOL_H
+#define CORE_MIXER_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <thread>
+
+#include "almalloc.h"
+#include "alspan.h"
+#include "bufferline.h"
+#include "device.h"
+#include "ringbuffer.h"
+#include "threads.h"
+#include "vector.h"
+
+struct ContextBase;
+struct EffectSlot;
+struct Voice;
+
+using uint = unsigned int;
+using EffectSlotArray = al::FlexArray<EffectSlot*>;
+
+
+/* Must be less than 15 characters (16 including terminating null) for
+ * compatibility with pthread_setname_np limitations. */
+#define MIXER_WORKER_THREAD_NAME "alsoft-mixwork"
+
+/* The maximum number of threads to mix with, including the mixer thread. */
+constexpr uint MaxMixerThreads{16};
+
+
+/**
+ * A fixed set of worker threads that help the device's mixer thread mix
+ * voices and process effects. Each worker processes a subset of a context's
+ * voices or effect slots into private copies of the dry and wet buffers, which
+ * are then summed into the real buffers once every worker is done.
+ */
+class MixerPool {
+    struct Worker : public MixerScratch {
+        std::thread mThread;
+        al::semaphore mSem;
+
+        /* Private copies of the output buffers, and the remapping for the
+         * device and effect slot buffers into them.
+         */
+        al::vector<FloatBufferLine,16> mBuffers;
+        al::vector<MixTargetRemap> mRemaps;
+        RingBufferPtr mEvents;
+
+        DEF_NEWDEL(Worker)
+    };
+
+    DeviceBase *const mDevice;
+    al::vector<std::unique_ptr<Worker>> mWorkers;
+
+    /* The current job, set by the mixer thread before waking the workers.
+     * Either voices or effect slots are given to be processed.
+     */
+    ContextBase *mContext{nullptr};
+    al::span<Voice*> mVoices;
+    al::span<EffectSlot*> mSlots;
+    uint mSamplesToDo{0u};
+    std::atomic<bool> mQuit{false};
+
+    al::semaphore mDoneSem;
+
+    void workerProc(Worker *worker, const size_t index);
+
+    void prepareRemaps(Worker *worker, const EffectSlotArray &slots);
+    void mergeWorker(Worker *worker);
+
+public:
+    /**
+     * Creates the given number of worker threads for the device. Each worker
+     * can queue up to numevents events per mix, which should be enough for
+     * all of the device's sources.
+     */
+    MixerPool(DeviceBase *device, const size_t numworkers, const size_t numevents);
+    ~MixerPool();
+
+    MixerPool(const MixerPool&) = delete;
+    MixerPool& operator=(const MixerPool&) = delete;
+
+    /** The total number of threads that mix, including the mixer thread. */
+    size_t threadCount() const noexcept { return mWorkers.size() + 1; }
+
+    /**
+     * Mixes the given voices of the context, split between the workers and
+     * the calling thread. Returns once all the voices are mixed and the output
+     * is merged into the context's dry and wet buffers.
+     */
+    void mixVoices(ContextBase *context, const al::span<Voice*> voices,
+        const EffectSlotArray &slots, const uint samplesToDo);
+
+    /**
+     * Processes the effects of the given slots, split between the workers and
+     * the calling thread. None of the slots may target another in the list.
+     * The workers' output is added to the targets in a fixed order, so the
+     * result doesn't depend on thread timing.
+     */
+    void processEffects(ContextBase *context, const al::span<EffectSlot*> slots,
+        const EffectSlotArray &allslots, const uint samplesToDo);
+
+    DEF_NEWDEL(MixerPool)
+};
+
+#endif /* CORE_MIXER_POOL_H */
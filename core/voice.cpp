@@ -45,6 +45,9 @@ struct CTag;
 #ifdef HAVE_SSE
 struct SSETag;
 #endif
+#ifdef HAVE_AVX2
+struct AVX2Tag;
+#endif
 #ifdef HAVE_NEON
 struct NEONTag;
 #endif
@@ -76,6 +79,10 @@ inline MixerFunc SelectMixer()
     if((CPUCapFlags&CPU_CAP_NEON))
         return Mix_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2) && (CPUCapFlags&CPU_CAP_FMA))
+        return Mix_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return Mix_<SSETag>;
@@ -89,6 +96,10 @@ inline HrtfMixerFunc SelectHrtfMixer()
     if((CPUCapFlags&CPU_CAP_NEON))
         return MixHrtf_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2) && (CPUCapFlags&CPU_CAP_FMA))
+        return MixHrtf_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return MixHrtf_<SSETag>;
@@ -102,6 +113,10 @@ inline HrtfMixerBlendFunc SelectHrtfBlendMixer()
     if((CPUCapFlags&CPU_CAP_NEON))
         return MixHrtfBlend_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2) && (CPUCapFlags&CPU_CAP_FMA))
+        return MixHrtfBlend_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return MixHrtfBlend_<SSETag>;
@@ -159,11 +174,14 @@ void Voice::InitMixer(al::optional<std::string> resampler)
 
 namespace {
 
-void SendSourceStoppedEvent(ContextBase *context, uint id)
+void SendSourceStoppedEvent(ContextBase *context, RingBuffer *ring, uint id)
 {
-    RingBuffer *ring{context->mAsyncEvents.get()};
     auto evt_vec = ring->getWriteVector();
-    if(evt_vec.first.len < 1) return;
+    if(evt_vec.first.len < 1)
+    {
+        context->mEventsDropped.fetch_add(1u, std::memory_order_relaxed);
+        return;
+    }
 
     AsyncEvent *evt{al::construct_at(reinterpret_cast<AsyncEvent*>(evt_vec.first.buf),
         AsyncEvent::SourceStateChange)};
@@ -245,6 +263,30 @@ void LoadSamples(const al::span<float*> dstSamples, const size_t dstOffset, cons
 #undef HANDLE_FMT
 }
 
+/* Loads samples from the buffer item, using its pre-decoded planar copy when
+ * it has one.
+ */
+void LoadBufferSamples(const al::span<float*> dstSamples, const size_t dstOffset,
+    const VoiceBufferItem *buffer, const size_t srcOffset, const FmtType srcType,
+    const FmtChannels srcChans, const size_t srcStep, const size_t samples) noexcept
+{
+    if(const float *planar{buffer->mPlanarSamples})
+    {
+        /* UHJ2 and Super Stereo have a third channel not in the buffer. */
+        const float *src{planar + srcOffset};
+        for(size_t c{0};c < dstSamples.size();++c)
+        {
+            if(c < srcStep)
+                std::copy_n(src + c*buffer->mPlanarStride, samples, dstSamples[c]+dstOffset);
+            else
+                std::fill_n(dstSamples[c]+dstOffset, samples, 0.0f);
+        }
+        return;
+    }
+    LoadSamples(dstSamples, dstOffset, buffer->mSamples, srcOffset, srcType, srcChans, srcStep,
+        samples);
+}
+
 void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *&bufferLoopItem,
     const size_t dataPosInt, const FmtType sampleType, const FmtChannels sampleChannels,
     const size_t srcStep, const size_t samplesToLoad, const al::span<float*> voiceSamples)
@@ -260,7 +302,7 @@ void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *&bufferLoopItem,
 
         /* Load what's left to play from the buffer */
         const size_t remaining{minz(samplesToLoad, buffer->mSampleLen-dataPosInt)};
-        LoadSamples(voiceSamples, 0, buffer->mSamples, dataPosInt, sampleType, sampleChannels,
+        LoadBufferSamples(voiceSamples, 0, buffer, dataPosInt, sampleType, sampleChannels,
             srcStep, remaining);
 
         if(const size_t toFill{samplesToLoad - remaining})
@@ -276,7 +318,7 @@ void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *&bufferLoopItem,
     {
         /* Load what's left of this loop iteration */
         const size_t remaining{minz(samplesToLoad, loopEnd-dataPosInt)};
-        LoadSamples(voiceSamples, 0, buffer->mSamples, dataPosInt, sampleType, sampleChannels,
+        LoadBufferSamples(voiceSamples, 0, buffer, dataPosInt, sampleType, sampleChannels,
             srcStep, remaining);
 
         /* Load repeats of the loop to fill the buffer. */
@@ -284,7 +326,7 @@ void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *&bufferLoopItem,
         size_t samplesLoaded{remaining};
         while(const size_t toFill{minz(samplesToLoad - samplesLoaded, loopSize)})
         {
-            LoadSamples(voiceSamples, samplesLoaded, buffer->mSamples, loopStart, sampleType,
+            LoadBufferSamples(voiceSamples, samplesLoaded, buffer, loopStart, sampleType,
                 sampleChannels, srcStep, toFill);
             samplesLoaded += toFill;
         }
@@ -327,7 +369,7 @@ void LoadBufferQueue(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
         }
 
         const size_t remaining{minz(samplesToLoad-samplesLoaded, buffer->mSampleLen-dataPosInt)};
-        LoadSamples(voiceSamples, samplesLoaded, buffer->mSamples, dataPosInt, sampleType,
+        LoadBufferSamples(voiceSamples, samplesLoaded, buffer, dataPosInt, sampleType,
             sampleChannels, srcStep, remaining);
 
         samplesLoaded += remaining;
@@ -353,11 +395,11 @@ void LoadBufferQueue(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
 
 void DoHrtfMix(const float *samples, const uint DstBufferSize, DirectParams &parms,
     const float TargetGain, const uint Counter, uint OutPos, const bool IsPlaying,
-    DeviceBase *Device)
+    const uint IrSize, MixerScratch &Scratch)
 {
-    const uint IrSize{Device->mIrSize};
-    auto &HrtfSamples = Device->HrtfSourceData;
-    auto &AccumSamples = Device->HrtfAccumData;
+    auto &HrtfSamples = Scratch.HrtfSourceData;
+    auto &AccumSamples = Scratch.HrtfAccumData;
+    Scratch.mHrtfAccumUsed = true;
 
     /* Copy the HRTF history and new input samples into a temp buffer. */
     auto src_iter = std::copy(parms.Hrtf.History.begin(), parms.Hrtf.History.end(),
@@ -427,7 +469,8 @@ void DoHrtfMix(const float *samples, const uint DstBufferSize, DirectParams &par
 }
 
 void DoNfcMix(const al::span<const float> samples, FloatBufferLine *OutBuffer, DirectParams &parms,
-    const float *TargetGains, const uint Counter, const uint OutPos, DeviceBase *Device)
+    const float *TargetGains, const uint Counter, const uint OutPos, DeviceBase *Device,
+    MixerScratch &Scratch)
 {
     using FilterProc = void (NfcFilter::*)(const al::span<const float>, float*);
     static constexpr FilterProc NfcProcess[MaxAmbiOrder+1]{
@@ -439,7 +482,7 @@ void DoNfcMix(const al::span<const float> samples, FloatBufferLine *OutBuffer, D
     ++CurrentGains;
     ++TargetGains;
 
-    const al::span<float> nfcsamples{Device->NfcSampleData, samples.size()};
+    const al::span<float> nfcsamples{Scratch.NfcSampleData, samples.size()};
     size_t order{1};
     while(const size_t chancount{Device->NumChannelsPerOrder[order]})
     {
@@ -455,7 +498,78 @@ void DoNfcMix(const al::span<const float> samples, FloatBufferLine *OutBuffer, D
 
 } // namespace
 
-void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo)
+/* Checks if the static voice can resample straight from the buffer's planar
+ * samples instead of loading them into the mixing lines. This requires the
+ * samples to be loaded are all in the buffer without wrapping or padding, and
+ * that the resampler history matches the samples before the read position
+ * (which isn't the case right after starting at an offset or looping).
+ * Voices that decode or upsample modify the loaded samples, so they can't.
+ */
+bool Voice::canResampleDirect(const VoiceBufferItem *buffer, const VoiceBufferItem *loopItem,
+    const uint dataPosInt, const uint srcBufferSize) const noexcept
+{
+    if(!mFlags.test(VoiceIsStatic) || mFlags.test(VoiceIsAmbisonic) || mDecoder
+        || !buffer->mPlanarSamples)
+        return false;
+
+    const uint srcEnd{(loopItem && dataPosInt < buffer->mLoopEnd) ? buffer->mLoopEnd
+        : buffer->mSampleLen};
+    if(dataPosInt < MaxResamplerEdge || dataPosInt > srcEnd
+        || srcBufferSize > srcEnd-dataPosInt)
+        return false;
+
+    const float *src{buffer->mPlanarSamples + dataPosInt - MaxResamplerEdge};
+    for(size_t c{0};c < mChans.size();++c)
+    {
+        const float *hist{mPrevSamples[c].data()};
+        if(!std::equal(hist, hist+MaxResamplerEdge, src + c*buffer->mPlanarStride))
+            return false;
+    }
+    return true;
+}
+
+/* Checks if the voice's current and target gains are all silent, for the dry
+ * path and every send that has a target. With currentOnly, the target gains
+ * are ignored.
+ */
+bool Voice::isInaudible(const uint numSends, const bool currentOnly) const noexcept
+{
+    auto is_silent = [](const float gain) noexcept -> bool
+    { return !(std::abs(gain) > GainSilenceThreshold); };
+
+    for(auto &chandata : mChans)
+    {
+        const DirectParams &dparms = chandata.mDryParams;
+        if(mFlags.test(VoiceHasHrtf))
+        {
+            if(!is_silent(dparms.Hrtf.Old.Gain)
+                || (!currentOnly && !is_silent(dparms.Hrtf.Target.Gain)))
+                return false;
+        }
+        else if(!std::all_of(dparms.Gains.Current.cbegin(), dparms.Gains.Current.cend(),
+                is_silent)
+            || (!currentOnly && !std::all_of(dparms.Gains.Target.cbegin(),
+                dparms.Gains.Target.cend(), is_silent)))
+            return false;
+
+        for(uint send{0};send < numSends;++send)
+        {
+            if(mSend[send].Buffer.empty())
+                continue;
+
+            const SendParams &sparms = chandata.mWetParams[send];
+            if(!std::all_of(sparms.Gains.Current.cbegin(), sparms.Gains.Current.cend(),
+                    is_silent)
+                || (!currentOnly && !std::all_of(sparms.Gains.Target.cbegin(),
+                    sparms.Gains.Target.cend(), is_silent)))
+                return false;
+        }
+    }
+    return true;
+}
+
+void Voice::mix(const State vstate, ContextBase *Context, MixerScratch &Scratch,
+    const uint SamplesToDo)
 {
     static constexpr std::array<float,MAX_OUTPUT_CHANNELS> SilentTarget{};
 
@@ -480,6 +594,12 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     DeviceBase *Device{Context->mDevice};
     const uint NumSends{Device->NumAuxSends};
 
+    /* Worker threads mix to private copies of the output buffers. */
+    const al::span<FloatBufferLine> DirectBuffer{Scratch.getTarget(mDirect.Buffer)};
+    std::array<al::span<FloatBufferLine>,MAX_SENDS> SendBuffers;
+    for(uint send{0};send < NumSends;++send)
+        SendBuffers[send] = Scratch.getTarget(mSend[send].Buffer);
+
     ResamplerFunc Resample{(increment == MixerFracOne && DataPosFrac == 0) ?
                            Resample_<CopyTag,CTag> : mResampler};
 
@@ -509,17 +629,70 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     else if UNLIKELY(!BufferListItem)
         Counter = std::min(Counter, 64u);
 
-    std::array<float*,DeviceBase::MixerChannelsMax> SamplePointers;
+    /* A playing voice that's inaudible doesn't need its samples loaded,
+     * resampled, filtered, or mixed. It's left virtual, only advancing its
+     * position and buffer queue as if it was mixed, until it becomes audible
+     * again and fades back in from silence. Callback voices still need to be
+     * mixed to pull the app's samples.
+     *
+     * Voices demoted by the context's voice limit are faded out to silence
+     * first, and then stay virtual until they're no longer demoted.
+     */
+    const bool IsDemoted{mFlags.test(VoiceIsDemoted)};
+    const bool IsAudible{vstate == Playing && !IsDemoted};
+    const bool IsVirtual{vstate == Playing && !mFlags.test(VoiceIsCallback)
+        && isInaudible(NumSends, IsDemoted)};
+    if(IsVirtual)
+        mFlags.set(VoiceIsVirtual);
+    else if(mFlags.test(VoiceIsVirtual))
+    {
+        /* The sample and filter histories are stale from being virtual. */
+        mFlags.reset(VoiceIsVirtual);
+        std::fill(mPrevSamples.begin(), mPrevSamples.end(), HistoryLine{});
+        for(auto &chandata : mChans)
+        {
+            DirectParams &dparms = chandata.mDryParams;
+            dparms.LowPass.clear();
+            dparms.HighPass.clear();
+            dparms.Hrtf.History.fill(0.0f);
+            for(uint send{0};send < NumSends;++send)
+            {
+                chandata.mWetParams[send].LowPass.clear();
+                chandata.mWetParams[send].HighPass.clear();
+            }
+        }
+    }
+
+    /* Voices that don't decode or call back for their samples can spread each
+     * channel over multiple (otherwise unused) contiguous sample lines. This
+     * lets highly pitched voices load more source samples per iteration.
+     */
+    const size_t LinesPerChan{(mDecoder || mFlags.test(VoiceIsCallback)) ? 1u
+        : (Scratch.mSampleData.size() / mChans.size())};
+    const uint SrcLineSize{static_cast<uint>(LinesPerChan*MixerScratch::MixerLineSize
+        - MaxResamplerEdge)};
+
+    std::array<float*,MixerScratch::MixerChannelsMax> SamplePointers;
     const al::span<float*> MixingSamples{SamplePointers.data(), mChans.size()};
-    auto offset_bufferline = [](DeviceBase::MixerBufferLine &bufline) noexcept -> float*
-    { return bufline.data() + MaxResamplerEdge; };
-    std::transform(Device->mSampleData.end() - mChans.size(), Device->mSampleData.end(),
-        MixingSamples.begin(), offset_bufferline);
+    {
+        float *lines{Scratch.mSampleData.front().data()};
+        size_t lineidx{Scratch.mSampleData.size() - mChans.size()*LinesPerChan};
+        for(float *&samples : MixingSamples)
+        {
+            samples = lines + lineidx*MixerScratch::MixerLineSize + MaxResamplerEdge;
+            lineidx += LinesPerChan;
+        }
+    }
+
+    std::array<float*,MixerScratch::MixerChannelsMax> DirectPointers;
+    const al::span<float*> DirectSamples{DirectPointers.data(), mChans.size()};
 
     const uint PostPadding{MaxResamplerEdge + mDecoderPadding};
     uint buffers_done{0u};
     uint OutPos{0u};
     do {
+        al::span<float*> SrcSamples{MixingSamples};
+
         /* Figure out how many buffer samples will be needed */
         uint DstBufferSize{SamplesToDo - OutPos};
         uint SrcBufferSize;
@@ -545,14 +718,14 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             DataSize64 = (DataSize64*increment + DataPosFrac) >> MixerFracBits;
             DataSize64 += PostPadding;
 
-            if(DataSize64 <= DeviceBase::MixerLineSize - MaxResamplerEdge)
+            if(DataSize64 <= SrcLineSize)
                 SrcBufferSize = static_cast<uint>(DataSize64);
             else
             {
                 /* If the source size got saturated, we can't fill the desired
                  * dst size. Figure out how many samples we can actually mix.
                  */
-                SrcBufferSize = DeviceBase::MixerLineSize - MaxResamplerEdge;
+                SrcBufferSize = SrcLineSize;
 
                 DataSize64 = SrcBufferSize - PostPadding;
                 DataSize64 = ((DataSize64<<MixerFracBits) - DataPosFrac) / increment;
@@ -572,9 +745,14 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             }
         }
 
-        if(unlikely(!BufferListItem))
+        if(IsVirtual)
+        {
+            /* Nothing to load for virtual voices. */
+        }
+        else if(unlikely(!BufferListItem))
         {
-            const size_t srcOffset{(increment*DstBufferSize + DataPosFrac)>>MixerFracBits};
+            const size_t srcOffset{(uint64_t{increment}*DstBufferSize + DataPosFrac)
+                >> MixerFracBits};
             auto prevSamples = mPrevSamples.data();
             SrcBufferSize = SrcBufferSize - PostPadding + MaxResamplerEdge;
             for(auto *chanbuffer : MixingSamples)
@@ -597,6 +775,27 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
                 ++prevSamples;
             }
         }
+        else if(canResampleDirect(BufferListItem, BufferLoopItem, DataPosInt, SrcBufferSize))
+        {
+            /* Point straight into the buffer's planar samples. */
+            float *src{BufferListItem->mPlanarSamples + DataPosInt};
+            for(size_t c{0};c < DirectSamples.size();++c)
+                DirectSamples[c] = src + c*BufferListItem->mPlanarStride;
+            SrcSamples = DirectSamples;
+
+            if(likely(vstate == Playing))
+            {
+                const size_t srcOffset{(uint64_t{increment}*DstBufferSize + DataPosFrac)
+                    >> MixerFracBits};
+                auto prevSamples = mPrevSamples.data();
+                for(auto *chanbuffer : DirectSamples)
+                {
+                    std::copy_n(chanbuffer-MaxResamplerEdge+srcOffset, prevSamples->size(),
+                        prevSamples->data());
+                    ++prevSamples;
+                }
+            }
+        }
         else
         {
             auto prevSamples = mPrevSamples.data();
@@ -634,7 +833,8 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
                 LoadBufferQueue(BufferListItem, BufferLoopItem, DataPosInt, mFmtType, mFmtChannels,
                     mFrameStep, SrcBufferSize, MixingSamples);
 
-            const size_t srcOffset{(increment*DstBufferSize + DataPosFrac)>>MixerFracBits};
+            const size_t srcOffset{(uint64_t{increment}*DstBufferSize + DataPosFrac)
+                >> MixerFracBits};
             if(mDecoder)
             {
                 SrcBufferSize = SrcBufferSize - PostPadding + MaxResamplerEdge;
@@ -654,57 +854,60 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             }
         }
 
-        auto voiceSamples = MixingSamples.begin();
-        for(auto &chandata : mChans)
+        if(!IsVirtual)
         {
-            /* Resample, then apply ambisonic upsampling as needed. */
-            float *ResampledData{Resample(&mResampleState, *voiceSamples, DataPosFrac, increment,
-                {Device->ResampledData, DstBufferSize})};
-            ++voiceSamples;
-
-            if(mFlags.test(VoiceIsAmbisonic))
-                chandata.mAmbiSplitter.processScale({ResampledData, DstBufferSize},
-                    chandata.mAmbiHFScale, chandata.mAmbiLFScale);
-
-            /* Now filter and mix to the appropriate outputs. */
-            const al::span<float,BufferLineSize> FilterBuf{Device->FilteredData};
+            auto voiceSamples = SrcSamples.begin();
+            for(auto &chandata : mChans)
             {
-                DirectParams &parms = chandata.mDryParams;
-                const float *samples{DoFilters(parms.LowPass, parms.HighPass, FilterBuf.data(),
-                    {ResampledData, DstBufferSize}, mDirect.FilterType)};
+                /* Resample, then apply ambisonic upsampling as needed. */
+                float *ResampledData{Resample(&mResampleState, *voiceSamples, DataPosFrac,
+                    increment, {Scratch.ResampledData, DstBufferSize})};
+                ++voiceSamples;
 
-                if(mFlags.test(VoiceHasHrtf))
-                {
-                    const float TargetGain{parms.Hrtf.Target.Gain * likely(vstate == Playing)};
-                    DoHrtfMix(samples, DstBufferSize, parms, TargetGain, Counter, OutPos,
-                        (vstate == Playing), Device);
-                }
-                else
+                if(mFlags.test(VoiceIsAmbisonic))
+                    chandata.mAmbiSplitter.processScale({ResampledData, DstBufferSize},
+                        chandata.mAmbiHFScale, chandata.mAmbiLFScale);
+
+                /* Now filter and mix to the appropriate outputs. */
+                const al::span<float,BufferLineSize> FilterBuf{Scratch.FilteredData};
                 {
-                    const float *TargetGains{likely(vstate == Playing) ? parms.Gains.Target.data()
-                        : SilentTarget.data()};
-                    if(mFlags.test(VoiceHasNfc))
-                        DoNfcMix({samples, DstBufferSize}, mDirect.Buffer.data(), parms,
-                            TargetGains, Counter, OutPos, Device);
+                    DirectParams &parms = chandata.mDryParams;
+                    const float *samples{DoFilters(parms.LowPass, parms.HighPass, FilterBuf.data(),
+                        {ResampledData, DstBufferSize}, mDirect.FilterType)};
+
+                    if(mFlags.test(VoiceHasHrtf))
+                    {
+                        const float TargetGain{parms.Hrtf.Target.Gain * likely(IsAudible)};
+                        DoHrtfMix(samples, DstBufferSize, parms, TargetGain, Counter, OutPos,
+                            (vstate == Playing), Device->mIrSize, Scratch);
+                    }
                     else
-                        MixSamples({samples, DstBufferSize}, mDirect.Buffer,
-                            parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                    {
+                        const float *TargetGains{likely(IsAudible) ? parms.Gains.Target.data()
+                            : SilentTarget.data()};
+                        if(mFlags.test(VoiceHasNfc))
+                            DoNfcMix({samples, DstBufferSize}, DirectBuffer.data(), parms,
+                                TargetGains, Counter, OutPos, Device, Scratch);
+                        else
+                            MixSamples({samples, DstBufferSize}, DirectBuffer,
+                                parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                    }
                 }
-            }
 
-            for(uint send{0};send < NumSends;++send)
-            {
-                if(mSend[send].Buffer.empty())
-                    continue;
+                for(uint send{0};send < NumSends;++send)
+                {
+                    if(SendBuffers[send].empty())
+                        continue;
 
-                SendParams &parms = chandata.mWetParams[send];
-                const float *samples{DoFilters(parms.LowPass, parms.HighPass, FilterBuf.data(),
-                    {ResampledData, DstBufferSize}, mSend[send].FilterType)};
+                    SendParams &parms = chandata.mWetParams[send];
+                    const float *samples{DoFilters(parms.LowPass, parms.HighPass, FilterBuf.data(),
+                        {ResampledData, DstBufferSize}, mSend[send].FilterType)};
 
-                const float *TargetGains{likely(vstate == Playing) ? parms.Gains.Target.data()
-                    : SilentTarget.data()};
-                MixSamples({samples, DstBufferSize}, mSend[send].Buffer,
-                    parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                    const float *TargetGains{likely(IsAudible) ? parms.Gains.Target.data()
+                        : SilentTarget.data()};
+                    MixSamples({samples, DstBufferSize}, SendBuffers[send],
+                        parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                }
             }
         }
         /* If the voice is stopping, we're now done. */
@@ -712,10 +915,10 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             break;
 
         /* Update positions */
-        DataPosFrac += increment*DstBufferSize;
-        const uint SrcSamplesDone{DataPosFrac>>MixerFracBits};
+        const uint64_t DataPos64{uint64_t{increment}*DstBufferSize + DataPosFrac};
+        const uint SrcSamplesDone{static_cast<uint>(DataPos64>>MixerFracBits)};
         DataPosInt  += SrcSamplesDone;
-        DataPosFrac &= MixerFracMask;
+        DataPosFrac = static_cast<uint>(DataPos64) & MixerFracMask;
 
         OutPos += DstBufferSize;
         Counter = maxu(DstBufferSize, Counter) - DstBufferSize;
@@ -804,10 +1007,10 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     std::atomic_thread_fence(std::memory_order_release);
 
     /* Send any events now, after the position/buffer info was updated. */
+    RingBuffer *ring{Scratch.mEventRing ? Scratch.mEventRing : Context->mAsyncEvents.get()};
     const uint enabledevt{Context->mEnabledEvts.load(std::memory_order_acquire)};
     if(buffers_done > 0 && (enabledevt&AsyncEvent::BufferCompleted))
     {
-        RingBuffer *ring{Context->mAsyncEvents.get()};
         auto evt_vec = ring->getWriteVector();
         if(evt_vec.first.len > 0)
         {
@@ -817,6 +1020,8 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             evt->u.bufcomp.count = buffers_done;
             ring->writeAdvance(1);
         }
+        else
+            Context->mEventsDropped.fetch_add(1u, std::memory_order_relaxed);
     }
 
     if(!BufferListItem)
@@ -826,7 +1031,7 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
          */
         mPlayState.store(Stopping, std::memory_order_release);
         if((enabledevt&AsyncEvent::SourceStateChange))
-            SendSourceStoppedEvent(Context, SourceID);
+            SendSourceStoppedEvent(Context, ring, SourceID);
     }
 }
 
@@ -6,6 +6,7 @@
 #include <bitset>
 #include <memory>
 #include <stddef.h>
+#include <stdint.h>
 #include <string>
 
 #include "albyte.h"
@@ -27,6 +28,7 @@
 struct ContextBase;
 struct DeviceBase;
 struct EffectSlot;
+struct MixerScratch;
 enum class DistanceModel : unsigned char;
 
 using uint = unsigned int;
@@ -102,6 +104,13 @@ struct VoiceBufferItem {
     uint mLoopEnd{0u};
 
     al::byte *mSamples{nullptr};
+
+    /* Optional planar float samples, either a pre-decoded copy of mSamples
+     * or mSamples itself when it's already mono float, with each channel
+     * mPlanarStride samples after the last.
+     */
+    float *mPlanarSamples{nullptr};
+    uint mPlanarStride{0u};
 };
 
 
@@ -141,6 +150,8 @@ struct VoiceProps {
     float Radius;
     float EnhWidth;
 
+    int Priority;
+
     /** Direct filter and auxiliary send info. */
     struct {
         float Gain;
@@ -173,6 +184,8 @@ enum : uint {
     VoiceIsFading,
     VoiceHasHrtf,
     VoiceHasNfc,
+    VoiceIsVirtual,
+    VoiceIsDemoted,
 
     VoiceFlagCount
 };
@@ -230,6 +243,8 @@ struct Voice {
     InterpState mResampleState;
 
     std::bitset<VoiceFlagCount> mFlags{};
+    /* Ranking for the context's voice limit, used by the mixer. */
+    uint64_t mRank{0};
     uint mNumCallbackSamples{0};
 
     struct TargetData {
@@ -262,7 +277,11 @@ struct Voice {
     Voice(const Voice&) = delete;
     Voice& operator=(const Voice&) = delete;
 
-    void mix(const State vstate, ContextBase *Context, const uint SamplesToDo);
+    void mix(const State vstate, ContextBase *Context, MixerScratch &Scratch,
+        const uint SamplesToDo);
+    bool canResampleDirect(const VoiceBufferItem *buffer, const VoiceBufferItem *loopItem,
+        const uint dataPosInt, const uint srcBufferSize) const noexcept;
+    bool isInaudible(const uint numSends, const bool currentOnly) const noexcept;
 
     void prepare(DeviceBase *device);
 
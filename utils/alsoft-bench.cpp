@@ -0,0 +1,543 @@
+/*
+ * OpenAL Mixer Benchmark
+ *
+ * Copyright (c) 2022
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* This renders a set of scripted scenes through a loopback device as fast as
+ * possible, and reports how long the mixing took. Each scene plays a number of
+ * looping sources with a particular resampler, output mode, or effect, so the
+ * cost of each can be compared between builds or CPU extensions. Results are
+ * written to stdout as one JSON object per line.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "AL/alc.h"
+#include "AL/al.h"
+#include "AL/alext.h"
+#include "AL/efx.h"
+
+#include "win_main_utf8.h"
+
+#ifndef AL_SOFT_convolution_reverb
+#define AL_SOFT_convolution_reverb
+#define AL_EFFECT_CONVOLUTION_REVERB_SOFT        0xA000
+#endif
+
+
+namespace {
+
+using uint = unsigned int;
+using BenchClock = std::chrono::steady_clock;
+
+LPALCLOOPBACKOPENDEVICESOFT alcLoopbackOpenDeviceSOFT;
+LPALCISRENDERFORMATSUPPORTEDSOFT alcIsRenderFormatSupportedSOFT;
+LPALCRENDERSAMPLESSOFT alcRenderSamplesSOFT;
+
+LPALGENEFFECTS alGenEffects;
+LPALDELETEEFFECTS alDeleteEffects;
+LPALEFFECTI alEffecti;
+LPALGENAUXILIARYEFFECTSLOTS alGenAuxiliaryEffectSlots;
+LPALDELETEAUXILIARYEFFECTSLOTS alDeleteAuxiliaryEffectSlots;
+LPALAUXILIARYEFFECTSLOTI alAuxiliaryEffectSloti;
+
+
+struct BenchOptions {
+    uint mNumVoices{64};
+    uint mFrequency{48000};
+    uint mUpdateSize{1024};
+    double mSeconds{10.0};
+};
+
+struct Scene {
+    std::string mName;
+    ALCint mChannels{ALC_STEREO_SOFT};
+    ALCint mAmbiOrder{0};
+    ALCint mHrtf{ALC_FALSE};
+    ALCint mOutputMode{ALC_ANY_SOFT};
+    /* The resampler index to use, or -1 for the default. */
+    ALint mResampler{-1};
+    ALenum mEffect{AL_EFFECT_NULL};
+};
+
+struct EffectName {
+    const char name[16];
+    ALenum type;
+};
+constexpr EffectName EffectList[]{
+    { "eaxreverb",    AL_EFFECT_EAXREVERB },
+    { "reverb",       AL_EFFECT_REVERB },
+    { "autowah",      AL_EFFECT_AUTOWAH },
+    { "chorus",       AL_EFFECT_CHORUS },
+    { "compressor",   AL_EFFECT_COMPRESSOR },
+    { "distortion",   AL_EFFECT_DISTORTION },
+    { "echo",         AL_EFFECT_ECHO },
+    { "equalizer",    AL_EFFECT_EQUALIZER },
+    { "flanger",      AL_EFFECT_FLANGER },
+    { "fshifter",     AL_EFFECT_FREQUENCY_SHIFTER },
+    { "modulator",    AL_EFFECT_RING_MODULATOR },
+    { "pshifter",     AL_EFFECT_PITCH_SHIFTER },
+    { "vmorpher",     AL_EFFECT_VOCAL_MORPHER },
+    { "dedicated",    AL_EFFECT_DEDICATED_DIALOGUE },
+    { "convolution",  AL_EFFECT_CONVOLUTION_REVERB_SOFT },
+};
+
+
+/* A simple LCG, so the test signals are the same for every run. */
+struct NoiseGen {
+    uint32_t mSeed{22222u};
+
+    float operator()() noexcept
+    {
+        mSeed = mSeed*96314165u + 907633515u;
+        return static_cast<float>(static_cast<int32_t>(mSeed)) / 2147483648.0f;
+    }
+};
+
+/* Creates a 1-second mono buffer of filtered noise, used as the source sound.
+ * The buffer's sample rate differs from the device's so the resampler always
+ * runs.
+ */
+ALuint CreateSourceBuffer()
+{
+    constexpr ALsizei srate{44100};
+    std::vector<ALshort> data(srate);
+
+    NoiseGen noise{};
+    float last{0.0f};
+    for(ALshort &sample : data)
+    {
+        last = last*0.9f + noise()*0.1f;
+        const float val{std::min(std::max(last, -1.0f), 1.0f)};
+        sample = static_cast<ALshort>(std::lround(val * 32767.0f));
+    }
+
+    ALuint buffer{0};
+    alGenBuffers(1, &buffer);
+    alBufferData(buffer, AL_FORMAT_MONO16, data.data(),
+        static_cast<ALsizei>(data.size()*sizeof(ALshort)), srate);
+    return buffer;
+}
+
+/* Creates a 1-second mono impulse response of decaying noise, for the
+ * convolution effect.
+ */
+ALuint CreateImpulseBuffer(const uint frequency)
+{
+    std::vector<ALshort> data(frequency);
+
+    NoiseGen noise{};
+    const float decay{std::pow(0.001f, 1.0f / static_cast<float>(frequency))};
+    float gain{0.5f};
+    for(ALshort &sample : data)
+    {
+        sample = static_cast<ALshort>(std::lround(noise() * gain * 32767.0f));
+        gain *= decay;
+    }
+
+    ALuint buffer{0};
+    alGenBuffers(1, &buffer);
+    alBufferData(buffer, AL_FORMAT_MONO16, data.data(),
+        static_cast<ALsizei>(data.size()*sizeof(ALshort)), static_cast<ALsizei>(frequency));
+    return buffer;
+}
+
+
+/* Reports a scene that couldn't be run. Scenes needing a feature the library
+ * or build doesn't have (e.g. HRTF data) are skipped without failing.
+ */
+void PrintSkipped(const Scene &scene, const char *reason)
+{
+    printf("{\"scene\":\"%s\",\"skipped\":\"%s\"}\n", scene.mName.c_str(), reason);
+    fflush(stdout);
+}
+
+double Percentile(const std::vector<double> &sorted, const double pct)
+{
+    const auto idx = static_cast<size_t>(static_cast<double>(sorted.size()-1)*pct + 0.5);
+    return sorted[std::min(idx, sorted.size()-1)];
+}
+
+bool RunScene(const Scene &scene, const BenchOptions &opts)
+{
+    ALCdevice *device{alcLoopbackOpenDeviceSOFT(nullptr)};
+    if(!device)
+    {
+        PrintSkipped(scene, "failed to open loopback device");
+        return false;
+    }
+
+    std::vector<ALCint> attrs{
+        ALC_FREQUENCY, static_cast<ALCint>(opts.mFrequency),
+        ALC_FORMAT_CHANNELS_SOFT, scene.mChannels,
+        ALC_FORMAT_TYPE_SOFT, ALC_FLOAT_SOFT,
+        ALC_MONO_SOURCES, static_cast<ALCint>(opts.mNumVoices),
+        ALC_STEREO_SOURCES, 0,
+        ALC_MAX_AUXILIARY_SENDS, 1,
+        ALC_HRTF_SOFT, scene.mHrtf,
+    };
+    if(scene.mAmbiOrder > 0)
+    {
+        attrs.insert(attrs.end(), {ALC_AMBISONIC_LAYOUT_SOFT, ALC_ACN_SOFT,
+            ALC_AMBISONIC_SCALING_SOFT, ALC_SN3D_SOFT,
+            ALC_AMBISONIC_ORDER_SOFT, scene.mAmbiOrder});
+    }
+    if(scene.mOutputMode != ALC_ANY_SOFT)
+        attrs.insert(attrs.end(), {ALC_OUTPUT_MODE_SOFT, scene.mOutputMode});
+    attrs.push_back(0);
+
+    if(!alcIsRenderFormatSupportedSOFT(device, static_cast<ALCsizei>(opts.mFrequency),
+        scene.mChannels, ALC_FLOAT_SOFT))
+    {
+        PrintSkipped(scene, "render format not supported");
+        alcCloseDevice(device);
+        return true;
+    }
+
+    ALCcontext *context{alcCreateContext(device, attrs.data())};
+    if(!context || alcMakeContextCurrent(context) == ALC_FALSE)
+    {
+        PrintSkipped(scene, "failed to create context");
+        if(context) alcDestroyContext(context);
+        alcCloseDevice(device);
+        return false;
+    }
+
+    auto cleanup = [device,context]
+    {
+        alcMakeContextCurrent(nullptr);
+        alcDestroyContext(context);
+        alcCloseDevice(device);
+    };
+
+    if(scene.mHrtf)
+    {
+        ALCint status{ALC_HRTF_DISABLED_SOFT};
+        alcGetIntegerv(device, ALC_HRTF_STATUS_SOFT, 1, &status);
+        if(status != ALC_HRTF_ENABLED_SOFT)
+        {
+            PrintSkipped(scene, "HRTF not available");
+            cleanup();
+            return true;
+        }
+    }
+    if(scene.mOutputMode != ALC_ANY_SOFT)
+    {
+        ALCint mode{ALC_ANY_SOFT};
+        alcGetIntegerv(device, ALC_OUTPUT_MODE_SOFT, 1, &mode);
+        if(mode != scene.mOutputMode)
+        {
+            PrintSkipped(scene, "output mode not available");
+            cleanup();
+            return true;
+        }
+    }
+
+    const ALuint buffer{CreateSourceBuffer()};
+    ALuint irbuffer{0}, effect{0}, slot{0};
+    if(scene.mEffect != AL_EFFECT_NULL)
+    {
+        alGenEffects(1, &effect);
+        alEffecti(effect, AL_EFFECT_TYPE, scene.mEffect);
+        alGenAuxiliaryEffectSlots(1, &slot);
+        if(scene.mEffect == AL_EFFECT_CONVOLUTION_REVERB_SOFT)
+        {
+            irbuffer = CreateImpulseBuffer(opts.mFrequency);
+            alAuxiliaryEffectSloti(slot, AL_BUFFER, static_cast<ALint>(irbuffer));
+        }
+        alAuxiliaryEffectSloti(slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
+    }
+
+    /* Spread the sources around the listener, each with a slightly different
+     * pitch so they don't all resample in lockstep.
+     */
+    std::vector<ALuint> sources(opts.mNumVoices);
+    alGenSources(static_cast<ALsizei>(sources.size()), sources.data());
+    for(size_t i{0};i < sources.size();++i)
+    {
+        const float angle{static_cast<float>(i) * 6.2831853f / static_cast<float>(sources.size())};
+        const ALuint source{sources[i]};
+        alSourcei(source, AL_BUFFER, static_cast<ALint>(buffer));
+        alSourcei(source, AL_LOOPING, AL_TRUE);
+        alSource3f(source, AL_POSITION, std::sin(angle)*2.0f, 0.0f, -std::cos(angle)*2.0f);
+        alSourcef(source, AL_PITCH, 0.9f + 0.2f*static_cast<float>(i%16)/15.0f);
+        if(scene.mResampler >= 0)
+            alSourcei(source, AL_SOURCE_RESAMPLER_SOFT, scene.mResampler);
+        if(slot)
+            alSource3i(source, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(slot), 0,
+                AL_FILTER_NULL);
+    }
+    alSourcePlayv(static_cast<ALsizei>(sources.size()), sources.data());
+
+    bool ok{alGetError() == AL_NO_ERROR};
+    if(!ok)
+        PrintSkipped(scene, "failed to set up the scene");
+    else
+    {
+        const uint channels{scene.mAmbiOrder > 0 ?
+            static_cast<uint>((scene.mAmbiOrder+1) * (scene.mAmbiOrder+1)) :
+            (scene.mChannels == ALC_MONO_SOFT) ? 1u : 2u};
+        std::vector<float> output(opts.mUpdateSize * channels);
+        const auto updatesize = static_cast<ALCsizei>(opts.mUpdateSize);
+
+        /* Warm up the caches and let any initial fading finish. */
+        for(uint i{0};i < opts.mFrequency/4;i += opts.mUpdateSize)
+            alcRenderSamplesSOFT(device, output.data(), updatesize);
+
+        const auto total_frames = static_cast<uint64_t>(opts.mSeconds * opts.mFrequency);
+        const uint64_t num_updates{(total_frames + opts.mUpdateSize-1) / opts.mUpdateSize};
+        std::vector<double> update_times;
+        update_times.reserve(num_updates);
+
+        const BenchClock::time_point start{BenchClock::now()};
+        BenchClock::time_point last{start};
+        for(uint64_t i{0};i < num_updates;++i)
+        {
+            alcRenderSamplesSOFT(device, output.data(), updatesize);
+            const BenchClock::time_point now{BenchClock::now()};
+            update_times.push_back(std::chrono::duration<double,std::micro>{now - last}.count());
+            last = now;
+        }
+        const double elapsed{std::chrono::duration<double>{last - start}.count()};
+        std::sort(update_times.begin(), update_times.end());
+
+        const uint64_t frames{num_updates * opts.mUpdateSize};
+        const double audio_secs{static_cast<double>(frames) / opts.mFrequency};
+        printf("{\"scene\":\"%s\",\"voices\":%u,\"frequency\":%u,\"update_size\":%u,"
+            "\"frames\":%llu,\"seconds\":%.6f,\"samples_per_sec\":%.1f,\"realtime\":%.2f,"
+            "\"ns_per_voice_sample\":%.3f,\"update_us\":{\"mean\":%.2f,\"p50\":%.2f,"
+            "\"p90\":%.2f,\"p99\":%.2f,\"max\":%.2f}}\n",
+            scene.mName.c_str(), opts.mNumVoices, opts.mFrequency, opts.mUpdateSize,
+            static_cast<unsigned long long>(frames), elapsed,
+            static_cast<double>(frames) / elapsed, audio_secs / elapsed,
+            elapsed * 1e9 / static_cast<double>(frames) / opts.mNumVoices,
+            elapsed * 1e6 / static_cast<double>(num_updates), Percentile(update_times, 0.5),
+            Percentile(update_times, 0.9), Percentile(update_times, 0.99),
+            update_times.back());
+        fflush(stdout);
+    }
+
+    alSourceStopv(static_cast<ALsizei>(sources.size()), sources.data());
+    alDeleteSources(static_cast<ALsizei>(sources.size()), sources.data());
+    if(slot)
+    {
+        alDeleteAuxiliaryEffectSlots(1, &slot);
+        alDeleteEffects(1, &effect);
+    }
+    if(irbuffer)
+        alDeleteBuffers(1, &irbuffer);
+    alDeleteBuffers(1, &buffer);
+
+    cleanup();
+    return ok;
+}
+
+
+/* Builds the list of scenes. The resampler names need a context to query, so
+ * a temporary one is made on a loopback device.
+ */
+std::vector<Scene> BuildScenes()
+{
+    std::vector<Scene> scenes;
+
+    ALCdevice *device{alcLoopbackOpenDeviceSOFT(nullptr)};
+    if(device)
+    {
+        const ALCint attrs[]{ALC_FREQUENCY, 48000, ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+            ALC_FORMAT_TYPE_SOFT, ALC_FLOAT_SOFT, 0};
+        ALCcontext *context{alcCreateContext(device, attrs)};
+        if(context && alcMakeContextCurrent(context)
+            && alIsExtensionPresent("AL_SOFT_source_resampler"))
+        {
+            auto alGetStringiSOFT = reinterpret_cast<LPALGETSTRINGISOFT>(
+                alGetProcAddress("alGetStringiSOFT"));
+            const ALint num_resamplers{alGetInteger(AL_NUM_RESAMPLERS_SOFT)};
+            for(ALint i{0};i < num_resamplers;++i)
+            {
+                Scene scene{};
+                scene.mName = "resampler/";
+                scene.mName += alGetStringiSOFT(AL_RESAMPLER_NAME_SOFT, i);
+                scene.mResampler = i;
+                scenes.emplace_back(std::move(scene));
+            }
+        }
+        alcMakeContextCurrent(nullptr);
+        if(context) alcDestroyContext(context);
+        alcCloseDevice(device);
+    }
+
+    Scene stereo{};
+    stereo.mName = "output/stereo";
+    scenes.emplace_back(stereo);
+
+    Scene hrtf{};
+    hrtf.mName = "output/hrtf";
+    hrtf.mHrtf = ALC_TRUE;
+    scenes.emplace_back(hrtf);
+
+    Scene uhj{};
+    uhj.mName = "output/uhj";
+    uhj.mOutputMode = ALC_STEREO_UHJ_SOFT;
+    scenes.emplace_back(uhj);
+
+    for(ALCint order{1};order <= 3;++order)
+    {
+        Scene ambi{};
+        ambi.mName = "output/ambi" + std::to_string(order);
+        ambi.mChannels = ALC_BFORMAT3D_SOFT;
+        ambi.mAmbiOrder = order;
+        scenes.emplace_back(ambi);
+    }
+
+    for(const EffectName &effect : EffectList)
+    {
+        Scene scene{};
+        scene.mName = "effect/";
+        scene.mName += effect.name;
+        scene.mEffect = effect.type;
+        scenes.emplace_back(std::move(scene));
+    }
+
+    return scenes;
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    BenchOptions opts{};
+    std::vector<std::string> filters;
+    bool list_only{false};
+
+    for(int i{1};i < argc;++i)
+    {
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0)
+        {
+            printf("Usage: %s [options] [scene filters...]\n\n"
+                "Renders scenes through a loopback device as fast as possible, writing one\n"
+                "JSON result per line. Scenes are only run if their name contains one of the\n"
+                "given filters, or all are run if none are given.\n\n"
+                "Options:\n"
+                "  -n <voices>     Number of sources playing in each scene (default %u)\n"
+                "  -f <rate>       Output sample rate (default %u)\n"
+                "  -u <samples>    Samples rendered per update (default %u)\n"
+                "  -t <seconds>    Length of audio to render per scene (default %g)\n"
+                "  -l              List the scenes and exit\n",
+                argv[0], opts.mNumVoices, opts.mFrequency, opts.mUpdateSize, opts.mSeconds);
+            return 0;
+        }
+
+        auto get_value = [argc,argv,&i]() -> const char*
+        {
+            if(i+1 >= argc)
+            {
+                fprintf(stderr, "Missing value for %s\n", argv[i]);
+                exit(1);
+            }
+            return argv[++i];
+        };
+        auto get_uint = [&get_value](const char *name, const unsigned long minval,
+            const unsigned long maxval) -> uint
+        {
+            const char *str{get_value()};
+            char *end{};
+            const unsigned long value{std::strtoul(str, &end, 0)};
+            if(!end || *end != '\0' || value < minval || value > maxval)
+            {
+                fprintf(stderr, "Invalid %s: %s\n", name, str);
+                exit(1);
+            }
+            return static_cast<uint>(value);
+        };
+
+        if(std::strcmp(argv[i], "-n") == 0)
+            opts.mNumVoices = get_uint("voice count", 1, 4096);
+        else if(std::strcmp(argv[i], "-f") == 0)
+            opts.mFrequency = get_uint("sample rate", 8000, 192000);
+        else if(std::strcmp(argv[i], "-u") == 0)
+            opts.mUpdateSize = get_uint("update size", 16, 8192);
+        else if(std::strcmp(argv[i], "-t") == 0)
+        {
+            const char *str{get_value()};
+            char *end{};
+            opts.mSeconds = std::strtod(str, &end);
+            if(!end || *end != '\0' || !(opts.mSeconds > 0.0 && opts.mSeconds <= 3600.0))
+            {
+                fprintf(stderr, "Invalid length: %s\n", str);
+                return 1;
+            }
+        }
+        else if(std::strcmp(argv[i], "-l") == 0)
+            list_only = true;
+        else
+            filters.emplace_back(argv[i]);
+    }
+
+    if(!alcIsExtensionPresent(nullptr, "ALC_SOFT_loopback"))
+    {
+        fprintf(stderr, "Error: ALC_SOFT_loopback not supported!\n");
+        return 1;
+    }
+
+#define LOAD_PROC(T, x)  ((x) = reinterpret_cast<T>(alcGetProcAddress(nullptr, #x)))
+    LOAD_PROC(LPALCLOOPBACKOPENDEVICESOFT, alcLoopbackOpenDeviceSOFT);
+    LOAD_PROC(LPALCISRENDERFORMATSUPPORTEDSOFT, alcIsRenderFormatSupportedSOFT);
+    LOAD_PROC(LPALCRENDERSAMPLESSOFT, alcRenderSamplesSOFT);
+#undef LOAD_PROC
+#define LOAD_PROC(T, x)  ((x) = reinterpret_cast<T>(alGetProcAddress(#x)))
+    LOAD_PROC(LPALGENEFFECTS, alGenEffects);
+    LOAD_PROC(LPALDELETEEFFECTS, alDeleteEffects);
+    LOAD_PROC(LPALEFFECTI, alEffecti);
+    LOAD_PROC(LPALGENAUXILIARYEFFECTSLOTS, alGenAuxiliaryEffectSlots);
+    LOAD_PROC(LPALDELETEAUXILIARYEFFECTSLOTS, alDeleteAuxiliaryEffectSlots);
+    LOAD_PROC(LPALAUXILIARYEFFECTSLOTI, alAuxiliaryEffectSloti);
+#undef LOAD_PROC
+
+    const std::vector<Scene> scenes{BuildScenes()};
+    uint failed{0};
+    for(const Scene &scene : scenes)
+    {
+        if(!filters.empty())
+        {
+            auto matches = [&scene](const std::string &filter) -> bool
+            { return scene.mName.find(filter) != std::string::npos; };
+            if(std::none_of(filters.cbegin(), filters.cend(), matches))
+                continue;
+        }
+
+        if(list_only)
+            printf("%s\n", scene.mName.c_str());
+        else if(!RunScene(scene, opts))
+            ++failed;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+/*
+ * OpenAL Shared Memory Ring Reader
+ *
+ * Copyright (c) 2022
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* This consumes the output of a device opened on the shm backend, without any
+ * audio hardware. It attaches to the device's ring by name, reading it either
+ * as fast as the device can mix or at the ring's real-time rate, and
+ * optionally writes the raw samples to a file. When the device is reset or
+ * closed, it waits for the ring to be recreated and attaches to the new one.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "shmring.h"
+
+
+namespace {
+
+using uint = unsigned int;
+using ReadClock = std::chrono::steady_clock;
+
+struct ReadOptions {
+    std::string mName{"/alsoft-output"};
+    double mSeconds{10.0};
+    bool mRealTime{false};
+    const char *mOutName{nullptr};
+};
+
+struct RingMap {
+    ShmRingHeader *mHeader{nullptr};
+    const unsigned char *mData{nullptr};
+    size_t mSize{0};
+
+    void unmap()
+    {
+        if(mHeader)
+            munmap(mHeader, mSize);
+        mHeader = nullptr;
+        mData = nullptr;
+        mSize = 0;
+    }
+};
+
+const char *SampleTypeName(uint32_t type)
+{
+    switch(type)
+    {
+    case ShmSampleInt8: return "int8";
+    case ShmSampleUInt8: return "uint8";
+    case ShmSampleInt16: return "int16";
+    case ShmSampleUInt16: return "uint16";
+    case ShmSampleInt32: return "int32";
+    case ShmSampleUInt32: return "uint32";
+    case ShmSampleFloat32: return "float32";
+    }
+    return "(unknown)";
+}
+
+/* Attaches to the named ring, returning false if it doesn't exist or isn't a
+ * valid ring (possibly because the producer is still creating it).
+ */
+bool AttachRing(const std::string &name, RingMap &ring)
+{
+    int fd{shm_open(name.c_str(), O_RDWR, 0)};
+    if(fd == -1) return false;
+
+    struct stat st{};
+    if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < ShmRingDataOffset)
+    {
+        close(fd);
+        return false;
+    }
+
+    const auto size = static_cast<size_t>(st.st_size);
+    void *ptr{mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)};
+    close(fd);
+    if(ptr == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map %s: %s\n", name.c_str(), strerror(errno));
+        return false;
+    }
+
+    auto *header = static_cast<ShmRingHeader*>(ptr);
+    if(header->mMagic != ShmRingHeader::Magic || header->mVersion != ShmRingHeader::Version
+        || header->mDataOffset != ShmRingDataOffset || header->mCapacity == 0
+        || (header->mCapacity&(header->mCapacity-1)) != 0
+        || size_t{header->mCapacity}*header->mFrameSize > size - ShmRingDataOffset
+        || header->mState.load(std::memory_order_acquire) == ShmRingClosed)
+    {
+        munmap(ptr, size);
+        return false;
+    }
+
+    ring.mHeader = header;
+    ring.mData = static_cast<const unsigned char*>(ptr) + header->mDataOffset;
+    ring.mSize = size;
+    return true;
+}
+
+struct ReadStats {
+    ReadClock::time_point mStart{ReadClock::now()};
+    uint64_t mFrames{0};
+    uint mAttaches{0};
+    uint mFrequency{0};
+};
+
+/* Reads the ring for the given length of time, reattaching as needed. */
+ReadStats ReadRing(const ReadOptions &opts, FILE *outfile)
+{
+    using std::chrono::milliseconds;
+    using std::chrono::duration_cast;
+
+    ReadStats stats{};
+    const auto end_time = stats.mStart + duration_cast<ReadClock::duration>(
+        std::chrono::duration<double>{opts.mSeconds});
+
+    RingMap ring{};
+
+    /* When reading in real time, the frames read since attaching and when the
+     * reading started.
+     */
+    uint64_t paced_frames{0};
+    ReadClock::time_point paced_start{};
+
+    while(ReadClock::now() < end_time)
+    {
+        ShmRingHeader *header{ring.mHeader};
+        if(!header)
+        {
+            if(!AttachRing(opts.mName, ring))
+            {
+                std::this_thread::sleep_for(milliseconds{10});
+                continue;
+            }
+            header = ring.mHeader;
+            ++stats.mAttaches;
+            stats.mFrequency = header->mFrequency;
+            printf("Attached to %s: %u channels, %s, %uhz, %u frame buffer\n",
+                opts.mName.c_str(), header->mChannels, SampleTypeName(header->mSampleType),
+                header->mFrequency, header->mBufferSize);
+
+            /* Start from the ring's current position, as with a capture
+             * device.
+             */
+            header->mReadPos.store(header->mWritePos.load(std::memory_order_acquire),
+                std::memory_order_release);
+            ShmRingWake(header->mReadSeq);
+            paced_frames = 0;
+            paced_start = ReadClock::now();
+        }
+
+        if(header->mState.load(std::memory_order_acquire) == ShmRingClosed)
+        {
+            ring.unmap();
+            continue;
+        }
+
+        const uint32_t seq{header->mWriteSeq.load(std::memory_order_acquire)};
+        const uint64_t writepos{header->mWritePos.load(std::memory_order_acquire)};
+        const uint64_t readpos{header->mReadPos.load(std::memory_order_relaxed)};
+        uint64_t todo{std::min<uint64_t>(writepos - readpos, header->mCapacity)};
+        if(opts.mRealTime)
+        {
+            const auto elapsed = ReadClock::now() - paced_start;
+            const uint64_t due{static_cast<uint64_t>(
+                duration_cast<std::chrono::duration<double>>(elapsed).count() * stats.mFrequency)};
+            todo = std::min(todo, due - std::min(due, paced_frames));
+            if(todo == 0)
+            {
+                std::this_thread::sleep_for(milliseconds{1});
+                continue;
+            }
+        }
+        if(todo == 0)
+        {
+            ShmRingWait(header->mWriteSeq, seq, milliseconds{100});
+            continue;
+        }
+
+        const uint64_t size_mask{header->mCapacity - 1u};
+        const size_t frame_size{header->mFrameSize};
+        const auto offset = static_cast<size_t>(readpos & size_mask);
+        const auto len1 = static_cast<size_t>(std::min<uint64_t>(todo, size_mask+1 - offset));
+        const auto len2 = static_cast<size_t>(todo - len1);
+        if(outfile)
+        {
+            fwrite(ring.mData + offset*frame_size, frame_size, len1, outfile);
+            if(len2 > 0)
+                fwrite(ring.mData, frame_size, len2, outfile);
+        }
+
+        header->mReadPos.store(readpos + todo, std::memory_order_release);
+        ShmRingWake(header->mReadSeq);
+
+        stats.mFrames += todo;
+        paced_frames += todo;
+    }
+    ring.unmap();
+
+    return stats;
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    ReadOptions opts{};
+
+    for(int i{1};i < argc;++i)
+    {
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0)
+        {
+            printf("Usage: %s [options]\n\n"
+                "Reads the output of an OpenAL Soft shm backend device, and reports how much\n"
+                "was read.\n\n"
+                "Options:\n"
+                "  -n <name>       Shared memory name of the ring (default %s)\n"
+                "  -t <seconds>    Length of time to read for (default %g)\n"
+                "  -r              Read at the ring's sample rate instead of as fast as\n"
+                "                  possible\n"
+                "  -o <file>       Write the raw samples read to the given file\n",
+                argv[0], opts.mName.c_str(), opts.mSeconds);
+            return 0;
+        }
+
+        auto get_value = [argc,argv,&i]() -> const char*
+        {
+            if(i+1 >= argc)
+            {
+                fprintf(stderr, "Missing value for %s\n", argv[i]);
+                exit(1);
+            }
+            return argv[++i];
+        };
+
+        if(std::strcmp(argv[i], "-n") == 0)
+            opts.mName = get_value();
+        else if(std::strcmp(argv[i], "-t") == 0)
+        {
+            const char *str{get_value()};
+            char *end{};
+            opts.mSeconds = std::strtod(str, &end);
+            if(!end || *end != '\0' || !(opts.mSeconds > 0.0 && opts.mSeconds <= 86400.0))
+            {
+                fprintf(stderr, "Invalid length: %s\n", str);
+                return 1;
+            }
+        }
+        else if(std::strcmp(argv[i], "-r") == 0)
+            opts.mRealTime = true;
+        else if(std::strcmp(argv[i], "-o") == 0)
+            opts.mOutName = get_value();
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    FILE *outfile{nullptr};
+    if(opts.mOutName)
+    {
+        outfile = fopen(opts.mOutName, "wb");
+        if(!outfile)
+        {
+            fprintf(stderr, "Failed to open %s: %s\n", opts.mOutName, strerror(errno));
+            return 1;
+        }
+    }
+
+    const ReadStats stats{ReadRing(opts, outfile)};
+
+    if(outfile)
+        fclose(outfile);
+
+    const double elapsed{std::chrono::duration<double>{ReadClock::now() - stats.mStart}.count()};
+    printf("Read %llu frames in %.3f seconds", static_cast<unsigned long long>(stats.mFrames),
+        elapsed);
+    if(stats.mFrequency > 0)
+        printf(" (%.2fx real time)", static_cast<double>(stats.mFrames)/stats.mFrequency/elapsed);
+    printf(", attached %u time%s\n", stats.mAttaches, (stats.mAttaches == 1) ? "" : "s");
+
+    return 0;
+}